@@ -0,0 +1,227 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// Micro-benchmarks of the phases of FMAlign2 on one workload (see generate_workload.py and make bench).
+// Every benchmark runs -r times and keeps the fastest run; its throughput is the number of items,
+// bases, MEMs, SW cells or output bytes, per second of that run. The results are written as JSON
+// and compared against a stored baseline by compare.py.
+#include "../include/common.h"
+#include "../include/utils.h"
+#include "../include/mem_finder.h"
+#include "../include/sequence_split_align.h"
+#include "../include/ssw.h"
+#include <fstream>
+#include <functional>
+#include <random>
+
+GlobalArgs global_args;
+
+struct BenchResult {
+    std::string name;
+    std::string unit;   // what the items are
+    uint64_t items;     // processed by one run
+    double seconds;     // the fastest run
+};
+
+// Run fn repeat times and return the fastest wall time.
+static double best_of(int repeat, const std::function<void()>& fn) {
+    double best = 0;
+    for (int r = 0; r < repeat; r++) {
+        Timer timer;
+        fn();
+        double seconds = timer.elapsed_time();
+        if (r == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+static std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+// The suffix index, the MEMs and their filters at the index width find_mem() picks for the workload.
+template <typename Index>
+static void bench_index(const SequenceStore& data, int repeat, std::vector<BenchResult>& results) {
+    const uint_t seq_num = data.size();
+    const Index n = data.concat_length();
+    double seconds;
+    // suffix array, LCP and document array as find_mem() builds them
+    Index* SA = (Index*)malloc((size_t)n * sizeof(Index));
+    IndexInt<Index>* LCP = (IndexInt<Index>*)calloc(n, sizeof(IndexInt<Index>));
+    int32_t* DA = (int32_t*)malloc((size_t)n * sizeof(int32_t));
+    seconds = best_of(repeat, [&]() {
+        memset(LCP, 0, (size_t)n * sizeof(IndexInt<Index>));
+        build_gsacak(data.concat(), SA, LCP, DA, n);
+    });
+    results.push_back({ "gsacak", "bases", n, seconds });
+
+    // LCP intervals and their MEMs, as in find_mem()
+    MemTable<Index> mems;
+    seconds = best_of(repeat, [&]() {
+        lcp_intervals_to_mems<Index>(SA, DA, LCP, data.concat(), n, global_args.min_mem_length, seq_num, data.bounds(), mems);
+    });
+    results.push_back({ "lcp_intervals_interval2mem", "mems", mems.size(), seconds });
+    free(SA);
+    free(LCP);
+    free(DA);
+
+    sort_mem(mems, data);
+    const uint_t mem_num = mems.size();
+    for (const char* mode : { "fast", "accurate" }) {
+        seconds = best_of(repeat, [&]() {
+            MemTable<Index> copy = mems;
+            std::vector<std::vector<std::pair<int_t, int_t>>> chain = std::string(mode) == "fast" ? filter_mem_fast(copy, seq_num) : filter_mem_accurate(copy, seq_num);
+        });
+        results.push_back({ std::string("filter_mem_") + mode, "mems", mem_num, seconds });
+    }
+}
+
+int main(int argc, char** argv) {
+    ArgParser parser;
+    parser.add_argument("i", true, "/path/to/workload.fasta");
+    parser.add_argument_help("i", "The workload, e.g. written by bench/generate_workload.py.");
+    parser.add_argument("o", false, "bench_result.json");
+    parser.add_argument_help("o", "The JSON file the results are written to.");
+    parser.add_argument("r", false, "3");
+    parser.add_argument_help("r", "Runs of every benchmark, the fastest one counts.");
+    parser.add_argument("t", false, "1");
+    parser.add_argument_help("t", "Threads of the parallel phases (interval2mem, concat_alignment).");
+    parser.add_argument("l", false, "30");
+    parser.add_argument_help("l", "The minimum length of MEM.");
+    parser.add_argument("h", false, "help");
+    parser.add_argument_help("h", "print help information");
+    int repeat;
+    std::string result_path;
+    try {
+        parser.parse_args(argc, argv);
+        global_args.data_path = parser.get("i");
+        result_path = parser.get("o");
+        repeat = std::max(1, std::stoi(parser.get("r")));
+        global_args.thread = std::max(1, std::stoi(parser.get("t")));
+        global_args.min_mem_length = std::stoi(parser.get("l"));
+    }
+    catch (const std::invalid_argument& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        parser.print_help();
+        return 1;
+    }
+    Scheduler::instance().set_threads(global_args.thread);
+    global_args.verbose = 0;
+    global_args.min_seq_coverage = 1;
+    global_args.bgzf = 0;
+    global_args.output_path = "/dev/null";
+
+    std::vector<BenchResult> results;
+    SequenceStore data;
+    std::vector<std::string> name;
+    double seconds = best_of(repeat, [&]() {
+        data = SequenceStore();
+        name.clear();
+        read_data(global_args.data_path.c_str(), data, name, false);
+    });
+    const uint_t seq_num = data.size();
+    const uint_t n = data.concat_length();
+    if (seq_num < 2) {
+        std::cerr << "Error: the workload needs at least two sequences" << std::endl;
+        return 1;
+    }
+    results.push_back({ "read_input", "bases", n, seconds });
+
+    if (use_index32(n)) {
+        bench_index<uint32_t>(data, repeat, results);
+    }
+    else {
+        bench_index<uint64_t>(data, repeat, results);
+    }
+
+    // SW of 200 base queries of the first sequence against 2000 bases of the others, as expand_chain() does
+    const int query_length = 200, ref_length = 2000;
+    std::vector<std::pair<std::string_view, std::string_view>> pairs;
+    std::mt19937 generator(seq_num);
+    for (uint_t k = 0; k < 256; k++) {
+        uint_t i = 1 + generator() % (seq_num - 1);
+        size_t length = std::min(data.length(0), data.length(i));
+        if (length < (size_t)ref_length) {
+            continue;
+        }
+        size_t begin = generator() % (length - ref_length + 1);
+        pairs.emplace_back(data[0].substr(begin + (ref_length - query_length) / 2, query_length), data[i].substr(begin, ref_length));
+    }
+    uint64_t cells = 0;
+    for (const auto& p : pairs) {
+        cells += (uint64_t)p.first.size() * p.second.size();
+    }
+    seconds = best_of(repeat, [&]() {
+        StripedSmithWaterman::Aligner aligner;
+        StripedSmithWaterman::Filter filter;
+        StripedSmithWaterman::Alignment alignment;
+        for (const auto& p : pairs) {
+            aligner.SetQuerySequence(p.first.data(), p.first.size());
+            aligner.AlignReference(p.second.data(), p.second.size(), filter, &alignment, query_length / 2);
+        }
+    });
+    results.push_back({ std::string("ssw_") + ssw_kernel_name(), "cells", cells, seconds });
+
+    // the output of every sequence in fragments of 100 bases, written to /dev/null
+    std::vector<std::vector<std::string>> fragment;
+    uint64_t bytes = 0;
+    for (uint_t j = 0; j < seq_num; j++) {
+        std::string_view seq = data[j];
+        for (size_t begin = 0, k = 0; begin < seq.size(); begin += 100, k++) {
+            if (fragment.size() <= k) {
+                fragment.emplace_back(seq_num);
+            }
+            fragment[k][j] = std::string(seq.substr(begin, 100));
+        }
+        bytes += seq.size() + name[j].size() + 3;
+    }
+    seconds = best_of(repeat, [&]() {
+        concat_alignment(fragment, name, std::vector<uint_t>());
+    });
+    results.push_back({ "concat_alignment", "bytes", bytes, seconds });
+
+    std::ofstream out(result_path);
+    if (!out.is_open()) {
+        std::cerr << result_path << " fail to open!" << std::endl;
+        return 1;
+    }
+    out << "{\n  \"workload\": \"" << json_escape(global_args.data_path) << "\",\n  \"sequences\": " << seq_num
+        << ",\n  \"bases\": " << n << ",\n  \"threads\": " << global_args.thread << ",\n  \"repeat\": " << repeat
+        << ",\n  \"results\": [";
+    for (size_t k = 0; k < results.size(); k++) {
+        const BenchResult& r = results[k];
+        double per_second = r.seconds > 0 ? r.items / r.seconds : 0;
+        out << (k ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit << "\", \"items\": " << r.items
+            << ", \"seconds\": " << std::setprecision(6) << r.seconds << ", \"per_second\": " << std::setprecision(6) << per_second << "}";
+        std::cout << std::left << std::setw(28) << r.name << std::right << std::setw(12) << std::setprecision(4) << per_second
+            << " " << r.unit << "/s  (" << std::setprecision(3) << r.seconds << " s)" << std::endl;
+    }
+    out << "\n  ]\n}\n";
+    return 0;
+}
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+# Author: Pinglu Zhang
+# Contact: zpl010720@gmail.com
+# Created: 2025-10-14
+"""Compare the results of fmalign2_bench against a baseline.
+
+Prints the throughput of every benchmark next to the baseline and their ratio, and exits with 1 if a
+benchmark is slower than the baseline by more than the tolerance. With --update the results replace
+the baseline instead. A missing baseline is created from the results.
+
+Usage: python compare.py bench/baseline.json bench_result.json [--tolerance 0.2] [--update]
+"""
+import argparse
+import json
+import os
+import shutil
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        doc = json.load(f)
+    return doc, {r["name"]: r for r in doc["results"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare benchmark results against a baseline.")
+    parser.add_argument("baseline", help="stored baseline JSON")
+    parser.add_argument("result", help="JSON written by fmalign2_bench")
+    parser.add_argument("--tolerance", type=float, default=0.2, help="allowed slowdown, 0.2 is 20%%")
+    parser.add_argument("--update", action="store_true", help="store the results as the new baseline")
+    args = parser.parse_args()
+
+    if args.update or not os.path.exists(args.baseline):
+        shutil.copyfile(args.result, args.baseline)
+        print("baseline written to " + args.baseline)
+        return 0
+    base_doc, base = load(args.baseline)
+    doc, result = load(args.result)
+    if base_doc.get("bases") != doc.get("bases") or base_doc.get("threads") != doc.get("threads"):
+        print("warning: the baseline was measured on another workload or thread count")
+    regressions = 0
+    print("%-28s %14s %14s %8s" % ("benchmark", "per second", "baseline", "ratio"))
+    for name, r in result.items():
+        b = base.get(name)
+        if b is None or b["per_second"] <= 0:
+            print("%-28s %14.4g %14s %8s" % (name, r["per_second"], "-", "-"))
+            continue
+        ratio = r["per_second"] / b["per_second"]
+        flag = ""
+        if ratio < 1 - args.tolerance:
+            flag = "  slower"
+            regressions += 1
+        print("%-28s %14.4g %14.4g %8.2f%s" % (name, r["per_second"], b["per_second"], ratio, flag))
+    if regressions:
+        print("%d benchmark(s) slower than the baseline by more than %d%%" % (regressions, round(args.tolerance * 100)))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
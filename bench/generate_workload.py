@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+# Author: Pinglu Zhang
+# Contact: zpl010720@gmail.com
+# Created: 2025-10-14
+"""Scale a FASTA file to a synthetic benchmark workload.
+
+Every output sequence is built from the template sequences: sequence k takes template k, followed by
+further templates until it is L bases long, so all sequences stay homologous segment by segment.
+Each base is then substituted with probability div, and a 1 to 3 base insertion or deletion starts
+there with probability div / 10. A part dup of the sequences are exact copies of an earlier one.
+The sequences are written in blocks of 60 bases per line; the same seed gives the same file.
+
+Usage: python generate_workload.py -i data/mt1x.fasta -n 1000 -l 20000 --div 0.01 --dup 0.05 -o workload.fasta
+"""
+import argparse
+import random
+import sys
+
+BASES = "ACGT"
+
+
+def read_fasta(path):
+    seqs, cur = [], []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            if line[0] == ">":
+                if cur:
+                    seqs.append("".join(cur).upper())
+                cur = []
+            else:
+                cur.append(line)
+    if cur:
+        seqs.append("".join(cur).upper())
+    return seqs
+
+
+def mutate(seq, div, rng):
+    if div <= 0:
+        return seq
+    out = []
+    indel = div / 10
+    i = 0
+    while i < len(seq):
+        r = rng.random()
+        if r < indel / 2:
+            # deletion
+            i += rng.randint(1, 3)
+            continue
+        if r < indel:
+            out.append("".join(rng.choice(BASES) for _ in range(rng.randint(1, 3))))
+        c = seq[i]
+        if rng.random() < div:
+            c = rng.choice([b for b in BASES if b != c])
+        out.append(c)
+        i += 1
+    return "".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Scale a FASTA file to N sequences of length L.")
+    parser.add_argument("-i", "--input", required=True, help="template FASTA, e.g. data/mt1x.fasta")
+    parser.add_argument("-o", "--output", required=True, help="output FASTA")
+    parser.add_argument("-n", "--num", type=int, default=1000, help="number of sequences")
+    parser.add_argument("-l", "--length", type=int, default=0, help="length of every sequence, 0 keeps the template lengths")
+    parser.add_argument("--div", type=float, default=0.01, help="substitution rate per base, indels start at a tenth of it")
+    parser.add_argument("--dup", type=float, default=0.0, help="part of the sequences that copy an earlier sequence")
+    parser.add_argument("--seed", type=int, default=1, help="random seed")
+    args = parser.parse_args()
+
+    templates = read_fasta(args.input)
+    if not templates:
+        sys.exit("no sequences in " + args.input)
+    rng = random.Random(args.seed)
+    written = []
+    bases = 0
+    with open(args.output, "w") as out:
+        for k in range(args.num):
+            if written and rng.random() < args.dup:
+                seq = rng.choice(written)
+            else:
+                seq = templates[k % len(templates)]
+                if args.length > 0:
+                    parts, total, t = [seq], len(seq), k
+                    while total < args.length:
+                        t += 1
+                        parts.append(templates[t % len(templates)])
+                        total += len(parts[-1])
+                    seq = "".join(parts)[:args.length]
+                seq = mutate(seq, args.div, rng)
+                written.append(seq)
+            out.write(">seq%d\n" % k)
+            for p in range(0, len(seq), 60):
+                out.write(seq[p:p + 60] + "\n")
+            bases += len(seq)
+    print("%s: %d sequences, %d bases" % (args.output, args.num, bases))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,70 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the library interface of FMAlign2. An AlignContext holds the options of its
+// alignments instead of global_args: while it aligns, the calling thread and every scheduler task of
+// the alignment read them through current_args(), so several contexts may align at the same time in
+// one process, on the workers of the one scheduler. Input and output stay in memory. The parts of
+// FMAlign2 that belong to a process and not to an alignment are left to the program: the threads of
+// the scheduler, the memory budget, the MSA command check (test_cmd()), the checkpoint, the
+// distributed mode, the index cache and the metrics. A context therefore turns -checkpoint, -dist,
+// -cache and -add off, and -bgzf, -anchors and the paths only concern the command line. An error that
+// ends the program on the command line only fails the alignment of a context, see alignment_failed().
+#ifndef ALIGN_CONTEXT_H
+#define ALIGN_CONTEXT_H
+
+#include "common.h"
+#include "sequence_store.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+class AlignContext {
+public:
+    /**
+    * @brief A context that aligns with the given options.
+    * @param args The options, as the command line sets them in global_args; package must be a checked MSA command.
+    */
+    explicit AlignContext(const GlobalArgs& args);
+
+    // The options of the next alignments.
+    GlobalArgs& args() { return args_; }
+
+    /**
+    * @brief Align sequences. Every call works on its own copy of the options, so calls may run at the same time.
+    * @param data The sequences, replaced by the distinct ones with -dedup 1.
+    * @return The aligned row of every sequence in input order.
+    * @throws std::runtime_error If the alignment fails, e.g. the MSA command or an allocation; the process goes on.
+    */
+    std::vector<std::string> align(SequenceStore& data) const;
+
+    /**
+    * @brief Align the records of FASTA or FASTQ text.
+    * @param text The records.
+    * @return The alignment as FASTA text, the rows in input order.
+    * @throws std::runtime_error If the alignment fails, see align().
+    */
+    std::string align_fasta(std::string_view text) const;
+
+private:
+    GlobalArgs args_;
+};
+
+#endif
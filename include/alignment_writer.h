@@ -0,0 +1,85 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the buffered writer of the final alignment. concat_alignment() streams every
+// row straight from the fragment matrix into it, so the aligned rows are never concatenated in memory.
+// Plain output goes through one large buffer; pieces larger than the buffer are written directly.
+// With -bgzf 1 the output is BGZF, the blocked gzip format of bgzip and samtools: the buffer is cut
+// into blocks of at most BGZF_BLOCK_INPUT bytes, which are deflated in parallel on the scheduler and
+// written in order, followed by the empty end-of-file block. Any gzip reader can read the result.
+// BGZF needs zlib, see HAVE_ZLIB in the Makefile.
+#ifndef ALIGNMENT_WRITER_H
+#define ALIGNMENT_WRITER_H
+
+#include "common.h"
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// bytes buffered before they are written, for BGZF this is a batch of blocks compressed together
+#define WRITER_BUFFER_SIZE (4 << 20)
+// uncompressed bytes in one BGZF block, as in htslib, so a compressed block always fits in 64 KiB
+#define BGZF_BLOCK_INPUT 0xff00
+
+class AlignmentWriter {
+public:
+    /**
+    * @brief Open a file for writing.
+    * @param path The output path.
+    * @param bgzf Write BGZF compressed output instead of plain text.
+    * @param level The zlib compression level of BGZF output, 1 to 9.
+    */
+    AlignmentWriter(const std::string& path, bool bgzf = false, int level = 6);
+    ~AlignmentWriter();
+
+    bool is_open() const { return file_ != NULL; }
+
+    /**
+    * @brief Append bytes to the output.
+    * @param data The bytes.
+    */
+    void write(std::string_view data);
+
+    void put(char c) {
+        if (buffer_.size() == buffer_.capacity()) {
+            flush_buffer();
+        }
+        buffer_.push_back(c);
+    }
+
+    /**
+    * @brief Write everything that is buffered, and the end-of-file block of BGZF output, and close the file.
+    * @return False if a write failed.
+    */
+    bool close();
+
+private:
+    void flush_buffer();
+    void write_file(const void* data, size_t size);
+
+    FILE* file_;
+    bool bgzf_;
+    int level_;
+    bool failed_;
+    std::vector<char> buffer_;
+};
+
+#endif
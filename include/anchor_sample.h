@@ -0,0 +1,62 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the sampled anchor mode (-sample). Instead of one suffix array over all
+// sequences, find_mem() runs on a sample of them, so the index and the MEM chain grow with the sample
+// size and not with the input. The sample is either random or diverse: every sequence is sketched by
+// the smallest hashes of its k-mers and the sample is picked farthest first, each new member being the
+// sequence least similar to the members so far. The anchors of the sample chain are then placed on the
+// other sequences by exact search, in parallel, each one in a window after the anchor before it.
+// Anchors that are not found keep the begin -1 and are placed by the Smith-Waterman rescue of
+// expand_chain(), as the chains missing in a sequence always were.
+#ifndef ANCHOR_SAMPLE_H
+#define ANCHOR_SAMPLE_H
+
+#include "common.h"
+#include "sequence_store.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+// k-mer length and number of hashes kept in the sketch of a sequence
+#define SKETCH_KMER 16
+#define SKETCH_SIZE 64
+// the exact search of an anchor covers twice its longest distance to the anchor before it in the sample, plus this
+#define ANCHOR_SEARCH_SLACK 100
+
+/**
+* @brief Choose the sequences the anchors are found on.
+* @param data The sequences.
+* @param sample_size The number of sequences to choose, at most data.size().
+* @param mode "random" for a uniform sample, "sketch" for a diverse sample by k-mer sketches.
+* @return The indices of the chosen sequences in increasing order.
+*/
+std::vector<uint_t> select_sample(const SequenceStore& data, uint_t sample_size, const std::string& mode);
+
+/**
+* @brief Find the MEM chain on a sample of the sequences and place it on all of them.
+* @param data The sequences.
+* @param sample_size The number of sequences the MEMs are found on.
+* @param mode How the sample is chosen, see select_sample().
+* @return The chains of every sequence as find_mem() returns them, begin -1 where an anchor was not found.
+*/
+std::vector<std::vector<std::pair<int_t, int_t>>> find_sampled_mem(const SequenceStore& data, uint_t sample_size, const std::string& mode);
+
+#endif
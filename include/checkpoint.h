@@ -0,0 +1,102 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the checkpoint of a run (-checkpoint, -resume). Three kinds of results are
+// kept in the checkpoint folder, each written through a renamed temporary file as soon as it exists:
+// chains.bin   the split points found by find_mem() or find_sampled_mem(),
+// expanded.bin the chains after the SW expansion and their aligned strings,
+// frag-*.bin   the alignment of every fragment the MSA backend aligned, named by a hash of the
+//              command template and the fragment FASTA.
+// The first two record a key of the sequences and the options they depend on and are only read back
+// by a run with the same key. A fragment is found again by its content at any recursion level.
+// With a checkpoint a failed backend call no longer ends the run: the other jobs finish and are
+// kept, and the run stops before writing the alignment, so that -resume only redoes what failed.
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "common.h"
+#include "sequence_store.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+#define CHECKPOINT_MAGIC "FMALCKPT"
+#define CHECKPOINT_VERSION 1
+
+/**
+* @brief Start checkpointing into current_args().checkpoint_dir, if it is set; the folder is created.
+* An AlignContext has no checkpoint folder and leaves the checkpoint of the command line alone.
+* @param data The sequences that are aligned, after deduplication.
+*/
+void checkpoint_start(const SequenceStore& data);
+
+// True if results are written to a checkpoint.
+bool checkpoint_enabled();
+
+/**
+* @brief Read the split points back with -resume.
+* @param chain Receives the chains of every sequence.
+* @return False if there is no checkpoint of them for these sequences and options.
+*/
+bool checkpoint_load_chains(std::vector<std::vector<std::pair<int_t, int_t>>>& chain);
+
+/**
+* @brief Keep the split points.
+* @param chain The chains of every sequence, as find_mem() returns them.
+*/
+void checkpoint_save_chains(const std::vector<std::vector<std::pair<int_t, int_t>>>& chain);
+
+/**
+* @brief Read the expanded chains back with -resume.
+* @param column Receives column[k][i], chain k of sequence i after the SW expansion.
+* @param chain_string Receives the aligned strings of the chains, chain_string[k][i].
+* @return False if there is no checkpoint of them for the current split points.
+*/
+bool checkpoint_load_expanded(std::vector<std::vector<std::pair<int_t, int_t>>>& column, std::vector<std::vector<std::string>>& chain_string);
+
+/**
+* @brief Keep the expanded chains.
+* @param column column[k][i] is chain k of sequence i after the SW expansion.
+* @param chain_string The aligned strings of the chains, chain_string[k][i].
+*/
+void checkpoint_save_expanded(const std::vector<const std::vector<std::pair<int_t, int_t>>*>& column, const std::vector<std::vector<std::string>>& chain_string);
+
+/**
+* @brief Read the alignment of a fragment back with -resume.
+* @param fasta The fragment in FASTA format.
+* @param aligned_seq Receives the aligned sequences in input order.
+* @return False if the fragment has not been aligned before.
+*/
+bool checkpoint_load_fragment(const std::string& fasta, std::vector<std::string>& aligned_seq);
+
+/**
+* @brief Keep the alignment of a fragment.
+* @param fasta The fragment in FASTA format.
+* @param aligned_seq The aligned sequences in input order.
+*/
+void checkpoint_save_fragment(const std::string& fasta, const std::vector<std::string>& aligned_seq);
+
+// Count a backend call that failed; the run goes on and stops before writing the alignment.
+void checkpoint_fragment_failed();
+
+// The number of backend calls that failed.
+uint_t checkpoint_failures();
+
+#endif
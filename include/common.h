@@ -27,34 +27,20 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#if (defined(__linux__))
-#include "thread_pool.h"
-#else
-#include <omp.h>
+#if (defined(_WIN32))
 #include <windows.h>
 #endif
 #include <iomanip>
 #include <thread>
 
-#ifndef M64
-	#define M64 0
-#endif
-// Considering that the concatenated input sequence can be too long and to save memory.
-// different data types are defined through conditional compilation for different sizes of data.
-// if data is larger than 2GB, M64 should be selected.
-#if M64
-	typedef int64_t	int_t;
-	typedef uint64_t uint_t;
-	#define U_MAX	UINT64_MAX
-	#define I_MAX	INT64_MAX
-	#define I_MIN	INT64_MIN
-#else
-	typedef int32_t int_t;
-	typedef uint32_t uint_t;
-	#define U_MAX	UINT32_MAX
-	#define I_MAX	INT32_MAX
-	#define I_MIN	INT32_MIN
-#endif
+// Positions in the sequences, the chains and the fragments are 64 bit, so one binary takes inputs of
+// any size. The suffix index and the MEM table, the only arrays as long as the input, are 32 bit
+// whenever the concatenated input allows it; find_mem() picks their width at run time (see suffix_index.h).
+typedef int64_t	int_t;
+typedef uint64_t uint_t;
+#define U_MAX	UINT64_MAX
+#define I_MAX	INT64_MAX
+#define I_MIN	INT64_MIN
 
 #ifndef DEBUG
   #define DEBUG 0
@@ -70,9 +56,44 @@ struct GlobalArgs {
 	int_t degree;
 	std::string filter_mode;
 	int_t verbose;
-	double avg_file_size;
+	std::string tmp_folder; // folder for fragment files when the MSA template needs {input}/{output}
+	std::string index_mode; // "full" keeps SA, LCP and DA, "lean" keeps SA and a thresholded LCP
+	int_t index_cache; // 1 to load/store the suffix index in <input>.fmidx
+	int_t small_fragment; // fragments up to this total length are aligned in-process, 0 to disable
+	double trivial_mismatch; // part of the bases rows of equal length may differ in and still be written without the MSA backend
+	int_t dedup; // 1 to align identical sequences and identical fragment rows only once
+	std::string cost_log; // file for the predicted and measured cost of every MSA job, empty for none
+	int_t bgzf; // 1 to write the alignment BGZF compressed
+	int_t sw_window; // half width of the first window the SW expansion searches around the expected position, 0 for the whole gap
+	int_t recursive_depth; // levels of MEM splitting below the input for gap regions longer than recursive_length, 0 to disable
+	int_t recursive_length; // longest row of a gap region that is sent to the MSA backend unsplit
+	int_t sample_size; // number of sequences the MEMs are found on, 0 to use all of them
+	std::string sample_mode; // "sketch" or "random", how the sequences of sample_size are chosen
+	std::string dist_mode; // "none", "mpi", or a stage of the job array mode: "prepare", "work" or "merge"
+	std::string dist_dir; // folder of the fragment files, the manifest and the job script of the job array mode
+	int_t dist_tasks; // array tasks of the job script written by -dist prepare
+	std::string dist_part; // "i/n" to align part i of n of the manifest, "auto" to take it from SLURM
+	std::string checkpoint_dir; // folder the split points, expanded chains and fragment alignments are kept in, empty for none
+	int_t resume; // 1 to reuse the results in checkpoint_dir and only redo what is missing
+	uint64_t max_mem; // memory the run and its MSA jobs may use together in bytes, 0 for no limit
+	int_t anchors; // 1 to write the anchor file <output>.anchors that -add needs
+	std::string add_path; // sequences -add puts into the alignment given by -i, empty for a normal run
 };
 extern GlobalArgs global_args;
 
+// The options of the alignment the calling thread works on: those set by set_thread_args(), see AlignContext,
+// otherwise global_args. The scheduler runs every task with the options of the thread that queued it.
+GlobalArgs& current_args();
+
+// The options set for the calling thread, NULL if it uses global_args.
+GlobalArgs* thread_args();
+
+// Set the options of the calling thread, NULL for global_args.
+void set_thread_args(GlobalArgs* args);
+
+// End an alignment that cannot go on, after its error was printed: the program exits with code 1, but an alignment
+// of an AlignContext (thread_args() is set) throws std::runtime_error(message) instead, so only it fails.
+[[noreturn]] void alignment_failed(const std::string& message);
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-15
+
+// This header declares the service mode (-daemon), for workloads of many small alignments where
+// starting the program, the scheduler threads and the MSA command check would cost more than the
+// alignment itself. The daemon does all of that once and then aligns the jobs of its clients on a
+// Unix domain socket, every job with an AlignContext of its own, so jobs run at the same time.
+// A job is plain text:
+//   FMAlign2-job 1
+//   <option> <value>      any of l, f, index, small, trivial_mismatch, dedup, sw_window, rec_depth, rec_len, sample, sample_mode
+//   input <bytes>
+//   <bytes of FASTA or FASTQ records>
+// and the answer is "ok <bytes>\n" followed by the alignment as FASTA, or "error <message>\n".
+// A line may have at most DAEMON_MAX_LINE bytes and the input at most -daemon_max_input bytes. One
+// job per scheduler thread is served at a time, the next clients wait until one of them ends.
+// The -client mode sends -i with the options of its command line and writes the answer to -o.
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <cstdint>
+#include <string>
+
+#define DAEMON_PROTOCOL "FMAlign2-job"
+#define DAEMON_PROTOCOL_VERSION 1
+#define DAEMON_MAX_LINE 4096         // longest line of a request, '\n' excluded
+#define DAEMON_RECEIVE_TIMEOUT 60    // seconds a client may send nothing before its job is dropped
+
+/**
+* @brief Serve alignment jobs on a Unix domain socket until the process is stopped.
+* @param socket_path The socket, replaced if it exists.
+* @param max_input The largest input of a job in bytes.
+* @return The exit code of the program.
+*/
+int run_daemon(const std::string& socket_path, uint64_t max_input);
+
+/**
+* @brief Align global_args.data_path by a daemon and write the alignment to global_args.output_path.
+* @param socket_path The socket of the daemon.
+* @return The exit code of the program.
+*/
+int run_client(const std::string& socket_path);
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the distributed mode (-dist), which runs the MSA backend jobs on other nodes.
+// The anchors, the SW expansion and the in-process fragments stay with one process, the coordinator;
+// only the fragments that would be sent to the backend are handed out.
+// mpi: started by mpirun, rank 0 is the coordinator and every other rank a worker that aligns one
+//      fragment at a time with -t backend threads and sends the rows back. Needs a build with MPI=1.
+// prepare, work, merge: for cluster job arrays. prepare writes every backend fragment to -dist_dir
+//      with a manifest and a SLURM array script, work aligns a part of the manifest on a node, and
+//      merge repeats the anchor phase, which is deterministic, and reads the aligned fragments back.
+// A fragment file is named by a hash of its FASTA, so the stages find the same fragments again
+// whatever order the jobs ran in, and a worker skips the fragments that are already aligned.
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include "common.h"
+#include <string>
+#include <vector>
+
+// array tasks in the SLURM script written by -dist prepare, at most one per fragment
+#define DIST_DEFAULT_TASKS 64
+
+/**
+* @brief Start the distributed mode chosen by global_args.dist_mode; MPI is initialized here.
+* @param msa_arg The -p argument, passed on to the workers of the job array.
+* @param argv0 The path the program was started by.
+*/
+void dist_start(const std::string& msa_arg, const char* argv0);
+
+// True if this process only aligns fragments for a coordinator: an MPI rank above 0 or -dist work.
+bool dist_is_worker();
+
+// True if this process runs the MSA backend itself, and its command template must be checked.
+bool dist_runs_backend();
+
+/**
+* @brief Align fragments for the coordinator until it is done: serve an MPI coordinator or work through a part of the manifest.
+* @return The exit code of the program.
+*/
+int dist_run_worker();
+
+/**
+* @brief The number of MSA jobs that may run at once at the top level: the workers in MPI mode, otherwise -t.
+* @param max_job_threads Receives the most threads one job is given, 0 for no limit.
+* @return The thread budget of the MSA job queue.
+*/
+int dist_job_slots(int& max_job_threads);
+
+/**
+* @brief Align a fragment the distributed way: on an MPI worker, into the manifest, or from the aligned fragment files.
+* @param fasta The fragment in FASTA format.
+* @param aligned_seq Receives the aligned sequences in input order.
+* @return False if the fragment is to be aligned by the local backend.
+*/
+bool dist_align_fragment(const std::string& fasta, std::vector<std::string>& aligned_seq);
+
+// True if the alignment is written by this run, false for -dist prepare, which only writes the fragments.
+bool dist_writes_alignment();
+
+/**
+* @brief Finish the coordinator: stop the MPI workers, or write the manifest and the job script of -dist prepare.
+*/
+void dist_finish();
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the reader of the input sequences. Plain FASTA/FASTQ is mapped with mmap;
+// gzip input is inflated in batches and BGZF input (bgzip) in parallel, one block per task, since
+// every BGZF block records its compressed and uncompressed size. The text is parsed in a single
+// pass that copies each sequence line through a 256 entry table straight into the SequenceStore:
+// A, C, G, T and U in either case become upper case and every other byte becomes N, the same
+// normalization clean_sequence() does. The records follow the conventions of kseq: a header starts
+// with > or @ at the beginning of a line, the name is the header with its first white space removed,
+// empty lines and a trailing \r are skipped, and a FASTQ quality string is skipped by its length.
+#ifndef FASTA_READER_H
+#define FASTA_READER_H
+
+#include "common.h"
+#include "sequence_store.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// uncompressed bytes of gzip input that are parsed at a time
+#define READER_BATCH_SIZE (32 << 20)
+
+/**
+* @brief Read every record of a FASTA or FASTQ file, plain, gzip or BGZF compressed.
+* @param path The input file.
+* @param data Receives the normalized sequences.
+* @param name Receives the sequence names.
+* @return The number of bases read.
+*/
+uint64_t read_sequences(const char* path, SequenceStore& data, std::vector<std::string>& name);
+
+/**
+* @brief Read the rows of an aligned FASTA file like read_sequences(), but keep the gaps '-'.
+* @param path The alignment file.
+* @param rows Receives the normalized rows.
+* @param name Receives the sequence names.
+* @return The number of characters read, gaps included.
+*/
+uint64_t read_alignment(const char* path, SequenceStore& rows, std::vector<std::string>& name);
+
+/**
+* @brief Parse FASTA or FASTQ text that is already in memory, like read_sequences() parses a plain file.
+* @param text The records.
+* @param data Receives the normalized sequences.
+* @param name Receives the sequence names.
+* @return The number of bases read.
+*/
+uint64_t parse_sequences(std::string_view text, SequenceStore& data, std::vector<std::string>& name);
+
+#endif
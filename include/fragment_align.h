@@ -0,0 +1,136 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the in-process path for gap fragments that do not need the external MSA backend.
+// Trivial fragments (all rows empty, or one non-empty row) are written out directly, and so are rows of
+// equal length if -trivial_mismatch allows their substitutions. Small fragments, up to -small bytes in
+// total, are aligned by a progressive sequence-to-profile aligner with the scores of the SSW aligner
+// that expands the chains, see fragment_scores(); N scores 0 against everything.
+#ifndef FRAGMENT_ALIGN_H
+#define FRAGMENT_ALIGN_H
+
+#include "common.h"
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Residue classes of the profile: A, C, G, T/U and everything else (N).
+#define PROFILE_CLASSES 5
+// Trace cells, one byte each, of a sequence-to-profile DP above which only a band around the diagonal is computed.
+#define PROFILE_MAX_TRACE_CELLS (1ULL << 26)
+// The narrowest half width of such a band in columns.
+#define PROFILE_MIN_BAND 64
+
+enum FragmentKind {
+    FRAGMENT_TRIVIAL,   // aligned by align_trivial_fragment()
+    FRAGMENT_SMALL,     // aligned by progressive_align()
+    FRAGMENT_HARD       // sent to the MSA backend
+};
+
+// Scores of the in-process aligners, all positive: a base scores match or -mismatch, a gap of length L -(gap_open + (L - 1) * gap_extend).
+struct FragmentScores {
+    int match;
+    int mismatch;
+    int gap_open;
+    int gap_extend;
+};
+
+// Column frequencies of aligned rows.
+struct ProfileColumn {
+    std::array<uint_t, PROFILE_CLASSES> count;
+    uint_t residues;    // rows with a base in this column
+};
+
+// Operations of align_to_profile(): the row base against a column, a column against a gap, a row base against a new gap column.
+enum { TRACE_MATCH = 0, TRACE_COLUMN = 1, TRACE_ROW = 2 };
+
+/**
+* @brief The scores of the default StripedSmithWaterman::Aligner, which expand_chain() aligns with.
+* @return The scores.
+*/
+const FragmentScores& fragment_scores();
+
+/**
+* @brief Decide how a fragment is aligned.
+* @param rows The distinct rows of the fragment.
+* @param small_limit The largest total length aligned in-process, 0 to send every non-trivial fragment to the backend.
+* @param max_mismatch The part of the bases in which rows of equal length may differ from the first row and still be
+*        written as they are, 0 to take only rows without substitutions.
+* @return The kind of the fragment.
+*/
+FragmentKind classify_fragment(const std::vector<std::string_view>& rows, uint64_t small_limit, double max_mismatch);
+
+/**
+* @brief Align a trivial fragment: rows of equal length stay as they are, empty rows are filled with gaps.
+* @param rows The distinct rows of a fragment classified as FRAGMENT_TRIVIAL.
+* @param aligned Receives the aligned rows in the order of rows.
+*/
+void align_trivial_fragment(const std::vector<std::string_view>& rows, std::vector<std::string>& aligned);
+
+/**
+* @brief Add an aligned row to the column frequencies of a profile.
+* @param profile The profile, as long as the row.
+* @param row The aligned row.
+*/
+void add_to_profile(std::vector<ProfileColumn>& profile, std::string_view row);
+
+/**
+* @brief Global alignment with affine gaps of a row against the column frequencies of a profile.
+* The scores are averaged over row_num rows: a base scores the match and mismatch scores of the profile rows it
+* meets in a column, gap columns and N score 0.
+* @param row The row to align, without gaps.
+* @param profile The profile.
+* @param row_num The number of rows the profile was built from, at least 1.
+* @return The operations from left to right, TRACE_MATCH, TRACE_COLUMN or TRACE_ROW.
+*/
+std::vector<unsigned char> align_to_profile(std::string_view row, const std::vector<ProfileColumn>& profile, uint_t row_num);
+
+/**
+* @brief Global alignment with affine gaps of a row against a profile whose columns come from different numbers of rows.
+* The scores of every column are averaged over its own rows. If the whole DP matrix has more than max_cells cells,
+* only a band around its diagonal is computed, so the trace needs about max_cells bytes, see profile_trace_cells().
+* @param row The row to align, without gaps.
+* @param profile The profile.
+* @param column_rows The number of rows every column was built from.
+* @param max_cells The trace cells above which the DP is banded.
+* @return The operations from left to right, TRACE_MATCH, TRACE_COLUMN or TRACE_ROW.
+*/
+std::vector<unsigned char> align_to_profile(std::string_view row, const std::vector<ProfileColumn>& profile,
+    const std::vector<uint_t>& column_rows, uint64_t max_cells);
+
+/**
+* @brief The number of trace cells, one byte each, that align_to_profile() keeps for a row of n bases and m profile columns.
+* @param n The length of the row.
+* @param m The number of profile columns.
+* @param max_cells The trace cells above which the DP is banded.
+* @return The number of cells.
+*/
+uint64_t profile_trace_cells(size_t n, size_t m, uint64_t max_cells);
+
+/**
+* @brief Align the rows progressively, the longest row first and every other row against the profile of the rows before it.
+* Each step is a global alignment with affine gaps of the row against the column frequencies of the profile.
+* @param rows The rows to align.
+* @param aligned Receives the aligned rows in the order of rows.
+*/
+void progressive_align(const std::vector<std::string_view>& rows, std::vector<std::string>& aligned);
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the incremental mode (-add), which adds new sequences to an alignment of an
+// earlier run instead of aligning everything again. With -anchors 1 a run writes the anchor file
+// <output>.anchors next to the alignment: the column range of every expanded chain in the output,
+// the columns between them being the gap regions. -add reads the alignment and its anchor file back
+// and takes every anchor from a row of the alignment that holds it. The anchors are placed on the new
+// sequences only, by exact search and the Smith-Waterman rescue of expand_chain(), and the parts of the
+// new sequences are aligned against the profile of the columns they fall into, see seq2profile_tasks().
+// The old rows are never realigned, they only get the gap columns of the insertions of the new ones,
+// so the cost grows with the new sequences and not with the alignment. No MSA backend is called.
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "common.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+#define ANCHOR_FILE_SUFFIX ".anchors"
+#define ANCHOR_FILE_MAGIC "FMAlign2-anchors"
+#define ANCHOR_FILE_VERSION 1
+// A part of a new sequence between its placed anchors is not aligned if the whole DP against its columns would have
+// more cells than this: seq2profile_tasks() would only compute a band far narrower than the part, see align_to_profile().
+#define ADD_MAX_TASK_CELLS (1ULL << 34)
+
+/**
+* @brief Write the anchor file of an alignment.
+* @param path The anchor file, the alignment path with ANCHOR_FILE_SUFFIX.
+* @param concat_string The aligned fragments, gap regions and chains in turn as align_chains() returns them.
+* @param row_num The number of rows written to the alignment.
+* @return False if the file could not be written.
+*/
+bool write_anchor_file(const std::string& path, const std::vector<std::vector<std::string>>& concat_string, uint_t row_num);
+
+/**
+* @brief Read the anchor file of an alignment.
+* @param path The anchor file.
+* @param row_num The number of rows of the alignment, checked against the file.
+* @param width The number of columns of the alignment, checked against the file.
+* @param anchor_column Receives the column range [begin, end) of every chain.
+* @return False if the file is missing or does not belong to the alignment.
+*/
+bool read_anchor_file(const std::string& path, uint_t row_num, uint_t width, std::vector<std::pair<uint_t, uint_t>>& anchor_column);
+
+/**
+* @brief Add the sequences of add_path to the alignment of alignment_path and write the result to global_args.output_path.
+* @param alignment_path The alignment of an earlier run with its anchor file.
+* @param add_path The new sequences.
+*/
+void add_sequences(const std::string& alignment_path, const std::string& add_path);
+
+#endif
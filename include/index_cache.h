@@ -0,0 +1,103 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the on-disk cache of the suffix index built by find_mem.
+// The file stores SA, optionally LCP and DA, and the sequence bounds behind a versioned header:
+//   magic "FMIDX\0\0\0" | version | index width in bytes | n | sequence number | hash of the text | flags
+// followed by the bounds (uint64_t each), SA, LCP and DA. The index does not depend on -l or -f,
+// so one file serves every parameter sweep on the same input. On POSIX systems the file is mapped
+// with mmap, so a cache hit costs no construction and only the pages that are used are read.
+#ifndef INDEX_CACHE_H
+#define INDEX_CACHE_H
+
+#include "common.h"
+#include "suffix_index.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define INDEX_CACHE_VERSION 1
+// flags of the cache header
+#define INDEX_CACHE_HAS_LCP 1
+#define INDEX_CACHE_HAS_DA 2
+
+template <typename Index>
+struct IndexCache {
+    const Index* SA = NULL;
+    const IndexInt<Index>* LCP = NULL;    // NULL if the file was written by a lean run
+    const int32_t* DA = NULL;   // NULL if the file was written by a lean run
+    void* base = NULL;          // mapped (or read) file content
+    size_t size = 0;            // size of base in bytes
+    bool mapped = false;        // base comes from mmap, otherwise from malloc
+};
+
+/**
+* @brief Get the path of the index cache that belongs to an input file.
+* @param data_path The path of the input FASTA file.
+* @return data_path followed by ".fmidx".
+*/
+std::string index_cache_path(const std::string& data_path);
+
+/**
+* @brief Hash the concatenated text, used to detect that the cached index is stale.
+* @param data The concatenated sequences.
+* @param n The length of data.
+* @return 64 bit hash value.
+*/
+uint64_t index_cache_hash(const unsigned char* data, uint64_t n);
+
+/**
+* @brief Load the index cache if it matches the text.
+* The header must have the current version and index width, and the length, sequence number,
+* hash and sequence bounds must all match, otherwise the file is ignored.
+* @param path The cache file.
+* @param concat_data The concatenated sequences the index must belong to.
+* @param n The length of concat_data.
+* @param bounds The begin position of every sequence in concat_data.
+* @param need_lcp_da True if LCP and DA are required; a file without them is then treated as a miss.
+* @param cache Receives the arrays on success.
+* @return True on a cache hit, otherwise false.
+*/
+template <typename Index>
+bool load_index_cache(const std::string& path, const unsigned char* concat_data, Index n, const std::vector<uint_t>& bounds, bool need_lcp_da, IndexCache<Index>& cache);
+
+/**
+* @brief Write the index to the cache file.
+* The file is written to a temporary file next to path first and then renamed, so that a concurrent or interrupted run never sees half a file.
+* @param path The cache file.
+* @param concat_data The concatenated sequences.
+* @param n The length of concat_data.
+* @param bounds The begin position of every sequence in concat_data.
+* @param SA The suffix array.
+* @param LCP The LCP array, may be NULL.
+* @param DA The document array, may be NULL.
+* @return True if the file was written, otherwise false.
+*/
+template <typename Index>
+bool save_index_cache(const std::string& path, const unsigned char* concat_data, Index n, const std::vector<uint_t>& bounds, const Index* SA, const IndexInt<Index>* LCP, const int32_t* DA);
+
+/**
+* @brief Release the memory of a loaded index cache.
+* @param cache The cache returned by load_index_cache().
+*/
+template <typename Index>
+void release_index_cache(IndexCache<Index>& cache);
+
+#endif
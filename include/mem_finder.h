@@ -22,14 +22,15 @@
 #define MEM_FINDER_H
 
 #include "common.h"
-#include "gsacak.h"
+#include "suffix_index.h"
+#include "parallel_sa.h"
+#include "index_cache.h"
 #include "utils.h"
+#include "sequence_store.h"
+#include "scheduler.h"
 #include <cstdint>
 #include <cstring>
 #include <numeric>
-#ifdef __linux__
-    #include <omp.h>
-#endif
 #include <sstream>
 #include <fstream>
 #include <cmath>
@@ -37,27 +38,46 @@
 #include <vector>
 #include <unordered_map>
 #include <sstream>
-struct sub_string {
-    int_t sequence_index; // the sequence index that substring in
-    uint_t position; // the begin position in the seqence
-    uint_t* mem_index; // the unique index
-};
+// Columnar MEM table: the occurrences of all MEMs are stored contiguously, MEM i owns [offset[i], offset[i+1]).
+// The index of a MEM is its row in the table. Positions and lengths have the width of the suffix index.
+template <typename Index>
+struct MemTable {
+    std::vector<IndexInt<Index>> sequence_index; // the sequence index of every occurrence
+    std::vector<Index> position; // the begin position of every occurrence in its sequence
+    std::vector<Index> offset; // MEM i has the occurrences [offset[i], offset[i+1])
+    std::vector<IndexInt<Index>> mem_length; // substring length, -1 if the MEM is discarded
+    std::vector<float> avg_pos; // average position in sequences, initially set to -1
 
-struct mem {
-    int_t mem_length; // substring length
-    uint_t* mem_index; // the unique index
-    float avg_pos = -1; // average position in sequences, initially set to -1
-    std::vector<sub_string> substrings; // the substring set
+    uint_t size() const { return mem_length.size(); }
+    uint_t occurrence_num(uint_t i) const { return offset[i + 1] - offset[i]; }
 };
 
+// Values of the thresholded LCP array used by the lean index: LCP[i] compared to min_mem_length.
+#define LCP_BELOW 0
+#define LCP_EQUAL 1
+#define LCP_ABOVE 2
+
+template <typename Index>
 struct IntervalToMemConversionParams {
-    const uint_t* SA;
-    const int32_t* DA;
+    const Index* SA;
+    const int32_t* DA; // NULL in lean mode, the sequence is then found in joined_sequence_bound
     const unsigned char* concat_data;
-    std::vector<mem>::iterator result_store;
+    MemTable<Index>* result_store; // offset must already be set, the occurrences of row mem_index are filled
+    uint_t mem_index;
+    int_t min_mem_length;
+    std::pair<Index, Index> interval;
+    const std::vector<uint_t>* joined_sequence_bound;
+};
+
+// Settings of one find_mem() run. The run on the input takes them from global_args, the recursive runs on
+// oversized gap fragments (see -rec_depth) use a shorter MEM length and leave global_args alone.
+struct MemFinderOptions {
     int_t min_mem_length;
-    std::pair<uint_t, uint_t> interval;
-    std::vector<uint_t> joined_sequence_bound;
+    std::string filter_mode; // "accurate" or "fast"
+    std::string index_mode; // "full" or "lean"
+    int_t thread; // threads of the suffix array builder
+    bool index_cache; // load/store the suffix index of the input file, see -cache
+    bool verbose;
 };
 
 struct FindOptimalChainParams {
@@ -68,37 +88,39 @@ struct FindOptimalChainParams {
 * @brief DP Only Once!Filter out overlapping memory regions and generate split points for each sequence.
 * Given a vector of memory regions and the number of sequences, this function removes any
 * overlapping memory regions and generates split points for each sequence based on the non-overlapping regions.
-* @param mems Vector of memory regions.
+* @param mems Table of memory regions.
 * @param sequence_num Number of sequences.
 * @return Vector of split points for each sequence.
 */
-std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_fast(std::vector<mem>& mems, uint_t sequence_num);
+template <typename Index>
+std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_fast(MemTable<Index>& mems, uint_t sequence_num);
 
 /**
 * @brief DP sequence number times!Filter out overlapping memory regions and generate split points for each sequence.
 * Given a vector of memory regions and the number of sequences, this function removes any
 * overlapping memory regions and generates split points for each sequence based on the non-overlapping regions.
-* @param mems Vector of memory regions.
+* @param mems Table of memory regions.
 * @param sequence_num Number of sequences.
 * @return Vector of split points for each sequence.
 */
-std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_accurate(std::vector<mem>& mems, uint_t sequence_num);
+template <typename Index>
+std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_accurate(MemTable<Index>& mems, uint_t sequence_num);
 
 /**
  * @brief Find MEMs in a set of sequences.
- * @param data A vector of strings representing the sequences.
+ * @param data The sequence store, its concatenated text is indexed in place.
  * @return Vector of split points for each sequence.
  */
-std::vector<std::vector<std::pair<int_t, int_t>>> find_mem(std::vector<std::string> data);
+std::vector<std::vector<std::pair<int_t, int_t>>> find_mem(const SequenceStore& data);
 
 /**
- * @brief Concatenates a vector of strings with separator 1 and a terminating 0.
- * @param strings The vector of strings to concatenate.
- * @param n A reference to the total length of the concatenated string.
- * @return A pointer to the concatenated string.
- * @note The returned string must be deleted by the caller.
-*/
-unsigned char* concat_strings(const std::vector<std::string>& strings, uint_t &n);
+ * @brief Find MEMs in a set of sequences with the given settings, global_args is not modified.
+ * The suffix index and the MEM table are 32 bit if the concatenated text is short enough, see use_index32().
+ * @param data The sequence store, its concatenated text is indexed in place.
+ * @param options The MEM length, filter and index settings of this run.
+ * @return Vector of split points for each sequence.
+ */
+std::vector<std::vector<std::pair<int_t, int_t>>> find_mem(const SequenceStore& data, const MemFinderOptions& options);
 
 /**
  * @brief an LCP (Longest Common Prefix) array and a threshold value,
@@ -109,21 +131,73 @@ unsigned char* concat_strings(const std::vector<std::string>& strings, uint_t &n
  * @param min_cross_sequence the min number of crossed sequence
  * @return  The output vector of pairs representing the LCP intervals
 */
-std::vector<std::pair<uint_t, uint_t>> get_lcp_intervals(int_t* lcp_array, int_t threshold, int_t min_cross_sequence, uint_t n);
+template <typename Index>
+std::vector<std::pair<Index, Index>> get_lcp_intervals(const IndexInt<Index>* lcp_array, int_t threshold, int_t min_cross_sequence, Index n);
+
+/**
+ * @brief Same as get_lcp_intervals() above, but on an LCP array thresholded by threshold_lcp().
+ * @param lcp_flags The thresholded LCP array, every value is LCP_BELOW, LCP_EQUAL or LCP_ABOVE
+ * @param min_cross_sequence the min number of crossed sequence
+ * @param n The length of the array
+ * @return  The output vector of pairs representing the LCP intervals
+*/
+template <typename Index>
+std::vector<std::pair<Index, Index>> get_lcp_intervals(const unsigned char* lcp_flags, int_t min_cross_sequence, Index n);
+
+/**
+ * @brief Computes the LCP array of the lean index, where each value only tells whether
+ * lcp(SA[i], SA[i-1]) is below, equal to or above the threshold.
+ * At most threshold+1 characters are compared per suffix, the comparison stops at separators like gsacak does.
+ * @param concat_data The concatenated sequences
+ * @param SA The suffix array
+ * @param n The length of the concatenated sequences
+ * @param threshold The threshold value, i.e. the minimal MEM length
+ * @return The thresholded LCP array of length n, to be released with free()
+*/
+template <typename Index>
+unsigned char* threshold_lcp(const unsigned char* concat_data, const Index* SA, Index n, int_t threshold);
 
 /**
 *@brief This function converts an LCP interval to a MEM (Maximal Exact Match).
-*@param arg A void pointer to the input parameters.
+*@param arg A void pointer to the input parameters, an IntervalToMemConversionParams<Index>.
 *@return void* A void pointer to the result, which is stored in the input parameters structure.
 */
+template <typename Index>
 void* interval2mem(void* arg);
 
+/**
+ * @brief Find the LCP intervals and convert them to MEMs in one parallel pass over chunks of the LCP array.
+ * The lean index is thresholded on the fly instead of by threshold_lcp().
+ * The MEMs come out in the same order as the intervals of get_lcp_intervals().
+ * @param SA The suffix array
+ * @param DA The document array, NULL in lean mode
+ * @param LCP The LCP array, NULL in lean mode, the LCP is then compared to min_mem_length on the fly
+ * @param concat_data The concatenated sequences
+ * @param n The length of the concatenated sequences
+ * @param min_mem_length The minimal MEM length
+ * @param min_cross_sequence the min number of crossed sequence
+ * @param joined_sequence_bound The begin position of every sequence in concat_data
+ * @param mems Receives the MEMs
+*/
+template <typename Index>
+void lcp_intervals_to_mems(const Index* SA, const int32_t* DA, const IndexInt<Index>* LCP, const unsigned char* concat_data, Index n,
+    int_t min_mem_length, int_t min_cross_sequence, const std::vector<uint_t>& joined_sequence_bound, MemTable<Index>& mems);
+
 /**
 *Sorts the input vector of MEMs by the average position of each MEM's substrings along the sequences.
 *Removes any MEMs that span across multiple sequences.
 *Assigns a unique index to each MEM based on its position in the sorted vector.
 *@param mems The vector of MEMs to be sorted.
-*@param data The vector of sequences used to compute the MEMs.
+*@param data The sequences used to compute the MEMs.
+*/
+template <typename Index>
+void sort_mem(MemTable<Index>& mems, const SequenceStore& data);
+
+/**
+* @brief Keep the MEMs listed in rows and reorder the table to follow them.
+* @param mems The MEM table.
+* @param rows The rows to keep, in their new order.
 */
-void sort_mem(std::vector<mem>& mems, std::vector<std::string> data);
+template <typename Index>
+void select_mem_rows(MemTable<Index>& mems, const std::vector<uint_t>& rows);
 #endif
\ No newline at end of file
@@ -0,0 +1,137 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the memory budget of a run (-max_mem). The memory FMAlign2 holds itself is
+// measured as its resident set; the MSA backend processes are not part of it, so every backend job
+// reserves its predicted peak memory while it runs. A job is only started while the resident set and
+// the reservations stay within the budget, only one job at a time if even that one does not fit.
+// Aligned gap regions are spilled when the resident set alone exceeds the budget (see exceeded()).
+// The suffix index, the largest array FMAlign2 allocates, is estimated before it is built and the
+// lean index is used when the full one does not fit (see find_mem()). The traces of the sequence-to-profile
+// DPs (see seq2profile_tasks()) are reserved while they are computed, they can be large and many run at once.
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include "common.h"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+// Memory of a backend process before it reads its input, in bytes.
+#define MSA_JOB_BASE_MEMORY (32ULL << 20)
+// Bytes a backend process holds per input base: the sequences, their profiles and the guide tree data.
+#define MSA_JOB_MEMORY_PER_BASE 64
+// Bytes per cell of the pairwise dynamic programming matrix of the longest sequence.
+#define MSA_JOB_MEMORY_PER_CELL 4
+// Cap of the matrix term: MAFFT and the other backends align long sequences in linear space
+// (anchored or divide and conquer), a full matrix only for the short ones, about 16k bases and below.
+#define MSA_JOB_MAX_DP_MEMORY (1ULL << 30)
+
+class MemoryBudget {
+public:
+    static MemoryBudget& instance();
+
+    /**
+    * @brief Set the budget.
+    * @param bytes The most memory the run and its backend jobs may use together, 0 for no limit.
+    */
+    void set_limit(uint64_t bytes);
+
+    uint64_t limit() const { return limit_; }
+    bool enabled() const { return limit_ > 0; }
+
+    /**
+    * @brief Reserve memory for a job if it fits into the budget.
+    * A job always fits when nothing is reserved, so that the run can go on below any budget.
+    * @param bytes The predicted memory of the job.
+    * @return True if the memory is reserved, it must be given back with release().
+    */
+    bool try_reserve(uint64_t bytes);
+
+    /**
+    * @brief Reserve memory for work in this process, waiting until it fits into the budget.
+    * @param bytes The memory the work allocates, it must be given back with release().
+    */
+    void reserve(uint64_t bytes);
+
+    // Give back memory reserved with try_reserve() or reserve().
+    void release(uint64_t bytes);
+
+    // True if the resident set of the process exceeds the budget; the reservations of the backend jobs
+    // are not counted, the memory of other processes cannot be freed by spilling.
+    bool exceeded();
+
+    // Memory that is left of the budget, 0 if it is exceeded or there is no budget.
+    uint64_t available();
+
+private:
+    MemoryBudget() : limit_(0), reserved_(0) {}
+
+    std::mutex mutex_;
+    std::condition_variable released_;
+    uint64_t limit_;
+    uint64_t reserved_;
+};
+
+// Memory reserved with MemoryBudget::reserve() until the end of the scope.
+class MemoryReservation {
+public:
+    explicit MemoryReservation(uint64_t bytes) : bytes_(bytes) { MemoryBudget::instance().reserve(bytes_); }
+    ~MemoryReservation() { MemoryBudget::instance().release(bytes_); }
+    MemoryReservation(const MemoryReservation&) = delete;
+    MemoryReservation& operator=(const MemoryReservation&) = delete;
+private:
+    uint64_t bytes_;
+};
+
+/**
+* @brief Parse a memory size such as 1048576, 512M, 16G or 1.5T; K, M, G and T are powers of 1024.
+* @param text The size, a plain number is in bytes.
+* @param bytes Receives the size in bytes.
+* @return False if the text is not a size.
+*/
+bool parse_memory_size(const std::string& text, uint64_t& bytes);
+
+// The size in MiB, GiB or TiB for messages.
+std::string format_memory_size(uint64_t bytes);
+
+// The resident memory of the process in bytes, 0 where it is not available.
+uint64_t process_rss();
+
+/**
+* @brief Predict the memory of a suffix index built by find_mem().
+* @param n The length of the indexed text.
+* @param lean True for the lean index (SA and a one byte LCP), false for SA, LCP and DA.
+* @param threads The threads of the run; the full index of a long text is built by the parallel builder then.
+* @return The predicted peak memory in bytes.
+*/
+uint64_t estimate_index_memory(uint_t n, bool lean, int threads);
+
+/**
+* @brief Predict the peak memory of aligning a fragment, the backend process and the copies FMAlign2 keeps of it.
+* Fragments that are aligned in-process (see -small) only count the copies.
+* @param seq_num The number of sequences in the fragment.
+* @param total_length The sum of their lengths.
+* @param max_length The longest sequence.
+* @return The predicted memory in bytes.
+*/
+uint64_t estimate_msa_memory(uint_t seq_num, uint64_t total_length, uint_t max_length);
+
+#endif
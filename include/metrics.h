@@ -0,0 +1,96 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the opt-in run metrics (-metrics, -trace). Every record is an event with a
+// category, a name, the thread it ran on, its start and end in seconds since the program started,
+// and a few named values. The phases (category "phase") also carry the CPU seconds of the process
+// and its peak resident memory; the tasks are one event per expand_chain(), per parallel_align()
+// task and per MSA backend call. At the end the events are written as one JSON document grouped
+// by category, and as Chrome trace events ("ph": "X") for chrome://tracing or Perfetto.
+// Nothing is recorded unless one of the two files was requested.
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "common.h"
+#include <cstdint>
+#include <string>
+
+// Named values of an event, kept as a rendered JSON object body.
+class MetricsArgs {
+public:
+    MetricsArgs& add(const char* key, double value);
+    MetricsArgs& add(const char* key, int64_t value);
+    MetricsArgs& add(const char* key, uint64_t value);
+    MetricsArgs& add(const char* key, int value) { return add(key, (int64_t)value); }
+    MetricsArgs& add(const char* key, unsigned value) { return add(key, (uint64_t)value); }
+    MetricsArgs& add(const char* key, const std::string& value);
+    const std::string& json() const { return json_; }
+private:
+    void key(const char* key);
+    std::string json_;
+};
+
+// A phase of the run, from its construction to end() or its destruction.
+class MetricsPhase {
+public:
+    explicit MetricsPhase(const char* name);
+    ~MetricsPhase() { end(); }
+    /**
+    * @brief Record the phase with its wall time, the CPU seconds of the process and the peak RSS.
+    * Only the first call records.
+    */
+    void end();
+private:
+    const char* name_;
+    double start_;
+    double cpu_start_;
+    bool ended_;
+};
+
+/**
+* @brief Enable the metrics.
+* @param json_path File for the JSON document, empty for none.
+* @param trace_path File for the Chrome trace events, empty for none.
+*/
+void metrics_start(const std::string& json_path, const std::string& trace_path);
+
+// True if events are recorded.
+bool metrics_enabled();
+
+// Seconds since the program started.
+double metrics_now();
+
+/**
+* @brief Record an event; does nothing unless the metrics are enabled.
+* @param category The group of the event: "phase", "expand_chain", "parallel_align" or "msa_backend".
+* @param name The name shown in the trace.
+* @param start The start, from metrics_now().
+* @param end The end, from metrics_now().
+* @param args The named values of the event.
+*/
+void metrics_event(const char* category, const std::string& name, double start, double end, const MetricsArgs& args = MetricsArgs());
+
+/**
+* @brief Write the recorded events to the files given to metrics_start().
+* @return False if a file could not be written.
+*/
+bool metrics_finish();
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the helpers that run the external MSA backend.
+// A command template without {input} and {output} is treated as a stream template:
+// the fragment FASTA is written to the child's stdin and the alignment is read from its stdout,
+// with no shell and no temporary files. Templates that need files keep the system() path.
+#ifndef MSA_BACKEND_H
+#define MSA_BACKEND_H
+
+#include "common.h"
+#include <string>
+#include <vector>
+
+// Bytes of the stderr of a stream backend that are kept to be shown when it fails.
+#define MSA_STDERR_LIMIT (4 << 10)
+
+/**
+* @brief Check whether a command template should be run in stream mode.
+* A stream template contains neither {input} nor {output}; it reads FASTA from stdin and writes the alignment to stdout.
+* Stream mode is only available on POSIX systems, on Windows this always returns false.
+* @param cmdTemplate The MSA command template.
+* @return True if the template is run through pipes, otherwise false.
+*/
+bool is_stream_template(const std::string& cmdTemplate);
+
+/**
+* @brief Split a command line into arguments, honouring single quotes, double quotes and backslash escapes.
+* @param cmd The command line to split.
+* @return The list of arguments.
+*/
+std::vector<std::string> split_command(const std::string& cmd);
+
+/**
+* @brief Run a stream template: spawn the backend, feed it the FASTA through stdin and collect its stdout.
+* The {thread} placeholder is replaced by thread. If the command contains shell operators it is started
+* through /bin/sh -c, otherwise it is executed directly. The last MSA_STDERR_LIMIT bytes the backend
+* printed to stderr are kept and printed if it fails.
+* @param cmdTemplate The stream command template.
+* @param input The FASTA content sent to the backend.
+* @param output Receives everything the backend printed to stdout.
+* @param thread The number of threads passed to the backend.
+* @param spawn_seconds Receives the seconds until the backend was started, if not NULL.
+* @return The exit code of the backend, or -1 if it could not be started or was killed by a signal.
+*/
+int run_msa_stream(const std::string& cmdTemplate, const std::string& input, std::string& output, int thread = 1,
+    double* spawn_seconds = NULL);
+
+/**
+* @brief Resolve the folder used for temporary fragment files.
+* "auto" selects /dev/shm when it is a writable directory and falls back to ./temp/ otherwise.
+* The folder is created if it does not exist yet and the returned path always ends with '/'.
+* @param tmp_folder The folder requested on the command line, or "auto".
+* @return The folder path with a trailing separator.
+*/
+std::string resolve_tmp_folder(const std::string& tmp_folder);
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the queue that decides when the external MSA jobs start and how many
+// threads each of them gets. The cost of a fragment is predicted from its sequence count and
+// length distribution, and the most expensive ready job is started first (longest processing
+// time first), so one big gap region no longer runs alone at the end. All running jobs together
+// never use more backend threads than -t; a job gets a share of the threads in proportion to its
+// part of the outstanding cost. The predicted and the measured cost of every job are kept, so
+// the model can be checked and calibrated (see -cost_log). With -max_mem a job also needs its
+// predicted memory to fit into the budget; if the most expensive ready job does not fit, the most
+// expensive one that fits is started instead.
+#ifndef MSA_SCHEDULER_H
+#define MSA_SCHEDULER_H
+
+#include "common.h"
+#include "scheduler.h"
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Fixed cost of one backend call (process start, parsing) in the units of estimate_msa_cost().
+#define MSA_JOB_OVERHEAD 20000.0
+
+struct MsaJobRecord {
+    uint_t task_index;
+    uint_t seq_num;
+    uint64_t total_length;
+    uint_t max_length;
+    double predicted;      // estimate_msa_cost()
+    uint64_t memory;       // predicted peak memory in bytes, see estimate_msa_memory()
+    int threads;           // backend threads the job was started with
+    double seconds;        // measured wall time
+};
+
+/**
+* @brief Predict the relative cost of aligning a fragment.
+* Progressive aligners spend about n log n length-weighted steps; the quadratic mean of the
+* lengths is used so that a few long sequences weigh more than many short ones.
+* @param range The (begin, length) of every sequence in the fragment, begin -1 if it is left out.
+* @param record Receives the sequence count, the length sum, the longest length, the prediction and the memory.
+* @return The predicted cost, also stored in record.predicted.
+*/
+double estimate_msa_cost(const std::vector<std::pair<int_t, int_t>>& range, MsaJobRecord& record);
+
+class MsaJobQueue {
+public:
+    /**
+    * @brief Create a queue that runs its jobs on group.
+    * @param group The task group the jobs are run on.
+    * @param threads The number of backend threads all running jobs may use together.
+    * @param max_job_threads The most threads one job is given, 0 for no limit.
+    * @param memory_budget True to start a job only while its memory fits into the -max_mem budget.
+    */
+    MsaJobQueue(TaskGroup& group, int threads, int max_job_threads = 0, bool memory_budget = false);
+
+    /**
+    * @brief Announce a job that is not ready yet, so that the jobs started before it leave threads for it.
+    * @param predicted The expected cost of the job.
+    */
+    void expect(double predicted);
+
+    /**
+    * @brief Add a ready job. It is started once it is the most expensive ready job and threads are free.
+    * @param record The prediction of the job, see estimate_msa_cost().
+    * @param run Runs the job with the given number of backend threads.
+    * @param expected The cost announced for the job with expect(), 0 if it was not announced.
+    */
+    void push(const MsaJobRecord& record, std::function<void(int)> run, double expected = 0);
+
+    // The finished jobs, in the order they finished.
+    const std::vector<MsaJobRecord>& records() const { return records_; }
+
+    /**
+    * @brief Print a summary of the cost model and optionally write every job to a file.
+    * Must be called after all jobs are finished.
+    * @param log_path Tab separated output with one line per job, nothing is written if empty.
+    */
+    void report(const std::string& log_path) const;
+
+private:
+    struct Job {
+        MsaJobRecord record;
+        std::function<void(int)> run;
+        bool operator<(const Job& other) const;
+    };
+
+    void dispatch();
+    bool admit(const Job& job);
+    void finish(const MsaJobRecord& record);
+
+    TaskGroup& group_;
+    std::mutex mutex_;
+    std::vector<Job> ready_;        // max-heap on the predicted cost
+    int total_threads_;
+    int free_threads_;
+    int max_job_threads_;
+    bool memory_budget_;
+    double outstanding_cost_;       // predicted cost of the announced, ready and running jobs
+    std::vector<MsaJobRecord> records_;
+};
+
+#endif
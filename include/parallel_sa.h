@@ -0,0 +1,54 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// Multi-threaded construction of the generalized suffix array, LCP array and document array.
+// The arrays are identical to those of gsacak(): separators (1) are distinct symbols ordered by
+// their position, the LCP never extends over a separator, and DA[i] is the index of the sequence
+// that contains SA[i] (the terminating 0 belongs to a virtual sequence after the last one).
+#ifndef PARALLEL_SA_H
+#define PARALLEL_SA_H
+
+#include "common.h"
+#include "suffix_index.h"
+#include <cstdint>
+
+// gsacak is linear and faster per core, so the parallel builder is only used on long inputs
+// with enough threads to make up for the extra work of prefix doubling.
+#define PARALLEL_SA_MIN_LENGTH (1u << 24)
+#define PARALLEL_SA_MIN_THREADS 8
+
+/**
+ * @brief Computes the suffix array SA (LCP, DA) of T^cat in s[0..n-1] with several threads.
+ * Suffixes are first bucketed by their leading characters with a parallel counting sort,
+ * then the buckets are refined by prefix doubling, sorting independent groups in parallel.
+ * The LCP array is computed by a chunked Phi/PLCP pass and DA by a binary search over the separators.
+ * @param s       input concatenated string, using separators s[i]=1 and with s[n-1]=0
+ * @param SA      suffix array
+ * @param LCP     LCP array, may be NULL
+ * @param DA      document array, may be NULL
+ * @param n       string length
+ * @param threads number of threads
+ * @return 0 on success, -1 if the input is not supported (the caller should use gsacak instead).
+ * Instantiated for 32 and 64 bit indexes.
+ */
+template <typename Index>
+int parallel_gsa(const unsigned char* s, Index* SA, IndexInt<Index>* LCP, int32_t* DA, Index n, int threads);
+
+#endif
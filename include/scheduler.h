@@ -0,0 +1,177 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the process-wide task scheduler shared by all parallel phases.
+// The workers are started once by set_threads() and live until the program exits. Every worker
+// owns a deque: it pushes and pops its own tasks at the back and steals from the front of the
+// others when it runs dry. A parallel_for is one task holding the whole range, whoever runs it
+// splits off the upper half until only grain items are left, so idle workers steal big pieces
+// and submitting a range costs no allocation. The thread that waits for a job runs tasks too,
+// so jobs may be nested. A task runs with the options of the thread that queued it, so the jobs
+// of several alignments of one process share the workers. The first exception thrown by a task of a
+// job is rethrown by the thread that waits for it. The same code runs on Linux and Windows.
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "common.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A set of tasks that is waited for as a whole.
+struct SchedulerJob {
+    std::function<void(uint_t, uint_t)> body;   // runs the items [begin, end) of a range task
+    uint_t grain = 1;                           // ranges up to this size are not split further
+    std::atomic<uint_t> pending{ 0 };           // items not finished yet
+    std::atomic<bool> done{ false };            // set under mutex once pending is 0, cleared there by TaskGroup::run()
+    GlobalArgs* args = NULL;                    // the options of the thread that queued the job, see current_args()
+    std::atomic<bool> failed{ false };          // a task threw, the range pieces not started yet are skipped
+    std::exception_ptr error;                   // the first exception of a task, set under mutex
+    std::mutex mutex;
+    std::condition_variable finished;
+};
+
+struct SchedulerTask {
+    SchedulerJob* job;
+    uint_t begin;
+    uint_t end;
+    std::function<void()>* closure;             // a task of a TaskGroup, NULL for a range task
+};
+
+class Scheduler {
+public:
+    /**
+    * @brief Get the scheduler of the process.
+    * It runs everything on the calling thread until set_threads() is called.
+    */
+    static Scheduler& instance();
+
+    /**
+    * @brief Set the number of threads, the calling thread included.
+    * Must not be called while a job is running.
+    * @param threads The number of threads, values below 1 are treated as 1.
+    */
+    void set_threads(int threads);
+
+    // Number of threads, the calling thread included.
+    int threads() const { return threads_; }
+
+    /**
+    * @brief Run body on pieces of [begin, end) in parallel and wait for all of them.
+    * @param begin The first item.
+    * @param end One past the last item.
+    * @param grain The largest piece that is not split further, at least 1.
+    * @param body Called with the bounds of each piece.
+    * @throws The first exception thrown by body.
+    */
+    void parallel_for_range(uint_t begin, uint_t end, uint_t grain, const std::function<void(uint_t, uint_t)>& body);
+
+    // Queue a task, used by TaskGroup.
+    void submit(const SchedulerTask& task);
+
+    // Run tasks until the job is finished.
+    void wait(SchedulerJob& job);
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<SchedulerTask> tasks;
+    };
+
+    Scheduler();
+    void start(int threads);
+    void stop();
+    void worker_loop(int slot);
+    void push(int slot, const SchedulerTask& task);
+    bool take(int slot, SchedulerTask& task);
+    void execute(int slot, SchedulerTask task);
+    void fail(SchedulerJob* job, std::exception_ptr error);
+    void finish(SchedulerJob* job, uint_t items);
+    int current_slot() const;
+
+    int threads_;
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;  // slot 0 is shared by the threads that are not workers
+    std::vector<std::thread> workers_;
+    std::atomic<int64_t> queued_;
+    std::atomic<int> sleeping_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool quit_;
+};
+
+// Tasks of different kinds that are waited for together.
+// run() may also be called from a task of the group, e.g. to start the tasks that depend on it.
+class TaskGroup {
+public:
+    TaskGroup() = default;
+    ~TaskGroup() {
+        try {
+            wait();
+        }
+        catch (...) {
+            // the exception of a task is only reported by an explicit wait()
+        }
+    }
+
+    /**
+    * @brief Queue fn to be run by the scheduler.
+    * @param fn The task.
+    */
+    void run(std::function<void()> fn);
+
+    /**
+    * @brief Run tasks until every task of the group is finished.
+    * @throws The first exception thrown by a task since the last wait.
+    */
+    void wait();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+private:
+    SchedulerJob job_;
+};
+
+/**
+* @brief Call fn(i) for every i in [begin, end) in parallel on the process-wide scheduler.
+* @param begin The first item.
+* @param end One past the last item.
+* @param grain Items handed out together; 1 for tasks that take long, larger for tiny ones.
+* @param fn Called once for every item.
+*/
+template <typename F>
+void parallel_for(uint_t begin, uint_t end, uint_t grain, F fn) {
+    Scheduler::instance().parallel_for_range(begin, end, grain, [&fn](uint_t b, uint_t e) {
+        for (uint_t i = b; i < e; i++) {
+            fn(i);
+        }
+    });
+}
+
+#endif
@@ -25,6 +25,12 @@
 #include "ssw_cpp.h"
 #include "ssw.h"
 #include "utils.h"
+#include "msa_backend.h"
+#include "sequence_store.h"
+#include "scheduler.h"
+#include "msa_scheduler.h"
+#include "fragment_align.h"
+#include "alignment_writer.h"
 #include <algorithm>
 #include <sstream>
 #ifdef __linux__
@@ -34,25 +40,37 @@
 #endif
 #include <random>
 #include <climits>
+#include <unordered_map>
 
-const std::string TMP_FOLDER = "./temp/";
 std::string buildCommand(std::string cmdTemplate,
     const std::string& inputPath,
     const std::string& outputPath,
     int thread = 1);
 
+// present chains on each side of a missing chain that are used to place it, see expected_chain_position()
+#define SW_WINDOW_NEIGHBORS 2
+// a window search is accepted once the score reaches this part of the score of a perfect match
+#define SW_WINDOW_MIN_SCORE 0.5
+// every recursion level halves the minimal MEM length, but not below this
+#define RECURSIVE_MIN_MEM_LENGTH 12
+
 struct ExpandChainParams {
-	std::vector<std::string>* data;
-	std::vector<std::vector<std::pair<int_t, int_t>>>* chain;
+	const SequenceStore* data;
+	const std::vector<std::vector<std::pair<int_t, int_t>>>* chain; // read only, shared by all tasks
 	uint_t chain_index;
 	std::vector<std::vector<std::string>>::iterator result_store;
+	std::vector<std::pair<int_t, int_t>> expanded_column; // chain column chain_index after SW expansion
+	uint_t depth; // recursion level of the chains, see align_chains()
 };
 
 struct ParallelAlignParams {
-	std::vector<std::string>* data;
+	const SequenceStore* data;
 	std::vector<std::vector<std::pair<int_t, int_t>>>::iterator parallel_range;
 	uint_t task_index;
 	std::vector<std::vector<std::string>>::iterator result_store;
+	int thread_num; // threads of the MSA backend, assigned by MsaJobQueue
+	uint_t depth; // recursion level of the region, see align_chains()
+	int_t min_mem_length; // the MEM length the chains around the region were found with
 };
 
 /**
@@ -65,24 +83,47 @@ struct ParallelAlignParams {
 */
 std::string generateRandomString(int length);
 
+// Suffix of the temporary fragment files of this process
+extern std::string random_file_end;
+
 /**
 * @brief Split and parallel align multiple sequences using a vector of chain pairs.
-* This function takes in three parameters: a vector of input sequences (data), a vector of sequence names (name),
-* and a vector of chain pairs (chain) that represent initial pairwise alignments between sequences.
+* This function takes in two parameters: a vector of input sequences (data) and a vector of chain pairs (chain)
+* that represent initial pairwise alignments between sequences.
 * It then splits the chain pairs into smaller regions and performs parallel sequence alignment on these regions.
 * Finally, it concatenates the aligned regions and performs sequence-to-profile alignment to generate a final alignment.
-* @param data A vector of input sequences to be aligned
-* @param name A vector of sequence names corresponding to the input sequences
+* @param data The store of input sequences to be aligned
 * @param chain A vector of chain pairs representing initial pairwise alignments between sequences
-* @return void
+* @return The aligned fragments, concat_string[k][i] is fragment k of sequence i
+*/
+std::vector<std::vector<std::string>> split_and_parallel_align(const SequenceStore& data, std::vector<std::vector<std::pair<int_t, int_t>>>& chain);
+
+/**
+* @brief Align the sequences: deduplicate them, find the anchors (or read them from -checkpoint) and split and align.
+* @param data The sequences, replaced by the distinct ones with -dedup 1.
+* @param representative Receives for every input sequence its row of the result, empty if every sequence has its own.
+* @return The aligned fragments, concat_string[k][i] is fragment k of row i.
 */
-void split_and_parallel_align(std::vector<std::string> data, std::vector<std::string> name, std::vector<std::vector<std::pair<int_t, int_t>>> split_points_on_sequence);
+std::vector<std::vector<std::string>> align_sequences(SequenceStore& data, std::vector<uint_t>& representative);
+
+/**
+* @brief Expand the chains and align the gap regions between them.
+* Gap regions longer than -rec_len are split again by the MEMs found in them, up to -rec_depth levels deep.
+* @param data The store of sequences to be aligned
+* @param chain The chains of every sequence, replaced by the expanded chains
+* @param depth The recursion level, 0 for the input sequences
+* @param min_mem_length The minimal MEM length the chains were found with
+* @param thread The number of MSA backend threads the gap regions may use together
+* @return The aligned fragments, chains and gap regions in turn, concat_string[k][i] is fragment k of sequence i
+*/
+std::vector<std::vector<std::string>> align_chains(const SequenceStore& data, std::vector<std::vector<std::pair<int_t, int_t>>>& chain,
+	uint_t depth, int_t min_mem_length, int thread);
 /**
 * @brief Selects columns from a sequence of split points to enable multi thread.
 * @param split_points_on_sequence A vector of vectors of pairs, where each pair represents the start and mem length
 * @return A vector of indices of the selected columns.
 */
-std::vector<int_t> select_columns(std::vector<std::vector<std::pair<int_t, int_t>>> split_points_on_sequence);
+std::vector<int_t> select_columns(const std::vector<std::vector<std::pair<int_t, int_t>>>& split_points_on_sequence);
 
 /**
 * @brief Get a vector of integers that are not in the selected_cols vector and have a maximum value of n.
@@ -108,6 +149,22 @@ Finally, the function stores the aligned fragments in the result_store vector.
 */
 void* expand_chain(void* arg);
 
+/**
+* @brief Estimate where a chain that is missing in a sequence begins in it.
+* Every nearby chain that is present both in the sequence and in the sequence the query is taken from
+* gives one estimate: its begin in the sequence plus its distance to the query. The median of the estimates
+* of up to SW_WINDOW_NEIGHBORS chains on each side is returned. Without such chains the begin of the query
+* is scaled by the lengths of the two sequences.
+* @param data The store of sequences.
+* @param chain The chains, chain[i][k] is the (begin, length) of chain k in sequence i, begin -1 if missing.
+* @param seq_index The sequence the chain is missing in.
+* @param query_index A sequence that contains the chain.
+* @param chain_index The chain.
+* @return The estimated begin of the chain in sequence seq_index.
+*/
+int_t expected_chain_position(const SequenceStore& data, const std::vector<std::vector<std::pair<int_t, int_t>>>& chain,
+    uint_t seq_index, uint_t query_index, uint_t chain_index);
+
 /**
 * @brief Store the Smith-Waterman alignment results in a vector of aligned sequences.
 * This function takes the alignment results generated by the StripedSmithWaterman algorithm and
@@ -120,16 +177,17 @@ void* expand_chain(void* arg);
 * @param seq_index The index of the query sequence in the vector of aligned sequences.
 * @return A pair of integers representing the alignment start and length.
 */
-std::pair<int_t, int_t> store_sw_alignment(StripedSmithWaterman::Alignment alignment, std::string& ref, std::string& query,
+std::pair<int_t, int_t> store_sw_alignment(const StripedSmithWaterman::Alignment& alignment, std::string_view ref, std::string& query,
 	std::vector<std::string>& res_store, uint_t seq_index);
 
 /**
- * @brief Get the range of each sequence in parallel alignment
- * @param data The vector of sequences to be aligned
- * @param chain The vector of chains representing the alignment
- * @return The vector of ranges for each sequence in the alignment
+ * @brief Get the range of each sequence in the gap region between two expanded chains
+ * @param data The store of sequences to be aligned
+ * @param left The chain column on the left of the region, NULL for the region before the first chain
+ * @param right The chain column on the right of the region, NULL for the region after the last chain
+ * @return The range (begin, length) of every sequence, (-1,-1) if one of the chains is missing on it
  */
-std::vector<std::vector<std::pair<int_t, int_t>>> get_parallel_align_range(std::vector<std::string> data, std::vector<std::vector<std::pair<int_t, int_t>>> chain);
+std::vector<std::pair<int_t, int_t>> get_parallel_align_column(const SequenceStore& data, const std::vector<std::pair<int_t, int_t>>* left, const std::vector<std::pair<int_t, int_t>>* right);
 
 /**
 * @brief Function for parallel alignment of sequences.
@@ -141,52 +199,79 @@ std::vector<std::vector<std::pair<int_t, int_t>>> get_parallel_align_range(std::
 void* parallel_align(void* arg);
 
 /**
-* @brief Align sequences in a FASTA file using either halign or mafft package.
-* @param file_name The name of the FASTA file to align.
-* @return The name of the resulting aligned FASTA file.
+* @brief Align the fragment FASTA with the configured MSA backend.
+* Stream templates receive the FASTA on stdin and return the alignment on stdout.
+* Other templates fall back to a temporary file pair in global_args.tmp_folder, which is removed afterwards.
+* With -dist the fragment goes to an MPI worker or the fragment files instead, see dist_align_fragment().
+* @param fasta The fragment in FASTA format.
+* @param task_index The index of the fragment, used to name the temporary files.
+* @param aligned_seq Receives the aligned sequences in input order.
+* @param thread The number of threads passed to the backend.
+* @return void
 */
-std::string align_fasta(std::string file_name);
+void align_fragment(const std::string& fasta, uint_t task_index, std::vector<std::string>& aligned_seq, int thread);
 
 /**
-* @brief Deletes temporary files generated during sequence alignment tasks.
-* @param task_count The number of tasks for which temporary files were created.
+* @brief Align sequences in a FASTA file using either halign or mafft package.
+* @param file_name The name of the FASTA file to align.
+* @param thread The number of threads passed to the backend.
+* @return The name of the resulting aligned FASTA file, empty if the command failed under -checkpoint.
 */
-void delete_tmp_folder(uint_t task_count);
+std::string align_fasta(std::string file_name, int thread);
 
 /**
 * @brief Concatenate multiple sequence alignments into a single alignment and write the result to an output file.
 * @param concat_string A 2D vector of strings containing the aligned sequences to concatenate.
 * @param name A vector of strings containing the names of the sequences.
+* @param representative For every name the row of concat_string it is written with, empty for the identity.
 */
-void concat_alignment(std::vector<std::vector<std::string>>&concat_string, std::vector<std::string> &name);
+void concat_alignment(std::vector<std::vector<std::string>>&concat_string, const std::vector<std::string> &name, const std::vector<uint_t>& representative);
+
+// The part begin..end of a sequence that is aligned against the profile of the fragments first..last, and its alignment.
+struct Seq2ProfileTask {
+	uint_t seq_index;
+	uint_t first;
+	uint_t last;
+	int_t begin;
+	int_t end;
+	std::string column;                 // the base or '-' of the sequence in every column of the fragments
+	std::vector<std::string> insertion; // insertion[c]: the bases before column c, new gap columns for the other rows
+};
 
 /**
-* @brief Convert sequence fragments into profile by aligning missing fragments with existing ones.
-* @param concat_string A reference to a vector of vectors of strings representing concatenated sequence fragments.
-* @param data A reference to a vector of strings representing the sequence names.
-* @param concat_range A reference to a vector of vectors of pairs of integers representing the start and end positions of the sequence fragments.
-* @param fragment_len A reference to a vector of unsigned integers representing the lengths of the sequence fragments.
-* @return None.
+* @brief Align the parts of the sequences that were left out of fragments (range -1) against the profile of those fragments.
+* Every run of consecutive fragments missing in a sequence is one task. The tasks are independent: each one aligns the
+* part of its sequence between the fragments around the run against the column frequencies of the rows present in the
+* run, see align_to_profile(). All tasks run in parallel, then every fragment takes the new gap columns the tasks need.
+* @param concat_string The aligned fragments, concat_string[k][i] is fragment k of sequence i, empty where it is missing.
+* @param data The store of input sequences.
+* @param concat_range The range (begin, length) of every fragment in every sequence, (-1,-1) where it is missing.
+* @return The number of tasks.
 */
-void seq2profile(std::vector<std::vector<std::string>>& concat_string, std::vector<std::string>& data, std::vector<std::vector<std::pair<int_t, int_t>>>& concat_range, std::vector<uint_t>& fragment_len);
+uint_t seq2profile(std::vector<std::vector<std::string>>& concat_string, const SequenceStore& data,
+    const std::vector<std::vector<std::pair<int_t, int_t>>>& concat_range);
 
 /**
-* @brief: Aligns a sequence and a profile using a third-party tool called profile_two_align and returns the iterator pointing to the next position in the 2D vector of strings.
-* The function first checks for gaps between the fragments and adds them as necessary.
-* Then it writes the sequence to align and a profile file, passes them to profile_two_align, and reads the results.
-* Finally, it updates the concatenated string, range and fragment length information accordingly.
-* @param seq_index: Index of the sequence to align.
-* @param left_index: Index of the left-most fragment.
-* @param right_index: Index of the right-most fragment.
-* @param concat_string: 2D vector of strings containing the concatenated fragments.
-* @param data: Vector of strings containing the sequences.
-* @param concat_range: 2D vector of pairs of integers representing the range of each fragment in each sequence.
-* @param fragment_len: Vector of unsigned integers representing the length of each fragment.
-* @return std::vector<std::vectorstd::string>::iterator: Iterator pointing to the next position in the 2D vector of strings.
+* @brief Align parts of sequences against the profile of the other rows of the fragments they belong to.
+* The profile of a fragment is built from the rows of its width that are not aligned by a task in it. All tasks run
+* in parallel, then every fragment takes the new gap columns the tasks need and the rows of the tasks are replaced.
+* @param concat_string The aligned fragments, concat_string[k][i] is fragment k of sequence i.
+* @param data The store of sequences the parts of the tasks are taken from.
+* @param tasks The parts to align, a fragment of a sequence is in at most one task.
 */
-std::vector<std::vector<std::string>>::iterator seq2profile_align(uint_t seq_index, uint_t left_index, uint_t right_index, std::vector<std::vector<std::string>>& concat_string, std::vector<std::string>& data, std::vector<std::vector<std::pair<int_t, int_t>>>& concat_range, std::vector<uint_t>& fragment_len);
+void seq2profile_tasks(std::vector<std::vector<std::string>>& concat_string, const SequenceStore& data,
+    std::vector<Seq2ProfileTask>& tasks);
+
+/**
+* @brief Remove the gaps two neighboring fragments have at their border in every row.
+* @param data1 The rows of the left fragment.
+* @param data2 The rows of the right fragment.
+*/
+void refinement(std::vector<std::string>& data1, std::vector<std::string>& data2);
+
 /**
 * @brief Concatenate two sets of sequence data (chain and parallel) into a single set of concatenated data.
+* The fragments keep the width of their alignment, the gaps at their borders are trimmed later by refinement().
 * @param chain_string A vector of vectors containing the chain sequence data.
 * @param parallel_string A vector of vectors containing the parallel sequence data.
 * @return std::vector<std::vectorstd::string> A vector of vectors containing the concatenated sequence data.
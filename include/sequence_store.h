@@ -0,0 +1,112 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header defines the store that holds the input sequences once for the whole pipeline.
+// All sequences live in one buffer, each followed by the separator 1, and the buffer ends with 0.
+// This is the text the suffix array is built on, so find_mem indexes it in place, and every
+// later stage reads the sequences through std::string_view instead of copying them.
+#ifndef SEQUENCE_STORE_H
+#define SEQUENCE_STORE_H
+
+#include "common.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+class SequenceStore {
+public:
+    SequenceStore();
+
+    /**
+    * @brief Reserve space for the sequences that are going to be appended.
+    * @param bytes The total length of the sequences.
+    * @param count The number of sequences.
+    */
+    void reserve(size_t bytes, size_t count);
+
+    /**
+    * @brief Append a sequence to the end of the store.
+    * @param seq The sequence, it must not contain the bytes 0 and 1.
+    */
+    void append(std::string_view seq);
+
+    /**
+    * @brief Start a sequence that is filled piece by piece with extend() and closed with end_sequence().
+    */
+    void begin_sequence();
+
+    /**
+    * @brief Grow the open sequence.
+    * @param n The number of bytes to add.
+    * @return The n new bytes, valid until the store is modified again.
+    */
+    unsigned char* extend(size_t n) {
+        size_t old_size = bytes_.size();
+        bytes_.resize(old_size + n);
+        return bytes_.data() + old_size;
+    }
+
+    /**
+    * @brief Close the sequence opened by begin_sequence().
+    */
+    void end_sequence();
+
+    /**
+    * @brief Remove all sequences and release the memory.
+    */
+    void clear();
+
+    // Number of sequences.
+    size_t size() const { return offsets_.size(); }
+
+    bool empty() const { return offsets_.empty(); }
+
+    // View of sequence i, valid as long as the store is not modified.
+    std::string_view operator[](size_t i) const {
+        return std::string_view((const char*)bytes_.data() + offsets_[i], lengths_[i]);
+    }
+
+    // Length of sequence i.
+    uint_t length(size_t i) const { return lengths_[i]; }
+
+    // The concatenated sequences with separator 1 and a terminating 0.
+    const unsigned char* concat() const { return bytes_.data(); }
+
+    // Length of concat(), including separators and the terminating 0.
+    uint_t concat_length() const { return bytes_.size(); }
+
+    // Begin position of every sequence in concat().
+    const std::vector<uint_t>& bounds() const { return offsets_; }
+
+private:
+    std::vector<unsigned char> bytes_;
+    std::vector<uint_t> offsets_;
+    std::vector<uint_t> lengths_;
+};
+
+/**
+* @brief Collapse identical sequences to one representative.
+* @param data The sequences.
+* @param unique Receives the distinct sequences in the order of their first occurrence.
+* @return For every sequence of data the index of its representative in unique.
+*/
+std::vector<uint_t> dedup_sequences(const SequenceStore& data, SequenceStore& unique);
+
+#endif
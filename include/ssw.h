@@ -85,6 +85,11 @@ typedef struct {
 */
 s_profile* ssw_init (const int8_t* read, const int32_t readLen, const int8_t* mat, const int32_t n, const int8_t score_size);
 
+/*!	@function	Name the striped kernels ssw_init uses.
+	@return	"sse2", "avx2" or "avx512"; the widest the CPU supports, chosen when first needed
+*/
+const char* ssw_kernel_name (void);
+
 /*!	@function	Release the memory allocated by function ssw_init.
 	@param	p	pointer to the query profile structure
 */
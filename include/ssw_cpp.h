@@ -9,6 +9,8 @@
 #include <string>
 #include <vector>
 
+struct _profile;
+
 namespace StripedSmithWaterman {
 
 struct Alignment {
@@ -125,6 +127,15 @@ class Aligner {
     gap_extending_penalty_ = extending;
   };
 
+  // =========
+  // @function The scores the aligner was built with, so that other
+  //             scoring can follow them.
+  // =========
+  uint8_t GetMatchScore(void) const { return match_score_; };
+  uint8_t GetMismatchPenalty(void) const { return mismatch_penalty_; };
+  uint8_t GetGapOpeningPenalty(void) const { return gap_opening_penalty_; };
+  uint8_t GetGapExtendingPenalty(void) const { return gap_extending_penalty_; };
+
   // =========
   // @function Align the query againt the reference that is set by
   //             SetReferenceSequence.
@@ -156,6 +167,35 @@ class Aligner {
   bool Align(const char* query, const char* ref, const int& ref_len,
              const Filter& filter, Alignment* alignment, const int32_t maskLen) const;
 
+  // =========
+  // @function Build the query profile once, so that AlignReference can align
+  //             the same query against many references.
+  //           [NOTICE] If there exists a query, that one will be deleted
+  //                    and replaced.
+  // @param    query  The query bases;
+  //                  [NOTICE] It is not necessary null terminated.
+  // @param    length The length of the query.
+  // @return   The length of the built query.
+  // =========
+  int SetQuerySequence(const char* query, const int& length);
+
+  void CleanQuerySequence(void);
+
+  // =========
+  // @function Align the query that is set by SetQuerySequence against the reference.
+  //           The result is the same as Align(query, ref, ref_len, ...), but
+  //             the query profile is not built again.
+  // @param    ref       The reference sequence.
+  //                     [NOTICE] It is not necessary null terminated.
+  // @param    ref_len   The length of the reference sequence.
+  // @param    filter    The filter for the alignment.
+  // @param    alignment The container contains the result.
+  // @param    maskLen   See Align.
+  // @return   True: succeed; false: fail.
+  // =========
+  bool AlignReference(const char* ref, const int& ref_len,
+             const Filter& filter, Alignment* alignment, const int32_t maskLen) const;
+
   // @function Clear up all containers and thus the aligner is disabled.
   //             To rebuild the aligner please use Build functions.
   void Clear(void);
@@ -202,6 +242,10 @@ class Aligner {
   int8_t* translated_reference_;
   int32_t reference_length_;
 
+  int8_t* translated_query_;
+  int32_t query_length_;
+  struct _profile* query_profile_;
+
   int TranslateBase(const char* bases, const int& length, int8_t* translated) const;
   void SetAllDefault(void);
   void BuildDefaultMatrix(void);
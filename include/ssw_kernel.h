@@ -0,0 +1,509 @@
+/* The MIT License
+   Copyright (c) 2012-2015 Boston College.
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+   BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+   ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+/*
+ *  ssw_kernel.h
+ *
+ *  The striped Smith-Waterman kernels of ssw.cpp, written once for any vector width.
+ *
+ *  A translation unit defines a traits struct V with the vector type and the few operations
+ *  the kernels need (see ssw_sse2 in ssw.cpp), includes this header and fills an ssw_kernel
+ *  table with SSW_KERNEL_TABLE(V, name). ssw.cpp builds the SSE2 table; ssw_avx2.cpp and
+ *  ssw_avx512.cpp are compiled with -mavx2 / -mavx512bw and build the 256 and 512 bit tables.
+ *  ssw_init picks the widest table the CPU supports, the profile remembers it, since the
+ *  striped layout of the profile depends on the number of lanes.
+ *
+ *  Everything in here must have internal linkage (static, or templates on a traits struct in an
+ *  anonymous namespace): an inline function with external linkage compiled with -mavx512bw could
+ *  otherwise be picked by the linker for the SSE2 code as well.
+ */
+
+#ifndef SSW_KERNEL_H
+#define SSW_KERNEL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __GNUC__
+#define LIKELY(x) __builtin_expect((x),1)
+#define UNLIKELY(x) __builtin_expect((x),0)
+#else
+#define LIKELY(x) (x)
+#define UNLIKELY(x) (x)
+#endif
+
+/* Alignment of the profiles and of the score columns, enough for 512 bit loads. */
+#define SSW_VECTOR_ALIGN 64
+
+typedef struct {
+	uint16_t score;
+	int32_t ref;	 //0-based position
+	int32_t read;    //alignment ending position on read, 0-based
+} alignment_end;
+
+/* One set of striped kernels, the profiles are only valid for the kernels of the same table. */
+typedef struct {
+	const char* name;
+	int32_t lanes;	/* 8 bit lanes of one vector */
+	void* (*profile_byte) (const int8_t* read_num, const int8_t* mat, const int32_t readLen, const int32_t n, uint8_t bias);
+	void* (*profile_word) (const int8_t* read_num, const int8_t* mat, const int32_t readLen, const int32_t n);
+	alignment_end* (*sw_byte) (const int8_t* ref, int8_t ref_dir, int32_t refLen, int32_t readLen,
+		const uint8_t weight_gapO, const uint8_t weight_gapE, const void* vProfile, uint8_t terminate, uint8_t bias, int32_t maskLen);
+	alignment_end* (*sw_word) (const int8_t* ref, int8_t ref_dir, int32_t refLen, int32_t readLen,
+		const uint8_t weight_gapO, const uint8_t weight_gapE, const void* vProfile, uint16_t terminate, int32_t maskLen);
+} ssw_kernel;
+
+extern const ssw_kernel ssw_kernel_sse2;
+#ifdef SSW_DISPATCH
+extern const ssw_kernel ssw_kernel_avx2;
+extern const ssw_kernel ssw_kernel_avx512;
+#endif
+
+/* Zero filled memory aligned for every vector width; release it with ssw_free. */
+static inline void* ssw_calloc (size_t size) {
+	void* p = _mm_malloc(size > 0 ? size : 1, SSW_VECTOR_ALIGN);
+	if (p) memset(p, 0, size);
+	return p;
+}
+
+static inline void ssw_free (void* p) {
+	_mm_free(p);
+}
+
+namespace {
+
+/* Generate query profile rearrange query sequence & calculate the weight of match/mismatch. */
+template <class V>
+void* striped_profile_byte (const int8_t* read_num,
+				  const int8_t* mat,
+				  const int32_t readLen,
+				  const int32_t n,	/* the edge length of the squre matrix mat */
+				  uint8_t bias) {
+
+	typedef typename V::vec vec;
+	const int32_t lanes = V::lanes8;
+	int32_t segLen = (readLen + lanes - 1) / lanes; /* Split the register into 8 bit pieces and the read into as many segments.
+								     Calculat the segments in parallel.
+								   */
+	vec* vProfile = (vec*)ssw_calloc(n * segLen * sizeof(vec));
+	int8_t* t = (int8_t*)vProfile;
+	int32_t nt, i, j, segNum;
+
+	/* Generate query profile rearrange query sequence & calculate the weight of match/mismatch */
+	for (nt = 0; LIKELY(nt < n); nt ++) {
+		for (i = 0; i < segLen; i ++) {
+			j = i;
+			for (segNum = 0; LIKELY(segNum < lanes) ; segNum ++) {
+				*t++ = j>= readLen ? bias : mat[nt * n + read_num[j]] + bias;
+				j += segLen;
+			}
+		}
+	}
+	return vProfile;
+}
+
+/* Striped Smith-Waterman
+   Record the highest score of each reference position.
+   Return the alignment score and ending position of the best alignment, 2nd best alignment, etc.
+   Gap begin and gap extension are different.
+   wight_match > 0, all other weights < 0.
+   The returned positions are 0-based.
+ */
+template <class V>
+alignment_end* striped_sw_byte (const int8_t* ref,
+							 int8_t ref_dir,	// 0: forward ref; 1: reverse ref
+							 int32_t refLen,
+							 int32_t readLen,
+							 const uint8_t weight_gapO, /* will be used as - */
+							 const uint8_t weight_gapE, /* will be used as - */
+							 const void* profile,
+							 uint8_t terminate,	/* the best alignment score: used to terminate
+												   the matrix calculation when locating the
+												   alignment beginning point. If this score
+												   is set to 0, it will not be used */
+	 						 uint8_t bias,  /* Shift 0 point to a positive value. */
+							 int32_t maskLen) {
+
+	typedef typename V::vec vec;
+	const int32_t lanes = V::lanes8;
+	const vec* vProfile = (const vec*)profile;
+	uint8_t max = 0;		                     /* the max alignment score */
+	int32_t end_read = readLen - 1;
+	int32_t end_ref = -1; /* 0_based best alignment ending point; Initialized as isn't aligned -1. */
+	int32_t segLen = (readLen + lanes - 1) / lanes; /* number of segment */
+
+	/* array to record the largest score of each reference position */
+	uint8_t* maxColumn = (uint8_t*) calloc(refLen, 1);
+
+	/* Define 0 vector. */
+	vec vZero = V::zero();
+
+	vec* pvHStore = (vec*) ssw_calloc(segLen * sizeof(vec));
+	vec* pvHLoad = (vec*) ssw_calloc(segLen * sizeof(vec));
+	vec* pvE = (vec*) ssw_calloc(segLen * sizeof(vec));
+	vec* pvHmax = (vec*) ssw_calloc(segLen * sizeof(vec));
+
+	int32_t i, j, k;
+	/* insertion begin vector */
+	vec vGapO = V::set1_epi8(weight_gapO);
+
+	/* insertion extension vector */
+	vec vGapE = V::set1_epi8(weight_gapE);
+
+	/* bias vector */
+	vec vBias = V::set1_epi8(bias);
+
+	vec vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
+	vec vMaxMark = vZero; /* Trace the highest score till the previous column. */
+	int32_t edge, begin = 0, end = refLen, step = 1;
+
+	/* outer loop to process the reference sequence */
+	if (ref_dir == 1) {
+		begin = refLen - 1;
+		end = -1;
+		step = -1;
+	}
+	for (i = begin; LIKELY(i != end); i += step) {
+		vec e, vF = vZero, vMaxColumn = vZero; /* Initialize F value to 0.
+							   Any errors to vH values will be corrected in the Lazy_F loop.
+							 */
+
+		vec vH = pvHStore[segLen - 1];
+		vH = V::shift_byte(vH); /* Shift vH by 1 byte towards the higher lanes. */
+		const vec* vP = vProfile + ref[i] * segLen; /* Right part of the vProfile */
+
+		/* Swap the 2 H buffers. */
+		vec* pv = pvHLoad;
+		pvHLoad = pvHStore;
+		pvHStore = pv;
+
+		/* inner loop to process the query sequence */
+		for (j = 0; LIKELY(j < segLen); ++j) {
+			vH = V::adds_epu8(vH, V::load(vP + j));
+			vH = V::subs_epu8(vH, vBias); /* vH will be always > 0 */
+
+			/* Get max from vH, vE and vF. */
+			e = V::load(pvE + j);
+			vH = V::max_epu8(vH, e);
+			vH = V::max_epu8(vH, vF);
+			vMaxColumn = V::max_epu8(vMaxColumn, vH);
+
+			/* Save vH values. */
+			V::store(pvHStore + j, vH);
+
+			/* Update vE value. */
+			vH = V::subs_epu8(vH, vGapO); /* saturation arithmetic, result >= 0 */
+			e = V::subs_epu8(e, vGapE);
+			e = V::max_epu8(e, vH);
+			V::store(pvE + j, e);
+
+			/* Update vF value. */
+			vF = V::subs_epu8(vF, vGapE);
+			vF = V::max_epu8(vF, vH);
+
+			/* Load the next vH. */
+			vH = V::load(pvHLoad + j);
+		}
+
+        /* Lazy_F loop: has been revised to disallow adjecent insertion and then deletion, so don't update E(i, j), learn from SWPS3 */
+		for (k = 0; LIKELY(k < lanes); ++k) {
+			vF = V::shift_byte(vF);
+			for (j = 0; LIKELY(j < segLen); ++j) {
+				vH = V::load(pvHStore + j);
+				vH = V::max_epu8(vH, vF);
+	    		vMaxColumn = V::max_epu8(vMaxColumn, vH);	// newly added line
+				V::store(pvHStore + j, vH);
+				vH = V::subs_epu8(vH, vGapO);
+				vF = V::subs_epu8(vF, vGapE);
+				/* unsigned comparison, the scores use all 8 bits */
+				if (UNLIKELY(! V::any_gt_epu8(vF, vH))) goto end;
+			}
+		}
+
+end:
+		vMaxScore = V::max_epu8(vMaxScore, vMaxColumn);
+		if (! V::all_eq_epi8(vMaxMark, vMaxScore)) {
+			uint8_t temp;
+			vMaxMark = vMaxScore;
+			temp = V::hmax_epu8(vMaxScore);
+
+			if (LIKELY(temp > max)) {
+				max = temp;
+				if (max + bias >= 255) break;	//overflow
+				end_ref = i;
+
+				/* Store the column with the highest alignment score in order to trace the alignment ending position on read. */
+				for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
+			}
+		}
+
+		/* Record the max score of current column. */
+		maxColumn[i] = V::hmax_epu8(vMaxColumn);
+		if (maxColumn[i] == terminate) break;
+	}
+
+	/* Trace the alignment ending position on read. */
+	uint8_t *t = (uint8_t*)pvHmax;
+	int32_t column_len = segLen * lanes;
+	for (i = 0; LIKELY(i < column_len); ++i, ++t) {
+		int32_t temp;
+		if (*t == max) {
+			temp = i / lanes + i % lanes * segLen;
+			if (temp < end_read) end_read = temp;
+		}
+	}
+
+	ssw_free(pvHmax);
+	ssw_free(pvE);
+	ssw_free(pvHLoad);
+	ssw_free(pvHStore);
+
+	/* Find the most possible 2nd best alignment. */
+	alignment_end* bests = (alignment_end*) calloc(2, sizeof(alignment_end));
+	bests[0].score = max + bias >= 255 ? 255 : max;
+	bests[0].ref = end_ref;
+	bests[0].read = end_read;
+
+	bests[1].score = 0;
+	bests[1].ref = 0;
+	bests[1].read = 0;
+
+	edge = (end_ref - maskLen) > 0 ? (end_ref - maskLen) : 0;
+	for (i = 0; i < edge; i ++) {
+		if (maxColumn[i] > bests[1].score) {
+			bests[1].score = maxColumn[i];
+			bests[1].ref = i;
+		}
+	}
+	edge = (end_ref + maskLen) > refLen ? refLen : (end_ref + maskLen);
+	for (i = edge + 1; i < refLen; i ++) {
+		if (maxColumn[i] > bests[1].score) {
+			bests[1].score = maxColumn[i];
+			bests[1].ref = i;
+		}
+	}
+
+	free(maxColumn);
+	return bests;
+}
+
+template <class V>
+void* striped_profile_word (const int8_t* read_num,
+				  const int8_t* mat,
+				  const int32_t readLen,
+				  const int32_t n) {
+
+	typedef typename V::vec vec;
+	const int32_t lanes = V::lanes8 / 2;
+	int32_t segLen = (readLen + lanes - 1) / lanes;
+	vec* vProfile = (vec*)ssw_calloc(n * segLen * sizeof(vec));
+	int16_t* t = (int16_t*)vProfile;
+	int32_t nt, i, j;
+	int32_t segNum;
+
+	/* Generate query profile rearrange query sequence & calculate the weight of match/mismatch */
+	for (nt = 0; LIKELY(nt < n); nt ++) {
+		for (i = 0; i < segLen; i ++) {
+			j = i;
+			for (segNum = 0; LIKELY(segNum < lanes) ; segNum ++) {
+				*t++ = j>= readLen ? 0 : mat[nt * n + read_num[j]];
+				j += segLen;
+			}
+		}
+	}
+	return vProfile;
+}
+
+template <class V>
+alignment_end* striped_sw_word (const int8_t* ref,
+							 int8_t ref_dir,	// 0: forward ref; 1: reverse ref
+							 int32_t refLen,
+							 int32_t readLen,
+							 const uint8_t weight_gapO, /* will be used as - */
+							 const uint8_t weight_gapE, /* will be used as - */
+							 const void* profile,
+							 uint16_t terminate,
+							 int32_t maskLen) {
+
+	typedef typename V::vec vec;
+	const int32_t lanes = V::lanes8 / 2;
+	const vec* vProfile = (const vec*)profile;
+	uint16_t max = 0;		                     /* the max alignment score */
+	int32_t end_read = readLen - 1;
+	int32_t end_ref = 0; /* 1_based best alignment ending point; Initialized as isn't aligned - 0. */
+	int32_t segLen = (readLen + lanes - 1) / lanes; /* number of segment */
+
+	/* array to record the largest score of each reference position */
+	uint16_t* maxColumn = (uint16_t*) calloc(refLen, 2);
+
+	/* Define 0 vector. */
+	vec vZero = V::zero();
+
+	vec* pvHStore = (vec*) ssw_calloc(segLen * sizeof(vec));
+	vec* pvHLoad = (vec*) ssw_calloc(segLen * sizeof(vec));
+	vec* pvE = (vec*) ssw_calloc(segLen * sizeof(vec));
+	vec* pvHmax = (vec*) ssw_calloc(segLen * sizeof(vec));
+
+	int32_t i, j, k;
+	/* insertion begin vector */
+	vec vGapO = V::set1_epi16(weight_gapO);
+
+	/* insertion extension vector */
+	vec vGapE = V::set1_epi16(weight_gapE);
+
+	vec vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
+	vec vMaxMark = vZero; /* Trace the highest score till the previous column. */
+	int32_t edge, begin = 0, end = refLen, step = 1;
+
+	/* outer loop to process the reference sequence */
+	if (ref_dir == 1) {
+		begin = refLen - 1;
+		end = -1;
+		step = -1;
+	}
+	for (i = begin; LIKELY(i != end); i += step) {
+		vec e, vF = vZero; /* Initialize F value to 0.
+							   Any errors to vH values will be corrected in the Lazy_F loop.
+							 */
+		vec vH = pvHStore[segLen - 1];
+		vH = V::shift_word(vH); /* Shift vH by 2 byte towards the higher lanes. */
+
+		/* Swap the 2 H buffers. */
+		vec* pv = pvHLoad;
+
+		vec vMaxColumn = vZero; /* vMaxColumn is used to record the max values of column i. */
+
+		const vec* vP = vProfile + ref[i] * segLen; /* Right part of the vProfile */
+		pvHLoad = pvHStore;
+		pvHStore = pv;
+
+		/* inner loop to process the query sequence */
+		for (j = 0; LIKELY(j < segLen); j ++) {
+			vH = V::adds_epi16(vH, V::load(vP + j));
+
+			/* Get max from vH, vE and vF. */
+			e = V::load(pvE + j);
+			vH = V::max_epi16(vH, e);
+			vH = V::max_epi16(vH, vF);
+			vMaxColumn = V::max_epi16(vMaxColumn, vH);
+
+			/* Save vH values. */
+			V::store(pvHStore + j, vH);
+
+			/* Update vE value. */
+			vH = V::subs_epu16(vH, vGapO); /* saturation arithmetic, result >= 0 */
+			e = V::subs_epu16(e, vGapE);
+			e = V::max_epi16(e, vH);
+			V::store(pvE + j, e);
+
+			/* Update vF value. */
+			vF = V::subs_epu16(vF, vGapE);
+			vF = V::max_epi16(vF, vH);
+
+			/* Load the next vH. */
+			vH = V::load(pvHLoad + j);
+		}
+
+		/* Lazy_F loop: has been revised to disallow adjecent insertion and then deletion, so don't update E(i, j), learn from SWPS3 */
+		for (k = 0; LIKELY(k < lanes); ++k) {
+			vF = V::shift_word(vF);
+			for (j = 0; LIKELY(j < segLen); ++j) {
+				vH = V::load(pvHStore + j);
+				vH = V::max_epi16(vH, vF);
+				vMaxColumn = V::max_epi16(vMaxColumn, vH); //newly added line
+				V::store(pvHStore + j, vH);
+				vH = V::subs_epu16(vH, vGapO);
+				vF = V::subs_epu16(vF, vGapE);
+				if (UNLIKELY(! V::any_gt_epi16(vF, vH))) goto end;
+			}
+		}
+
+end:
+		vMaxScore = V::max_epi16(vMaxScore, vMaxColumn);
+		if (! V::all_eq_epi16(vMaxMark, vMaxScore)) {
+			uint16_t temp;
+			vMaxMark = vMaxScore;
+			temp = V::hmax_epi16(vMaxScore);
+
+			if (LIKELY(temp > max)) {
+				max = temp;
+				end_ref = i;
+				for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
+			}
+		}
+
+		/* Record the max score of current column. */
+		maxColumn[i] = V::hmax_epi16(vMaxColumn);
+		if (maxColumn[i] == terminate) break;
+	}
+
+	/* Trace the alignment ending position on read. */
+	uint16_t *t = (uint16_t*)pvHmax;
+	int32_t column_len = segLen * lanes;
+	for (i = 0; LIKELY(i < column_len); ++i, ++t) {
+		int32_t temp;
+		if (*t == max) {
+			temp = i / lanes + i % lanes * segLen;
+			if (temp < end_read) end_read = temp;
+		}
+	}
+
+	ssw_free(pvHmax);
+	ssw_free(pvE);
+	ssw_free(pvHLoad);
+	ssw_free(pvHStore);
+
+	/* Find the most possible 2nd best alignment. */
+	alignment_end* bests = (alignment_end*) calloc(2, sizeof(alignment_end));
+	bests[0].score = max;
+	bests[0].ref = end_ref;
+	bests[0].read = end_read;
+
+	bests[1].score = 0;
+	bests[1].ref = 0;
+	bests[1].read = 0;
+
+	edge = (end_ref - maskLen) > 0 ? (end_ref - maskLen) : 0;
+	for (i = 0; i < edge; i ++) {
+		if (maxColumn[i] > bests[1].score) {
+			bests[1].score = maxColumn[i];
+			bests[1].ref = i;
+		}
+	}
+	edge = (end_ref + maskLen) > refLen ? refLen : (end_ref + maskLen);
+	for (i = edge; i < refLen; i ++) {
+		if (maxColumn[i] > bests[1].score) {
+			bests[1].score = maxColumn[i];
+			bests[1].ref = i;
+		}
+	}
+
+	free(maxColumn);
+	return bests;
+}
+
+} // namespace
+
+/* The kernel table of the traits struct V. */
+#define SSW_KERNEL_TABLE(V, name) { name, V::lanes8, striped_profile_byte<V>, striped_profile_word<V>, striped_sw_byte<V>, striped_sw_word<V> }
+
+#endif	// SSW_KERNEL_H
@@ -0,0 +1,59 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// This header declares the width of the suffix index. The index and MEM code is templated on the
+// unsigned type Index of SA and of the MEM positions; LCP, MEM lengths and sequence numbers use the
+// signed type of the same width. find_mem() uses 32 bit arrays for texts up to INDEX32_MAX_LENGTH
+// and 64 bit arrays above, from one binary. gsacak.c is compiled for both widths: gsacak() is the
+// 32 bit build and gsacak_64() the 64 bit one (see gsacak64.c); gsacak.h itself is C only, its
+// typedefs follow the width it is compiled for.
+#ifndef SUFFIX_INDEX_H
+#define SUFFIX_INDEX_H
+
+#include <cstdint>
+#include <type_traits>
+
+// Longest text of the 32 bit index; gsacak keeps a flag in the top bit of SA, so it stays below 2^31.
+#define INDEX32_MAX_LENGTH ((uint64_t)INT32_MAX)
+
+// The signed type of the index width, of LCP values and MEM lengths
+template <typename Index>
+using IndexInt = typename std::make_signed<Index>::type;
+
+extern "C" {
+int gsacak(unsigned char* s, uint32_t* SA, int32_t* LCP, int32_t* DA, uint32_t n);
+int gsacak_64(unsigned char* s, uint64_t* SA, int64_t* LCP, int32_t* DA, uint64_t n);
+}
+
+// gsacak() of the index width, LCP and DA may be NULL.
+inline int build_gsacak(const unsigned char* s, uint32_t* SA, int32_t* LCP, int32_t* DA, uint32_t n) {
+    return gsacak((unsigned char*)s, SA, LCP, DA, n);
+}
+
+inline int build_gsacak(const unsigned char* s, uint64_t* SA, int64_t* LCP, int32_t* DA, uint64_t n) {
+    return gsacak_64((unsigned char*)s, SA, LCP, DA, n);
+}
+
+// True if a text of length n is indexed with 32 bit arrays.
+inline bool use_index32(uint64_t n) {
+    return n <= INDEX32_MAX_LENGTH;
+}
+
+#endif
@@ -24,7 +24,7 @@
 #define UTILS_H
 
 #include "common.h"
-#include "kseq.h"
+#include "sequence_store.h"
 #include <fstream>
 #include <iomanip> 
 #include <chrono> 
@@ -144,6 +144,14 @@ private:
 */
 void read_data(const char* data_path, std::vector<std::string>& data, std::vector<std::string>& name, bool verbose);
 
+/**
+ * @brief: read fasta and fastq format data into a sequence store
+ * @param data_path   the path to the target data
+ * @param data store sequence content
+ * @param name store sequence name
+*/
+void read_data(const char* data_path, SequenceStore& data, std::vector<std::string>& name, bool verbose);
+
 /**
  * @brief: Check whether the file exists in the specified path.
  * @param data_path   The file path to check.
@@ -151,6 +159,30 @@ void read_data(const char* data_path, std::vector<std::string>& data, std::vecto
 */
 bool access_file(const char* data_path);
 
+/**
+ * @brief Read a whole file into memory.
+ * @param path The file path.
+ * @param content Receives the bytes of the file.
+ * @return True if the file could be read, otherwise false.
+*/
+bool read_file(const std::string& path, std::string& content);
+
+/**
+ * @brief Write a file through a temporary file that is renamed, so that no reader ever sees a partial file.
+ * @param path The file path.
+ * @param content The bytes to write.
+ * @return True if the file was written, otherwise false.
+*/
+bool write_file_atomic(const std::string& path, const std::string& content);
+
+/**
+ * @brief The 64 bit FNV-1a hash of data, continued from hash.
+ * @param data The bytes to hash.
+ * @param hash The hash of the bytes before data, or the FNV offset basis to start.
+ * @return The hash.
+*/
+uint64_t fnv1a_hash(std::string_view data, uint64_t hash = 0xcbf29ce484222325ULL);
+
 /**
  * @brief Cleans the input sequence by removing any non-ATCG characters. 
  * This function removes any characters from the input sequence that are not A, T, C, or G (case-insensitive). 
@@ -160,6 +192,25 @@ bool access_file(const char* data_path);
 */
 std::string clean_sequence(std::string sequence);
 
+/**
+ * @brief Parse an aligned FASTA held in memory.
+ * Unlike read_data, gap characters are kept: letters are upper-cased and '-' is preserved,
+ * whitespace is skipped. The records are appended to data and name in file order.
+ * @param buffer The aligned FASTA content.
+ * @param data Receives the aligned sequences.
+ * @param name Receives the sequence names.
+*/
+void parse_alignment(const std::string& buffer, std::vector<std::string>& data, std::vector<std::string>& name);
+
+/**
+ * @brief Read an aligned FASTA file, keeping gap characters.
+ * @param data_path The path to the aligned FASTA file.
+ * @param data Receives the aligned sequences.
+ * @param name Receives the sequence names.
+ * @return True if the file could be read, otherwise false.
+*/
+bool read_alignment(const char* data_path, std::vector<std::string>& data, std::vector<std::string>& name);
+
 /**
 * @brief Print information about the FMAlign2 algorithm
 * This function prints various information about the FMAlign2 algorithm,
@@ -23,10 +23,15 @@
 #include "include/common.h"
 #include "include/utils.h"
 #include "include/mem_finder.h"
+#include "include/anchor_sample.h"
+#include "include/incremental.h"
 #include "include/sequence_split_align.h"
-#if defined(__linux__)
-#include "include/thread_pool.h"
-#endif
+#include "include/msa_backend.h"
+#include "include/distributed.h"
+#include "include/metrics.h"
+#include "include/checkpoint.h"
+#include "include/memory_budget.h"
+#include "include/daemon.h"
 #include <thread>
 #include <filesystem>
 namespace fs = std::filesystem;
@@ -43,7 +48,12 @@ std::string readFile(const std::string& path) {
     }
     std::ostringstream buf;
     buf << ifs.rdbuf();
-    return buf.str();
+    std::string content = buf.str();
+    // 去掉结尾的换行，否则追加的重定向会落到下一行
+    while (!content.empty() && (content.back() == '\n' || content.back() == '\r' || content.back() == ' ')) {
+        content.pop_back();
+    }
+    return content;
 }
 
 #include <string>
@@ -52,47 +62,57 @@ std::string readFile(const std::string& path) {
 
 
 int test_cmd(const std::string& cmdTemplate, int thread = 1) {
-    const fs::path tempDir = "./temp";
-    const fs::path inPath = tempDir / "tiny.fasta";
-    const fs::path outPath = tempDir / "aligned.fasta";
+    const std::string tiny_fasta =
+        R"(>seq1
+ACGTACGTGA
+>seq2
+ACGTTGCA
+>seq3
+ACGTACGA
+)";
+
+    // Stream templates are checked through the same pipes that the real fragments use.
+    if (is_stream_template(cmdTemplate)) {
+        std::cout << "Running: " << cmdTemplate << " (stdin/stdout)\n";
+        std::string aligned;
+        int rc = run_msa_stream(cmdTemplate, tiny_fasta, aligned, thread);
+        std::vector<std::string> aligned_seq, aligned_name;
+        parse_alignment(aligned, aligned_seq, aligned_name);
+        if (rc == 0 && aligned_seq.size() == 3) {
+            std::cout << "cmd finished successfully.\n";
+            return 0;
+        }
+        std::cout << "cmd failed with code: " << rc << "\n";
+        return rc == 0 ? 1 : rc;
+    }
+
+    // Only the two files created here are removed, the folder itself may be shared (e.g. /dev/shm).
+    const std::string suffix = generateRandomString(10);
+    const fs::path inPath = global_args.tmp_folder + "tiny_" + suffix + ".fasta";
+    const fs::path outPath = global_args.tmp_folder + "tiny_" + suffix + ".aligned.fasta";
 
     int rc = 0;  // 最终返回值（命令退出码或我们的错误码）
 
     // 用 do{...}while(false) 做“单出口”
     do {
-        // 1) 创建 ./temp
-        std::error_code ec;
-        fs::create_directories(tempDir, ec);
-        if (ec) {
-            std::cerr << "Failed to create " << tempDir << ": " << ec.message() << "\n";
-            rc = 1; break;
-        }
-
-        // 2) 写一个很小的 FASTA
+        // 1) 写一个很小的 FASTA
         {
             std::ofstream ofs(inPath);
             if (!ofs) {
                 std::cerr << "Cannot open " << inPath << " for writing.\n";
                 rc = 1; break;
             }
-            ofs <<
-                R"(>seq1
-ACGTACGTGA
->seq2
-ACGTTGCA
->seq3
-ACGTACGA
-)";
+            ofs << tiny_fasta;
         }
 
-        // 3) 生成命令
+        // 2) 生成命令
         std::string cmd = buildCommand(cmdTemplate, inPath.string(), outPath.string(), thread);
         std::cout << "Running: " << cmd << "\n";
 
-        // 4) 执行（注意 system 返回的是 wait 状态码，简单起见直接用）
+        // 3) 执行（注意 system 返回的是 wait 状态码，简单起见直接用）
         rc = std::system(cmd.c_str());
 
-        // 5) 打印结果状态 & 预览输出
+        // 4) 打印结果状态
         if (rc == 0) {
             std::cout << "cmd finished successfully.\n";
         }
@@ -100,23 +120,15 @@ ACGTACGA
             std::cout << "cmd failed with code: " << rc << "\n";
         }
 
-        if (fs::exists(outPath)) {
-            std::ifstream ifs(outPath);
-            std::string line; int cnt = 0;
-          
-        }
-        else {
+        if (!fs::exists(outPath)) {
             std::cout << "Output file not found: " << outPath << "\n";
         }
 
     } while (false);
 
-    // 统一清理 ./temp（无论上面成功或失败）
     std::error_code delEc;
-    fs::remove_all("./temp", delEc);
-    if (delEc) {
-        std::cerr << "Warning: failed to remove ./temp: " << delEc.message() << "\n";
-    }
+    fs::remove(inPath, delEc);
+    fs::remove(outPath, delEc);
 
     return rc;
 }
@@ -128,11 +140,14 @@ int main(int argc, char** argv) {
     // Create an ArgParser object to parse command line arguments.
     ArgParser parser;
     std::string output = "";
+    std::string client_path;
+    std::string daemon_path;
+    uint64_t daemon_max_input = 0;
     // Add command line arguments to the ArgParser object.
-    parser.add_argument("i", true, "/path/to/input.fasta");
-    parser.add_argument_help("i", "The path to the input fasta file.");
-    parser.add_argument("o", true, "/path/to/output.fasta");
-    parser.add_argument_help("o", "The path to the output fasta file.");
+    parser.add_argument("i", false, "");
+    parser.add_argument_help("i", "The path to the input fasta file, required unless -daemon is given.");
+    parser.add_argument("o", false, "");
+    parser.add_argument_help("o", "The path to the output fasta file, required unless -daemon is given.");
     parser.add_argument("p", false, "mafft");
     parser.add_argument_help("p", "MSA method (mafft, halign3, halign4) or Path to MSA command file.");
 
@@ -144,6 +159,60 @@ int main(int argc, char** argv) {
 
     parser.add_argument("f", false, "accurate");
     parser.add_argument_help("f", "The filter MEMs mode. The default is accurate mode.");
+    parser.add_argument("index", false, "full");
+    parser.add_argument_help("index", "Suffix index mode, full or lean. lean drops the document array and stores the LCP array in one byte per base, it needs about 5 instead of 12 bytes per base (9 instead of 20 with the 64 bit index of inputs above 2^31 bases). lean always builds the suffix array with gsacak; the parallel builder that full uses with -t 8 or more on inputs of 2^24 bases or more needs 4 (8) bytes per base more while it runs.");
+    parser.add_argument("cache", false, "0");
+    parser.add_argument_help("cache", "Index cache option, 0 or 1. With 1 the suffix index is stored in <input>.fmidx and reused by later runs on the same input, e.g. when trying other -l or -f values.");
+    parser.add_argument("small", false, "1000");
+    parser.add_argument_help("small", "Gap fragments up to this total length in bases are aligned in-process instead of by the MSA method, 0 sends all of them to the MSA method. Trivial fragments are never sent.");
+    parser.add_argument("trivial_mismatch", false, "0");
+    parser.add_argument_help("trivial_mismatch", "Part of the bases, 0 to 1, in which gap fragment rows of equal length may differ and still be written as they are, without gaps and without the MSA method. The default 0 only takes rows that need no alignment at all.");
+    parser.add_argument("dedup", false, "1");
+    parser.add_argument_help("dedup", "Deduplication option, 0 or 1. With 1 identical sequences, and identical rows of a fragment, are aligned once and copied back in the output.");
+    parser.add_argument("sw_window", false, "0");
+    parser.add_argument_help("sw_window", "Half width in bases of the first window the Smith-Waterman expansion of a missing chain searches around its expected position, doubled until the match is good. The default 0 searches the whole gap between the neighboring chains.");
+    parser.add_argument("rec_depth", false, "0");
+    parser.add_argument_help("rec_depth", "Recursion depth for oversized gap regions. A region whose longest sequence exceeds -rec_len is split again by the MEMs found in it, with half the minimal MEM length, up to this many levels. The default 0 sends every region to the MSA method unsplit.");
+    parser.add_argument("rec_len", false, "20000");
+    parser.add_argument_help("rec_len", "Length in bases of the longest sequence of a gap region above which -rec_depth splits the region again.");
+    parser.add_argument("sample", false, "0");
+    parser.add_argument_help("sample", "Number of sequences the MEM anchors are found on. The anchors are then placed on the other sequences by exact search and Smith-Waterman, so the index grows with the sample instead of the input. The default 0 indexes all sequences.");
+    parser.add_argument("sample_mode", false, "sketch");
+    parser.add_argument_help("sample_mode", "How the -sample sequences are chosen: sketch picks a diverse sample by k-mer sketches, random a uniform one.");
+    parser.add_argument("anchors", false, "0");
+    parser.add_argument_help("anchors", "Anchor file option, 0 or 1. With 1 the columns of the anchors in the alignment are written to <output>.anchors, which -add needs to add sequences to it later.");
+    parser.add_argument("add", false, "none");
+    parser.add_argument_help("add", "Fasta file of new sequences to add to the alignment given by -i instead of aligning it, the alignment must have been written with -anchors 1. Only the new sequences are aligned, against the columns of the alignment, and the result is written to -o with its own anchor file. The default none aligns -i.");
+    parser.add_argument("daemon", false, "none");
+    parser.add_argument_help("daemon", "Unix domain socket to serve alignment jobs on instead of aligning -i. The threads and the checked MSA method stay up for all jobs, and jobs run at the same time. The default none aligns -i.");
+    parser.add_argument("daemon_max_input", false, "1G");
+    parser.add_argument_help("daemon_max_input", "Largest input of a -daemon job, e.g. 256M. The daemon refuses larger jobs before it reads them.");
+    parser.add_argument("client", false, "none");
+    parser.add_argument_help("client", "Socket of a running -daemon to align -i by, with the alignment options of this command line, writing the alignment to -o. The default none aligns in this process.");
+    parser.add_argument("dist", false, "none");
+    parser.add_argument_help("dist", "Distributed mode for the MSA jobs: none, mpi (started by mpirun, rank 0 coordinates and the other ranks run the MSA method; needs a build with MPI=1), or the job array stages prepare, work and merge.");
+    parser.add_argument("dist_dir", false, "fmalign2_dist");
+    parser.add_argument_help("dist_dir", "Shared folder of the fragment files, the manifest and the SLURM script of -dist prepare, work and merge.");
+    parser.add_argument("dist_tasks", false, "64");
+    parser.add_argument_help("dist_tasks", "Number of array tasks in the SLURM script written by -dist prepare, at most one per fragment.");
+    parser.add_argument("dist_part", false, "auto");
+    parser.add_argument_help("dist_part", "Part of the manifest aligned by -dist work, as i/n. The default auto takes it from the SLURM array task, or aligns everything outside of SLURM.");
+    parser.add_argument("max_mem", false, "none");
+    parser.add_argument_help("max_mem", "Memory budget of the run and its MSA jobs together, e.g. 64G. MSA jobs are only started while their predicted memory fits, aligned gap regions are moved to the -tmp folder while the memory of FMAlign2 itself exceeds it, and the lean index is used if the full one does not fit. The default none sets no limit.");
+    parser.add_argument("checkpoint", false, "none");
+    parser.add_argument_help("checkpoint", "Folder to keep the split points, the expanded chains and every fragment alignment in as soon as they are computed. A failed MSA job then no longer stops the others. The default none keeps nothing.");
+    parser.add_argument("resume", false, "0");
+    parser.add_argument_help("resume", "Resume option, 0 or 1. With 1 the results in the -checkpoint folder that match the input and the options are reused, and only missing or failed fragments are aligned.");
+    parser.add_argument("bgzf", false, "0");
+    parser.add_argument_help("bgzf", "Compressed output option, 0 or 1. With 1 the alignment is written BGZF compressed (readable by gzip, bgzip and samtools) using all threads.");
+    parser.add_argument("tmp", false, "auto");
+    parser.add_argument_help("tmp", "Folder for temporary fragment files, only used when the MSA command needs {input}/{output}. The default uses /dev/shm if available, otherwise ./temp/.");
+    parser.add_argument("cost_log", false, "none");
+    parser.add_argument_help("cost_log", "File to write the predicted and the measured cost of every MSA job to, as tab separated text. The default none writes nothing.");
+    parser.add_argument("metrics", false, "none");
+    parser.add_argument_help("metrics", "File to write the run metrics to as JSON: wall and CPU time and peak memory of every phase, and one record per chain expansion, fragment and MSA backend call. The default none records nothing.");
+    parser.add_argument("trace", false, "none");
+    parser.add_argument_help("trace", "File to write the same records to as Chrome trace events, for chrome://tracing or Perfetto. The default none writes nothing.");
     parser.add_argument("v", false, "1");
     parser.add_argument_help("v", "Verbose option, 0 or 1. You could ignore it.");
     parser.add_argument("h", false, "help");
@@ -152,7 +221,24 @@ int main(int argc, char** argv) {
     // Add command line arguments to the ArgParser object.
     try {
         parser.parse_args(argc, argv);
-        global_args.data_path = parser.get("i");
+        daemon_path = parser.get("daemon");
+        client_path = parser.get("client");
+        if (daemon_path != "none" && client_path != "none") {
+            throw "-daemon and -client cannot be used together";
+        }
+        if (daemon_path == "none") {
+            daemon_path = "";
+            if (!parser.has("i")) {
+                throw std::invalid_argument("Missing required argument: -i");
+            }
+            if (!parser.has("o")) {
+                throw std::invalid_argument("Missing required argument: -o");
+            }
+            global_args.data_path = parser.get("i");
+        }
+        if (client_path == "none") {
+            client_path = "";
+        }
         std::string tmp_thread = parser.get("t");
         if (tmp_thread == "max_cpu_num") {
             global_args.thread = std::thread::hardware_concurrency();
@@ -160,6 +246,8 @@ int main(int argc, char** argv) {
         else {
             global_args.thread = std::stoi(tmp_thread);
         }
+        // all parallel phases share the workers started here
+        Scheduler::instance().set_threads(global_args.thread);
         std::string tmp_len = parser.get("l");
         if (tmp_len != "default") {
             global_args.min_mem_length = std::stoi(parser.get("l"));
@@ -179,6 +267,114 @@ int main(int argc, char** argv) {
             throw "filer mode --f parameter should be accurate or fast!";
         }
 
+        global_args.index_mode = parser.get("index");
+        if (global_args.index_mode != "full" && global_args.index_mode != "lean") {
+            throw "index mode -index parameter should be full or lean!";
+        }
+
+        global_args.index_cache = std::stoi(parser.get("cache"));
+        if (global_args.index_cache != 0 && global_args.index_cache != 1) {
+            throw "index cache -cache parameter should be 1 or 0";
+        }
+
+        global_args.small_fragment = std::stoi(parser.get("small"));
+        if (global_args.small_fragment < 0) {
+            throw "small fragment -small parameter should not be negative";
+        }
+
+        global_args.trivial_mismatch = std::stod(parser.get("trivial_mismatch"));
+        if (global_args.trivial_mismatch < 0 || global_args.trivial_mismatch > 1) {
+            throw "trivial fragment -trivial_mismatch parameter should be between 0 and 1";
+        }
+
+        global_args.dedup = std::stoi(parser.get("dedup"));
+        if (global_args.dedup != 0 && global_args.dedup != 1) {
+            throw "deduplication -dedup parameter should be 1 or 0";
+        }
+
+        global_args.sw_window = std::stoi(parser.get("sw_window"));
+        if (global_args.sw_window < 0) {
+            throw "SW window -sw_window parameter should not be negative";
+        }
+
+        global_args.recursive_depth = std::stoi(parser.get("rec_depth"));
+        if (global_args.recursive_depth < 0) {
+            throw "recursion depth -rec_depth parameter should not be negative";
+        }
+
+        global_args.recursive_length = std::stoi(parser.get("rec_len"));
+        if (global_args.recursive_length < 1) {
+            throw "recursion length -rec_len parameter should be positive";
+        }
+
+        global_args.sample_size = std::stoi(parser.get("sample"));
+        if (global_args.sample_size < 0) {
+            throw "sample size -sample parameter should not be negative";
+        }
+
+        global_args.sample_mode = parser.get("sample_mode");
+        if (global_args.sample_mode != "sketch" && global_args.sample_mode != "random") {
+            throw "sample mode -sample_mode parameter should be sketch or random";
+        }
+
+        global_args.dist_mode = parser.get("dist");
+        if (global_args.dist_mode != "none" && global_args.dist_mode != "mpi" && global_args.dist_mode != "prepare"
+            && global_args.dist_mode != "work" && global_args.dist_mode != "merge") {
+            throw "distributed mode -dist parameter should be none, mpi, prepare, work or merge";
+        }
+        global_args.dist_dir = parser.get("dist_dir");
+        global_args.dist_tasks = std::stoi(parser.get("dist_tasks"));
+        if (global_args.dist_tasks < 1) {
+            throw "array tasks -dist_tasks parameter should be positive";
+        }
+        global_args.dist_part = parser.get("dist_part");
+
+        std::string max_mem = parser.get("max_mem");
+        global_args.max_mem = 0;
+        if (max_mem != "none" && !parse_memory_size(max_mem, global_args.max_mem)) {
+            throw "memory budget -max_mem parameter should be a size such as 64G, or none";
+        }
+        MemoryBudget::instance().set_limit(global_args.max_mem);
+
+        global_args.checkpoint_dir = parser.get("checkpoint");
+        if (global_args.checkpoint_dir == "none") {
+            global_args.checkpoint_dir = "";
+        }
+        global_args.resume = std::stoi(parser.get("resume"));
+        if (global_args.resume != 0 && global_args.resume != 1) {
+            throw "resume -resume parameter should be 1 or 0";
+        }
+        if (global_args.resume && global_args.checkpoint_dir.empty()) {
+            throw "resume -resume needs a -checkpoint folder";
+        }
+
+        global_args.anchors = std::stoi(parser.get("anchors"));
+        if (global_args.anchors != 0 && global_args.anchors != 1) {
+            throw "anchor file -anchors parameter should be 1 or 0";
+        }
+        global_args.add_path = parser.get("add");
+        if (global_args.add_path == "none") {
+            global_args.add_path = "";
+        }
+        else {
+            // the output can take more sequences the same way
+            global_args.anchors = 1;
+        }
+
+        global_args.bgzf = std::stoi(parser.get("bgzf"));
+        if (global_args.bgzf != 0 && global_args.bgzf != 1) {
+            throw "compressed output -bgzf parameter should be 1 or 0";
+        }
+
+        global_args.cost_log = parser.get("cost_log");
+        if (global_args.cost_log == "none") {
+            global_args.cost_log = "";
+        }
+
+        std::string metrics_path = parser.get("metrics");
+        std::string trace_path = parser.get("trace");
+        metrics_start(metrics_path == "none" ? "" : metrics_path, trace_path == "none" ? "" : trace_path);
+
         global_args.verbose = std::stoi(parser.get("v"));
         if (global_args.verbose != 0 && global_args.verbose != 1) {
             throw "verbose should be 1 or 0";
@@ -186,7 +382,12 @@ int main(int argc, char** argv) {
         std::string cmd_template;
         std::string cmd_path = parser.get("p");
         if (cmd_path == "mafft") {
+#ifdef _WIN32
 			cmd_template = "mafft --thread {thread} {input} > {output}";
+#else
+            // MAFFT reads the fragment from stdin and prints the alignment to stdout, no temporary files needed.
+            cmd_template = "mafft --thread {thread} /dev/stdin";
+#endif
         }
         else if (cmd_path == "halign3") {
             cmd_template = "halign -t {thread} -o {output} {input}";
@@ -202,10 +403,30 @@ int main(int argc, char** argv) {
             cmd_template = readFile(cmd_path);
         }
 
-        int return_code = test_cmd(cmd_template);
-        if (return_code != 0) {
-            throw "The command template in " + cmd_path + " is invalid or the MSA software cannot be executed!";
-            exit(1);
+        global_args.tmp_folder = resolve_tmp_folder(parser.get("tmp"));
+        if (daemon_path.empty()) {
+            global_args.output_path = parser.get("o");
+        }
+        else if (global_args.dist_mode != "none" || !global_args.add_path.empty() || !global_args.checkpoint_dir.empty()) {
+            throw "-daemon cannot be used with -dist, -add or -checkpoint";
+        }
+        else if (!parse_memory_size(parser.get("daemon_max_input"), daemon_max_input) || daemon_max_input == 0) {
+            throw "daemon input -daemon_max_input parameter should be a positive size such as 1G";
+        }
+        dist_start(cmd_path, argv[0]);
+        // a coordinator that hands every backend job out needs no MSA software of its own, -add none at all
+        // a client leaves the MSA software to its daemon
+        if (dist_runs_backend() && global_args.add_path.empty() && client_path.empty()) {
+            int return_code = test_cmd(cmd_template);
+            if (return_code != 0 && cmd_path == "mafft" && is_stream_template(cmd_template)) {
+                // MAFFT builds that cannot read /dev/stdin still work through temporary files.
+                cmd_template = "mafft --thread {thread} {input} > {output}";
+                return_code = test_cmd(cmd_template);
+            }
+            if (return_code != 0) {
+                throw "The command template in " + cmd_path + " is invalid or the MSA software cannot be executed!";
+                exit(1);
+            }
         }
 
         global_args.package = cmd_template;
@@ -215,7 +436,6 @@ int main(int argc, char** argv) {
 
 
 
-        global_args.output_path = parser.get("o");
     } // Catch any invalid arguments and print the help message.
     catch (const std::invalid_argument& e) {
         std::cerr << "Error: " << e.what() << std::endl;
@@ -223,19 +443,40 @@ int main(int argc, char** argv) {
         parser.print_help();
         return 1;
     }
+    // MPI workers and job array tasks only align the fragments of a coordinator
+    if (dist_is_worker()) {
+        return dist_run_worker();
+    }
+    if (!client_path.empty()) {
+        return run_client(client_path);
+    }
+    if (!daemon_path.empty()) {
+        return run_daemon(daemon_path, daemon_max_input);
+    }
     if (global_args.verbose) {
         print_algorithm_info();
     }
 
-    std::vector<std::string> data;
+    SequenceStore data;
     std::vector<std::string> name;
 
     try {
-        // Read data from the input file and store in data and name vectors
-        read_data(global_args.data_path.c_str(), data, name, true);
-        // Find MEMs in the sequences and split the sequences into fragments for parallel alignment.
-        std::vector<std::vector<std::pair<int_t, int_t>>> split_points_on_sequence = find_mem(data);
-        split_and_parallel_align(data, name, split_points_on_sequence);
+        if (!global_args.add_path.empty()) {
+            // -add aligns the new sequences against the columns of an earlier alignment
+            add_sequences(global_args.data_path, global_args.add_path);
+        }
+        else {
+            // Read data from the input file and store in the sequence store and name vector
+            MetricsPhase read_phase("read_input");
+            read_data(global_args.data_path.c_str(), data, name, true);
+            read_phase.end();
+            std::vector<uint_t> representative;
+            std::vector<std::vector<std::string>> concat_string = align_sequences(data, representative);
+            // -dist prepare only writes the fragments for the workers
+            if (dist_writes_alignment()) {
+                concat_alignment(concat_string, name, representative);
+            }
+        }
     }
     catch (const std::bad_alloc& e) { // Catch any bad allocations and print an error message.
         print_table_bound();
@@ -244,6 +485,9 @@ int main(int argc, char** argv) {
         exit(1);
     }
 
+    dist_finish();
+    metrics_finish();
+
     double total_time = timer.elapsed_time();
     std::stringstream s;
     s << std::fixed << std::setprecision(2) << total_time;
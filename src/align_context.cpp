@@ -0,0 +1,117 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/align_context.h"
+#include "../include/fasta_reader.h"
+#include "../include/sequence_split_align.h"
+
+namespace {
+
+// Runs the calling thread with other options until the end of the scope.
+class ThreadArgsScope {
+public:
+    explicit ThreadArgsScope(GlobalArgs* args) : previous_(thread_args()) { set_thread_args(args); }
+    ~ThreadArgsScope() { set_thread_args(previous_); }
+    ThreadArgsScope(const ThreadArgsScope&) = delete;
+    ThreadArgsScope& operator=(const ThreadArgsScope&) = delete;
+private:
+    GlobalArgs* previous_;
+};
+
+} // namespace
+
+/**
+* @brief A context that aligns with the given options.
+* @param args The options, as the command line sets them in global_args; package must be a checked MSA command.
+*/
+AlignContext::AlignContext(const GlobalArgs& args) : args_(args) {
+    // these belong to the process, see align_context.h
+    args_.checkpoint_dir = "";
+    args_.resume = 0;
+    args_.dist_mode = "none";
+    args_.index_cache = 0;
+    args_.add_path = "";
+    args_.anchors = 0;
+    args_.data_path = "";
+    args_.output_path = "";
+}
+
+/**
+* @brief Align sequences. Every call works on its own copy of the options, so calls may run at the same time.
+* @param data The sequences, replaced by the distinct ones with -dedup 1.
+* @return The aligned row of every sequence in input order.
+* @throws std::runtime_error If the alignment fails, e.g. the MSA command or an allocation; the process goes on.
+*/
+std::vector<std::string> AlignContext::align(SequenceStore& data) const {
+    const uint_t seq_num = data.size();
+    if (seq_num == 0) {
+        return std::vector<std::string>();
+    }
+    // find_mem() settles -l and -f of the call in its options
+    GlobalArgs args = args_;
+    std::vector<uint_t> representative;
+    std::vector<std::vector<std::string>> concat_string;
+    {
+        ThreadArgsScope scope(&args);
+        concat_string = align_sequences(data, representative);
+    }
+
+    std::vector<uint_t> fragment_len = get_first_nonzero_lengths(concat_string);
+    uint_t width = 0;
+    for (uint_t length : fragment_len) {
+        width += length;
+    }
+    std::vector<std::string> aligned(seq_num);
+    for (uint_t i = 0; i < seq_num; i++) {
+        uint_t row = representative.empty() ? i : representative[i];
+        aligned[i].reserve(width);
+        for (uint_t k = 0; k < concat_string.size(); k++) {
+            aligned[i] += concat_string[k][row];
+        }
+    }
+    return aligned;
+}
+
+/**
+* @brief Align the records of FASTA or FASTQ text.
+* @param text The records.
+* @return The alignment as FASTA text, the rows in input order.
+* @throws std::runtime_error If the alignment fails, see align().
+*/
+std::string AlignContext::align_fasta(std::string_view text) const {
+    SequenceStore data;
+    std::vector<std::string> name;
+    parse_sequences(text, data, name);
+    std::vector<std::string> aligned = align(data);
+    size_t size = 0;
+    for (uint_t i = 0; i < aligned.size(); i++) {
+        size += name[i].size() + aligned[i].size() + 3;
+    }
+    std::string fasta;
+    fasta.reserve(size);
+    for (uint_t i = 0; i < aligned.size(); i++) {
+        fasta += '>';
+        fasta += name[i];
+        fasta += '\n';
+        fasta += aligned[i];
+        fasta += '\n';
+    }
+    return fasta;
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/alignment_writer.h"
+#include "../include/scheduler.h"
+#include <cstring>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_ZLIB
+// Header of a BGZF block: a gzip member with the extra field BC holding the block size - 1.
+static const unsigned char bgzf_header[18] = {
+    0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0
+};
+// The empty block that marks the end of a BGZF file.
+static const unsigned char bgzf_eof[28] = {
+    0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+#define BGZF_BLOCK_MAX 65536
+
+static inline void put_le(unsigned char* p, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        p[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+// Compress one block into out, which must hold BGZF_BLOCK_MAX bytes; returns the block size, 0 on failure.
+static size_t bgzf_compress_block(const char* data, size_t size, int level, unsigned char* out) {
+    // a block that does not shrink enough is stored, which always fits
+    for (int try_level : { level, 0 }) {
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if (deflateInit2(&zs, try_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return 0;
+        }
+        zs.next_in = (Bytef*)data;
+        zs.avail_in = size;
+        zs.next_out = out + sizeof(bgzf_header);
+        zs.avail_out = BGZF_BLOCK_MAX - sizeof(bgzf_header) - 8;
+        int status = deflate(&zs, Z_FINISH);
+        size_t compressed = zs.total_out;
+        deflateEnd(&zs);
+        if (status != Z_STREAM_END) {
+            continue;
+        }
+        size_t block_size = sizeof(bgzf_header) + compressed + 8;
+        memcpy(out, bgzf_header, sizeof(bgzf_header));
+        put_le(out + 16, block_size - 1, 2);
+        unsigned char* footer = out + sizeof(bgzf_header) + compressed;
+        put_le(footer, crc32(crc32(0, NULL, 0), (const Bytef*)data, size), 4);
+        put_le(footer + 4, size, 4);
+        return block_size;
+    }
+    return 0;
+}
+#endif
+
+/**
+* @brief Open a file for writing.
+* @param path The output path.
+* @param bgzf Write BGZF compressed output instead of plain text.
+* @param level The zlib compression level of BGZF output, 1 to 9.
+*/
+AlignmentWriter::AlignmentWriter(const std::string& path, bool bgzf, int level)
+    : file_(fopen(path.c_str(), "wb")), bgzf_(bgzf), level_(level), failed_(false) {
+    buffer_.reserve(WRITER_BUFFER_SIZE);
+#ifndef HAVE_ZLIB
+    if (bgzf_) {
+        std::cerr << "BGZF output needs zlib, writing plain text to " << path << std::endl;
+        bgzf_ = false;
+    }
+#endif
+}
+
+AlignmentWriter::~AlignmentWriter() {
+    if (file_) {
+        close();
+    }
+}
+
+/**
+* @brief Append bytes to the output.
+* @param data The bytes.
+*/
+void AlignmentWriter::write(std::string_view data) {
+    if (buffer_.size() + data.size() <= buffer_.capacity()) {
+        buffer_.insert(buffer_.end(), data.begin(), data.end());
+        return;
+    }
+    if (!bgzf_) {
+        // large pieces skip the buffer
+        flush_buffer();
+        if (data.size() >= buffer_.capacity()) {
+            write_file(data.data(), data.size());
+        }
+        else {
+            buffer_.insert(buffer_.end(), data.begin(), data.end());
+        }
+        return;
+    }
+    while (!data.empty()) {
+        size_t room = buffer_.capacity() - buffer_.size();
+        size_t take = std::min(room, data.size());
+        buffer_.insert(buffer_.end(), data.begin(), data.begin() + take);
+        data.remove_prefix(take);
+        if (buffer_.size() == buffer_.capacity()) {
+            flush_buffer();
+        }
+    }
+}
+
+void AlignmentWriter::write_file(const void* data, size_t size) {
+    if (size > 0 && fwrite(data, 1, size, file_) != size) {
+        failed_ = true;
+    }
+}
+
+void AlignmentWriter::flush_buffer() {
+    if (buffer_.empty() || file_ == NULL) {
+        buffer_.clear();
+        return;
+    }
+#ifdef HAVE_ZLIB
+    if (bgzf_) {
+        uint_t block_num = (buffer_.size() + BGZF_BLOCK_INPUT - 1) / BGZF_BLOCK_INPUT;
+        std::vector<unsigned char> compressed((size_t)block_num * BGZF_BLOCK_MAX);
+        std::vector<size_t> block_size(block_num);
+        parallel_for(0, block_num, 1, [&](uint_t b) {
+            size_t begin = (size_t)b * BGZF_BLOCK_INPUT;
+            size_t size = std::min<size_t>(BGZF_BLOCK_INPUT, buffer_.size() - begin);
+            block_size[b] = bgzf_compress_block(buffer_.data() + begin, size, level_, compressed.data() + (size_t)b * BGZF_BLOCK_MAX);
+        });
+        for (uint_t b = 0; b < block_num; b++) {
+            if (block_size[b] == 0) {
+                failed_ = true;
+            }
+            write_file(compressed.data() + (size_t)b * BGZF_BLOCK_MAX, block_size[b]);
+        }
+        buffer_.clear();
+        return;
+    }
+#endif
+    write_file(buffer_.data(), buffer_.size());
+    buffer_.clear();
+}
+
+/**
+* @brief Write everything that is buffered, and the end-of-file block of BGZF output, and close the file.
+* @return False if a write failed.
+*/
+bool AlignmentWriter::close() {
+    if (file_ == NULL) {
+        return false;
+    }
+    flush_buffer();
+#ifdef HAVE_ZLIB
+    if (bgzf_) {
+        write_file(bgzf_eof, sizeof(bgzf_eof));
+    }
+#endif
+    if (fclose(file_) != 0) {
+        failed_ = true;
+    }
+    file_ = NULL;
+    return !failed_;
+}
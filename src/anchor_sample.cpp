@@ -0,0 +1,240 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/anchor_sample.h"
+#include "../include/mem_finder.h"
+#include "../include/scheduler.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <random>
+
+static inline uint64_t mix_hash(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// The SKETCH_SIZE smallest distinct hashes of the k-mers of seq, in increasing order; k-mers with N are skipped.
+static std::vector<uint64_t> sketch_sequence(std::string_view seq) {
+    std::vector<uint64_t> hashes;
+    const uint64_t mask = ((uint64_t)1 << (2 * SKETCH_KMER)) - 1;
+    uint64_t kmer = 0;
+    uint_t valid = 0;
+    for (char c : seq) {
+        int code;
+        switch (c) {
+        case 'A': code = 0; break;
+        case 'C': code = 1; break;
+        case 'G': code = 2; break;
+        case 'T': case 'U': code = 3; break;
+        default: code = -1; break;
+        }
+        if (code < 0) {
+            valid = 0;
+            continue;
+        }
+        kmer = ((kmer << 2) | code) & mask;
+        if (++valid >= SKETCH_KMER) {
+            hashes.push_back(mix_hash(kmer));
+            // keep the buffer small, only the smallest hashes matter
+            if (hashes.size() >= 8 * SKETCH_SIZE) {
+                std::nth_element(hashes.begin(), hashes.begin() + SKETCH_SIZE, hashes.end());
+                hashes.resize(SKETCH_SIZE + 1);
+            }
+        }
+    }
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+    if (hashes.size() > SKETCH_SIZE) {
+        hashes.resize(SKETCH_SIZE);
+    }
+    return hashes;
+}
+
+// 1 - the Jaccard index of the k-mer sets estimated from two sketches.
+static double sketch_distance(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b) {
+    // the smallest hashes of the union, and how many of them both sketches hold
+    size_t i = 0, j = 0, taken = 0, shared = 0;
+    while (taken < SKETCH_SIZE && (i < a.size() || j < b.size())) {
+        if (j == b.size() || (i < a.size() && a[i] < b[j])) {
+            i++;
+        }
+        else if (i == a.size() || b[j] < a[i]) {
+            j++;
+        }
+        else {
+            shared++;
+            i++;
+            j++;
+        }
+        taken++;
+    }
+    return taken == 0 ? 0 : 1 - (double)shared / taken;
+}
+
+/**
+* @brief Choose the sequences the anchors are found on.
+* @param data The sequences.
+* @param sample_size The number of sequences to choose, at most data.size().
+* @param mode "random" for a uniform sample, "sketch" for a diverse sample by k-mer sketches.
+* @return The indices of the chosen sequences in increasing order.
+*/
+std::vector<uint_t> select_sample(const SequenceStore& data, uint_t sample_size, const std::string& mode) {
+    const uint_t seq_num = data.size();
+    sample_size = std::min<uint_t>(sample_size, seq_num);
+    std::vector<uint_t> sample;
+    if (mode == "random") {
+        // a fixed seed keeps the runs reproducible
+        std::vector<uint_t> order(seq_num);
+        std::iota(order.begin(), order.end(), 0);
+        std::mt19937_64 generator(seq_num);
+        for (uint_t i = 0; i < sample_size; i++) {
+            std::uniform_int_distribution<uint_t> pick(i, seq_num - 1);
+            std::swap(order[i], order[pick(generator)]);
+        }
+        sample.assign(order.begin(), order.begin() + sample_size);
+    }
+    else {
+        std::vector<std::vector<uint64_t>> sketch(seq_num);
+        parallel_for(0, seq_num, 16, [&](uint_t i) {
+            sketch[i] = sketch_sequence(data[i]);
+        });
+        // farthest first from the longest sequence: every new member is the sequence farthest from the sample
+        std::vector<double> distance(seq_num, 2);
+        std::vector<char> chosen(seq_num, 0);
+        uint_t next = 0;
+        for (uint_t i = 1; i < seq_num; i++) {
+            if (data.length(i) > data.length(next)) {
+                next = i;
+            }
+        }
+        while (sample.size() < sample_size) {
+            sample.push_back(next);
+            chosen[next] = 1;
+            const std::vector<uint64_t>& member = sketch[next];
+            parallel_for(0, seq_num, 256, [&](uint_t i) {
+                if (!chosen[i]) {
+                    distance[i] = std::min(distance[i], sketch_distance(sketch[i], member));
+                }
+            });
+            double farthest = -1;
+            for (uint_t i = 0; i < seq_num; i++) {
+                if (!chosen[i] && distance[i] > farthest) {
+                    farthest = distance[i];
+                    next = i;
+                }
+            }
+        }
+    }
+    std::sort(sample.begin(), sample.end());
+    return sample;
+}
+
+/**
+* @brief Find the MEM chain on a sample of the sequences and place it on all of them.
+* @param data The sequences.
+* @param sample_size The number of sequences the MEMs are found on.
+* @param mode How the sample is chosen, see select_sample().
+* @return The chains of every sequence as find_mem() returns them, begin -1 where an anchor was not found.
+*/
+std::vector<std::vector<std::pair<int_t, int_t>>> find_sampled_mem(const SequenceStore& data, uint_t sample_size, const std::string& mode) {
+    std::string output;
+    Timer timer;
+    const uint_t seq_num = data.size();
+    std::vector<uint_t> sample = select_sample(data, sample_size, mode);
+    SequenceStore sample_data;
+    size_t sample_bytes = 0;
+    for (uint_t i : sample) {
+        sample_bytes += data.length(i);
+    }
+    sample_data.reserve(sample_bytes, sample.size());
+    for (uint_t i : sample) {
+        sample_data.append(data[i]);
+    }
+    double sample_time = timer.elapsed_time();
+
+    std::vector<std::vector<std::pair<int_t, int_t>>> sample_chain = find_mem(sample_data);
+    const uint_t chain_num = sample_chain[0].size();
+    if (current_args().verbose) {
+        std::stringstream s;
+        s << std::fixed << std::setprecision(2) << sample_time;
+        output = "Anchor sample: " + std::to_string(sample.size()) + " of " + std::to_string(seq_num) + " (" + mode + ")";
+        print_table_line(output);
+        output = "Sample selection time: " + s.str() + " seconds.";
+        print_table_line(output);
+    }
+    timer.reset();
+
+    // Every anchor is the same string in all sample sequences; it is searched after the anchor before it,
+    // within twice the longest distance between the two in the sample
+    std::vector<std::string_view> anchor(chain_num);
+    std::vector<int_t> max_distance(chain_num, 0);
+    for (uint_t k = 0; k < chain_num; k++) {
+        anchor[k] = sample_data[0].substr(sample_chain[0][k].first, sample_chain[0][k].second);
+        for (uint_t j = 0; j < sample.size(); j++) {
+            int_t last_end = k > 0 ? sample_chain[j][k - 1].first + sample_chain[j][k - 1].second : 0;
+            max_distance[k] = std::max(max_distance[k], sample_chain[j][k].first - last_end);
+        }
+    }
+
+    std::vector<std::vector<std::pair<int_t, int_t>>> chain(seq_num);
+    for (uint_t j = 0; j < sample.size(); j++) {
+        chain[sample[j]].swap(sample_chain[j]);
+    }
+    std::atomic<uint64_t> placed(0);
+    parallel_for(0, seq_num, 16, [&](uint_t i) {
+        if (!chain[i].empty() || chain_num == 0) {
+            return;
+        }
+        chain[i].assign(chain_num, std::make_pair(-1, -1));
+        std::string_view seq = data[i];
+        size_t begin = 0;
+        uint64_t found = 0;
+        for (uint_t k = 0; k < chain_num; k++) {
+            size_t end = std::min(seq.size(), begin + 2 * (size_t)max_distance[k] + ANCHOR_SEARCH_SLACK + anchor[k].size());
+            size_t hit = begin < end ? seq.substr(begin, end - begin).find(anchor[k]) : std::string_view::npos;
+            if (hit != std::string_view::npos) {
+                chain[i][k] = std::make_pair((int_t)(begin + hit), (int_t)anchor[k].size());
+                begin += hit + anchor[k].size();
+                found++;
+            }
+        }
+        placed += found;
+    });
+
+    if (current_args().verbose) {
+        uint64_t total = (uint64_t)(seq_num - sample.size()) * chain_num;
+        std::stringstream s;
+        s << std::fixed << std::setprecision(2) << (total ? 100.0 * placed / total : 100.0);
+        output = "Anchors placed by exact search: " + s.str() + "%";
+        print_table_line(output);
+        s.str("");
+        s << std::fixed << std::setprecision(2) << timer.elapsed_time();
+        output = "Anchor placing time: " + s.str() + " seconds.";
+        print_table_line(output);
+        print_table_divider();
+    }
+    return chain;
+}
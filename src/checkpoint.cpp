@@ -0,0 +1,335 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/checkpoint.h"
+#include "../include/utils.h"
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+enum CheckpointKind {
+    CHECKPOINT_CHAINS = 1,
+    CHECKPOINT_EXPANDED = 2,
+    CHECKPOINT_FRAGMENT = 3
+};
+
+static std::atomic<bool> enabled(false); // set by the alignment of the command line, an AlignContext has none
+static uint64_t chains_key = 0;     // the sequences and the options of the anchor phase
+static uint64_t expanded_key = 0;   // the split points and the options of the SW expansion
+static std::atomic<uint_t> failures(0);
+
+// True if the alignment of the calling thread keeps a checkpoint, the options of a context have no -checkpoint.
+static bool active() {
+    return enabled && !current_args().checkpoint_dir.empty();
+}
+
+static std::string checkpoint_path(const std::string& file) {
+    return (fs::path(current_args().checkpoint_dir) / file).string();
+}
+
+static void put_u64(std::string& out, uint64_t value) {
+    out.append((const char*)&value, sizeof(value));
+}
+
+static void put_string(std::string& out, std::string_view s) {
+    put_u64(out, s.size());
+    out.append(s.data(), s.size());
+}
+
+static std::string checkpoint_header(CheckpointKind kind, uint64_t key) {
+    std::string out(CHECKPOINT_MAGIC);
+    put_u64(out, ((uint64_t)CHECKPOINT_VERSION << 32) | kind);
+    put_u64(out, key);
+    return out;
+}
+
+// Reads a checkpoint file front to back; every read fails once the file is too short.
+class CheckpointReader {
+public:
+    explicit CheckpointReader(const std::string& path) : ok_(read_file(path, content_)), pos_(0) {}
+    // Check the magic, the version, the kind and the key.
+    bool header(CheckpointKind kind, uint64_t key) {
+        if (!ok_ || content_.compare(0, strlen(CHECKPOINT_MAGIC), CHECKPOINT_MAGIC) != 0) {
+            return false;
+        }
+        pos_ = strlen(CHECKPOINT_MAGIC);
+        uint64_t version_kind, file_key;
+        return get(version_kind) && get(file_key) && version_kind == (((uint64_t)CHECKPOINT_VERSION << 32) | kind) && file_key == key;
+    }
+    bool get(uint64_t& value) {
+        if (!ok_ || content_.size() - pos_ < sizeof(value)) {
+            return ok_ = false;
+        }
+        memcpy(&value, content_.data() + pos_, sizeof(value));
+        pos_ += sizeof(value);
+        return true;
+    }
+    bool get(std::string& s) {
+        uint64_t size;
+        if (!get(size) || content_.size() - pos_ < size) {
+            return ok_ = false;
+        }
+        s.assign(content_, pos_, size);
+        pos_ += size;
+        return true;
+    }
+    bool get(std::pair<int_t, int_t>& p) {
+        uint64_t first, second;
+        if (!get(first) || !get(second)) {
+            return false;
+        }
+        p = std::make_pair((int_t)(int64_t)first, (int_t)(int64_t)second);
+        return true;
+    }
+    // True if everything was read.
+    bool done() const { return ok_ && pos_ == content_.size(); }
+private:
+    std::string content_;
+    bool ok_;
+    size_t pos_;
+};
+
+static uint64_t hash_u64(uint64_t value, uint64_t hash) {
+    return fnv1a_hash(std::string_view((const char*)&value, sizeof(value)), hash);
+}
+
+static void save(const std::string& file, const std::string& content) {
+    if (!write_file_atomic(checkpoint_path(file), content)) {
+        std::cerr << "Warning: fail to write checkpoint " << checkpoint_path(file) << std::endl;
+    }
+}
+
+/**
+* @brief Start checkpointing into current_args().checkpoint_dir, if it is set; the folder is created.
+* An AlignContext has no checkpoint folder and leaves the checkpoint of the command line alone.
+* @param data The sequences that are aligned, after deduplication.
+*/
+void checkpoint_start(const SequenceStore& data) {
+    const GlobalArgs& args = current_args();
+    if (args.checkpoint_dir.empty()) {
+        return;
+    }
+    enabled = true;
+    std::error_code ec;
+    fs::create_directories(args.checkpoint_dir, ec);
+    if (ec) {
+        std::cerr << "Fail to create file folder " << args.checkpoint_dir << ": " << ec.message() << std::endl;
+        exit(1);
+    }
+    uint64_t key = fnv1a_hash(std::string_view((const char*)data.concat(), data.concat_length()));
+    key = hash_u64(data.size(), key);
+    key = hash_u64(args.min_mem_length, key);
+    key = fnv1a_hash(args.filter_mode, key);
+    key = hash_u64(args.sample_size, key);
+    key = fnv1a_hash(args.sample_mode, key);
+    key = hash_u64(sizeof(int_t), key);
+    chains_key = key;
+}
+
+// True if results are written to a checkpoint.
+bool checkpoint_enabled() {
+    return active();
+}
+
+// Key of the expanded chains: the split points they were expanded from and -sw_window.
+static uint64_t get_expanded_key(const std::vector<std::vector<std::pair<int_t, int_t>>>& chain) {
+    uint64_t key = hash_u64(current_args().sw_window, chains_key);
+    for (const auto& row : chain) {
+        key = fnv1a_hash(std::string_view((const char*)row.data(), row.size() * sizeof(row[0])), key);
+    }
+    return key;
+}
+
+/**
+* @brief Read the split points back with -resume.
+* @param chain Receives the chains of every sequence.
+* @return False if there is no checkpoint of them for these sequences and options.
+*/
+bool checkpoint_load_chains(std::vector<std::vector<std::pair<int_t, int_t>>>& chain) {
+    if (!active() || !current_args().resume) {
+        return false;
+    }
+    CheckpointReader reader(checkpoint_path("chains.bin"));
+    uint64_t seq_num, chain_num;
+    if (!reader.header(CHECKPOINT_CHAINS, chains_key) || !reader.get(seq_num) || !reader.get(chain_num)) {
+        return false;
+    }
+    std::vector<std::vector<std::pair<int_t, int_t>>> loaded(seq_num, std::vector<std::pair<int_t, int_t>>(chain_num));
+    for (auto& row : loaded) {
+        for (auto& p : row) {
+            if (!reader.get(p)) {
+                return false;
+            }
+        }
+    }
+    if (!reader.done()) {
+        return false;
+    }
+    chain.swap(loaded);
+    expanded_key = get_expanded_key(chain);
+    return true;
+}
+
+/**
+* @brief Keep the split points.
+* @param chain The chains of every sequence, as find_mem() returns them.
+*/
+void checkpoint_save_chains(const std::vector<std::vector<std::pair<int_t, int_t>>>& chain) {
+    if (!active()) {
+        return;
+    }
+    expanded_key = get_expanded_key(chain);
+    std::string out = checkpoint_header(CHECKPOINT_CHAINS, chains_key);
+    put_u64(out, chain.size());
+    put_u64(out, chain.empty() ? 0 : chain[0].size());
+    for (const auto& row : chain) {
+        for (const auto& p : row) {
+            put_u64(out, (uint64_t)(int64_t)p.first);
+            put_u64(out, (uint64_t)(int64_t)p.second);
+        }
+    }
+    save("chains.bin", out);
+}
+
+/**
+* @brief Read the expanded chains back with -resume.
+* @param column Receives column[k][i], chain k of sequence i after the SW expansion.
+* @param chain_string Receives the aligned strings of the chains, chain_string[k][i].
+* @return False if there is no checkpoint of them for the current split points.
+*/
+bool checkpoint_load_expanded(std::vector<std::vector<std::pair<int_t, int_t>>>& column, std::vector<std::vector<std::string>>& chain_string) {
+    if (!active() || !current_args().resume) {
+        return false;
+    }
+    CheckpointReader reader(checkpoint_path("expanded.bin"));
+    uint64_t chain_num, seq_num;
+    if (!reader.header(CHECKPOINT_EXPANDED, expanded_key) || !reader.get(chain_num) || !reader.get(seq_num)) {
+        return false;
+    }
+    std::vector<std::vector<std::pair<int_t, int_t>>> loaded_column(chain_num, std::vector<std::pair<int_t, int_t>>(seq_num));
+    std::vector<std::vector<std::string>> loaded_string(chain_num, std::vector<std::string>(seq_num));
+    for (uint64_t k = 0; k < chain_num; k++) {
+        for (uint64_t i = 0; i < seq_num; i++) {
+            if (!reader.get(loaded_column[k][i]) || !reader.get(loaded_string[k][i])) {
+                return false;
+            }
+        }
+    }
+    if (!reader.done()) {
+        return false;
+    }
+    column.swap(loaded_column);
+    chain_string.swap(loaded_string);
+    return true;
+}
+
+/**
+* @brief Keep the expanded chains.
+* @param column column[k][i] is chain k of sequence i after the SW expansion.
+* @param chain_string The aligned strings of the chains, chain_string[k][i].
+*/
+void checkpoint_save_expanded(const std::vector<const std::vector<std::pair<int_t, int_t>>*>& column, const std::vector<std::vector<std::string>>& chain_string) {
+    if (!active()) {
+        return;
+    }
+    std::string out = checkpoint_header(CHECKPOINT_EXPANDED, expanded_key);
+    const uint64_t seq_num = column.empty() ? 0 : column[0]->size();
+    put_u64(out, column.size());
+    put_u64(out, seq_num);
+    for (size_t k = 0; k < column.size(); k++) {
+        for (uint64_t i = 0; i < seq_num; i++) {
+            put_u64(out, (uint64_t)(int64_t)(*column[k])[i].first);
+            put_u64(out, (uint64_t)(int64_t)(*column[k])[i].second);
+            put_string(out, chain_string[k][i]);
+        }
+    }
+    save("expanded.bin", out);
+}
+
+// A fragment is keyed by the command template that aligns it and its FASTA.
+static uint64_t fragment_key(const std::string& fasta) {
+    const std::string& package = current_args().package;
+    return fnv1a_hash(fasta, fnv1a_hash(std::string_view(package.c_str(), package.size() + 1)));
+}
+
+static std::string fragment_file(uint64_t key) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "frag-%016llx.bin", (unsigned long long)key);
+    return buffer;
+}
+
+/**
+* @brief Read the alignment of a fragment back with -resume.
+* @param fasta The fragment in FASTA format.
+* @param aligned_seq Receives the aligned sequences in input order.
+* @return False if the fragment has not been aligned before.
+*/
+bool checkpoint_load_fragment(const std::string& fasta, std::vector<std::string>& aligned_seq) {
+    if (!active() || !current_args().resume) {
+        return false;
+    }
+    const uint64_t key = fragment_key(fasta);
+    CheckpointReader reader(checkpoint_path(fragment_file(key)));
+    uint64_t row_num;
+    if (!reader.header(CHECKPOINT_FRAGMENT, key) || !reader.get(row_num)) {
+        return false;
+    }
+    std::vector<std::string> rows(row_num);
+    for (std::string& row : rows) {
+        if (!reader.get(row)) {
+            return false;
+        }
+    }
+    if (!reader.done()) {
+        return false;
+    }
+    aligned_seq.swap(rows);
+    return true;
+}
+
+/**
+* @brief Keep the alignment of a fragment.
+* @param fasta The fragment in FASTA format.
+* @param aligned_seq The aligned sequences in input order.
+*/
+void checkpoint_save_fragment(const std::string& fasta, const std::vector<std::string>& aligned_seq) {
+    if (!active()) {
+        return;
+    }
+    const uint64_t key = fragment_key(fasta);
+    std::string out = checkpoint_header(CHECKPOINT_FRAGMENT, key);
+    put_u64(out, aligned_seq.size());
+    for (const std::string& row : aligned_seq) {
+        put_string(out, row);
+    }
+    save(fragment_file(key), out);
+}
+
+// Count a backend call that failed; the run goes on and stops before writing the alignment.
+void checkpoint_fragment_failed() {
+    failures++;
+}
+
+// The number of backend calls that failed.
+uint_t checkpoint_failures() {
+    return failures;
+}
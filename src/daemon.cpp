@@ -0,0 +1,424 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-15
+
+#include "../include/daemon.h"
+#include "../include/align_context.h"
+#include "../include/alignment_writer.h"
+#include "../include/scheduler.h"
+#include "../include/utils.h"
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#ifndef _WIN32
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#endif
+
+#ifdef _WIN32
+
+int run_daemon(const std::string& socket_path, uint64_t max_input) {
+    std::cerr << "Error: -daemon needs Unix domain sockets and is not supported on Windows" << std::endl;
+    return 1;
+}
+
+int run_client(const std::string& socket_path) {
+    std::cerr << "Error: -client needs Unix domain sockets and is not supported on Windows" << std::endl;
+    return 1;
+}
+
+#else
+
+namespace {
+
+std::mutex log_mutex;
+
+// Connections that are open, at most one job per scheduler thread; the next clients wait in the listen backlog.
+std::mutex job_mutex;
+std::condition_variable job_finished;
+int open_jobs = 0;
+
+// Buffered reads of lines and byte counts from a socket.
+class SocketReader {
+public:
+    explicit SocketReader(int fd) : fd_(fd), begin_(0), end_(0) {}
+
+    // Read a line without its '\n'; false at the end of the stream or after DAEMON_MAX_LINE bytes without one.
+    bool read_line(std::string& line) {
+        line.clear();
+        while (true) {
+            for (; begin_ < end_; begin_++) {
+                if (buffer_[begin_] == '\n') {
+                    begin_++;
+                    return true;
+                }
+                if (line.size() == DAEMON_MAX_LINE) {
+                    return false;
+                }
+                line += buffer_[begin_];
+            }
+            if (!fill()) {
+                return false;
+            }
+        }
+    }
+
+    bool read_bytes(size_t size, std::string& data) {
+        data.clear();
+        data.reserve(size);
+        while (data.size() < size) {
+            if (begin_ == end_ && !fill()) {
+                return false;
+            }
+            size_t take = std::min(size - data.size(), end_ - begin_);
+            data.append(buffer_ + begin_, take);
+            begin_ += take;
+        }
+        return true;
+    }
+
+private:
+    bool fill() {
+        ssize_t got;
+        do {
+            got = ::read(fd_, buffer_, sizeof(buffer_));
+        } while (got < 0 && errno == EINTR);
+        begin_ = 0;
+        end_ = got > 0 ? got : 0;
+        return got > 0;
+    }
+
+    int fd_;
+    char buffer_[1 << 16];
+    size_t begin_;
+    size_t end_;
+};
+
+bool write_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data.remove_prefix(sent);
+    }
+    return true;
+}
+
+bool socket_address(const std::string& socket_path, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+    return true;
+}
+
+int parse_int(const std::string& value) {
+    size_t used = 0;
+    int number = 0;
+    try {
+        number = std::stoi(value, &used);
+    }
+    catch (const std::exception&) {
+        used = std::string::npos;
+    }
+    if (used != value.size()) {
+        throw std::invalid_argument("invalid number " + value);
+    }
+    return number;
+}
+
+// Set an option of a job, checked as the command line checks it.
+void set_job_option(GlobalArgs& args, const std::string& key, const std::string& value) {
+    if (key == "l") {
+        args.min_mem_length = parse_int(value);
+        if (args.min_mem_length < 1 && args.min_mem_length != -1) {
+            throw std::invalid_argument("MEM length l should be positive, or -1 for the default");
+        }
+    }
+    else if (key == "f") {
+        if (value != "default" && value != "fast" && value != "accurate") {
+            throw std::invalid_argument("filter mode f should be accurate or fast");
+        }
+        args.filter_mode = value;
+    }
+    else if (key == "index") {
+        if (value != "full" && value != "lean") {
+            throw std::invalid_argument("index mode index should be full or lean");
+        }
+        args.index_mode = value;
+    }
+    else if (key == "small") {
+        args.small_fragment = parse_int(value);
+        if (args.small_fragment < 0) {
+            throw std::invalid_argument("small fragment small should not be negative");
+        }
+    }
+    else if (key == "trivial_mismatch") {
+        size_t used = 0;
+        try {
+            args.trivial_mismatch = std::stod(value, &used);
+        }
+        catch (const std::exception&) {
+            used = std::string::npos;
+        }
+        if (used != value.size() || args.trivial_mismatch < 0 || args.trivial_mismatch > 1) {
+            throw std::invalid_argument("trivial fragment trivial_mismatch should be between 0 and 1");
+        }
+    }
+    else if (key == "dedup") {
+        args.dedup = parse_int(value);
+        if (args.dedup != 0 && args.dedup != 1) {
+            throw std::invalid_argument("deduplication dedup should be 1 or 0");
+        }
+    }
+    else if (key == "sw_window") {
+        args.sw_window = parse_int(value);
+        if (args.sw_window < 0) {
+            throw std::invalid_argument("SW window sw_window should not be negative");
+        }
+    }
+    else if (key == "rec_depth") {
+        args.recursive_depth = parse_int(value);
+        if (args.recursive_depth < 0) {
+            throw std::invalid_argument("recursion depth rec_depth should not be negative");
+        }
+    }
+    else if (key == "rec_len") {
+        args.recursive_length = parse_int(value);
+        if (args.recursive_length < 1) {
+            throw std::invalid_argument("recursion length rec_len should be positive");
+        }
+    }
+    else if (key == "sample") {
+        args.sample_size = parse_int(value);
+        if (args.sample_size < 0) {
+            throw std::invalid_argument("sample size sample should not be negative");
+        }
+    }
+    else if (key == "sample_mode") {
+        if (value != "sketch" && value != "random") {
+            throw std::invalid_argument("sample mode sample_mode should be sketch or random");
+        }
+        args.sample_mode = value;
+    }
+    else {
+        throw std::invalid_argument("unknown option " + key);
+    }
+}
+
+// Read one job from a client, align it and send the answer.
+void serve_connection(int fd, uint64_t max_input) {
+    SocketReader reader(fd);
+    std::string answer;
+    try {
+        std::string line;
+        if (!reader.read_line(line) || line != DAEMON_PROTOCOL " " + std::to_string(DAEMON_PROTOCOL_VERSION)) {
+            throw std::invalid_argument("not a " DAEMON_PROTOCOL " " + std::to_string(DAEMON_PROTOCOL_VERSION) + " request");
+        }
+        GlobalArgs args = global_args;
+        args.verbose = 0;
+        bool has_input = false;
+        size_t input_size = 0;
+        while (!has_input && reader.read_line(line)) {
+            size_t space = line.find(' ');
+            std::string key = line.substr(0, space);
+            std::string value = space == std::string::npos ? "" : line.substr(space + 1);
+            if (key == "input") {
+                char* end = NULL;
+                errno = 0;
+                unsigned long long size = std::strtoull(value.c_str(), &end, 10);
+                if (value.empty() || value[0] == '-' || *end != '\0' || errno == ERANGE) {
+                    throw std::invalid_argument("invalid input size " + value);
+                }
+                if (size > max_input) {
+                    throw std::invalid_argument("input of " + value + " bytes is larger than the -daemon_max_input of "
+                        + std::to_string(max_input) + " bytes");
+                }
+                input_size = size;
+                has_input = true;
+            }
+            else {
+                set_job_option(args, key, value);
+            }
+        }
+        std::string input;
+        if (!has_input || !reader.read_bytes(input_size, input)) {
+            throw std::invalid_argument("the request ends before its input, or a line is longer than "
+                + std::to_string(DAEMON_MAX_LINE) + " bytes");
+        }
+
+        Timer timer;
+        std::string fasta = AlignContext(args).align_fasta(input);
+        answer = "ok " + std::to_string(fasta.size()) + "\n" + fasta;
+        std::lock_guard<std::mutex> lock(log_mutex);
+        std::cout << "Aligned a job of " << input_size << " bytes in " << std::fixed << std::setprecision(2)
+            << timer.elapsed_time() << " seconds." << std::endl;
+    }
+    catch (const std::exception& e) {
+        answer = std::string("error ") + e.what() + "\n";
+        std::lock_guard<std::mutex> lock(log_mutex);
+        std::cerr << "Job failed: " << e.what() << std::endl;
+    }
+    write_all(fd, answer);
+    ::close(fd);
+    std::lock_guard<std::mutex> lock(job_mutex);
+    open_jobs--;
+    job_finished.notify_one();
+}
+
+} // namespace
+
+/**
+* @brief Serve alignment jobs on a Unix domain socket until the process is stopped.
+* Every connection is one job and is served by a thread of its own; the jobs share the scheduler workers.
+* At most one job per scheduler thread is open at a time, a client that sends nothing for
+* DAEMON_RECEIVE_TIMEOUT seconds is dropped, and a larger input than max_input is refused.
+* @param socket_path The socket, replaced if it exists.
+* @param max_input The largest input of a job in bytes.
+* @return The exit code of the program.
+*/
+int run_daemon(const std::string& socket_path, uint64_t max_input) {
+    sockaddr_un address;
+    if (!socket_address(socket_path, address)) {
+        std::cerr << "Error: socket path " << socket_path << " is too long" << std::endl;
+        return 1;
+    }
+    // a client that leaves before its answer must not end the daemon
+    signal(SIGPIPE, SIG_IGN);
+    int server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(socket_path.c_str());
+    if (server < 0 || ::bind(server, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(server, SOMAXCONN) != 0) {
+        std::cerr << "Error: cannot listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::cout << "FMAlign2 is serving alignment jobs on " << socket_path << std::endl;
+
+    const int max_jobs = Scheduler::instance().threads();
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(job_mutex);
+            job_finished.wait(lock, [max_jobs]() { return open_jobs < max_jobs; });
+        }
+        int client = ::accept(server, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            std::cerr << "Error: accept on " << socket_path << " failed: " << std::strerror(errno) << std::endl;
+            ::close(server);
+            return 1;
+        }
+        // a client that stops sending must not hold its job slot for ever
+        timeval timeout = { DAEMON_RECEIVE_TIMEOUT, 0 };
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        {
+            std::lock_guard<std::mutex> lock(job_mutex);
+            open_jobs++;
+        }
+        std::thread(serve_connection, client, max_input).detach();
+    }
+}
+
+/**
+* @brief Align global_args.data_path by a daemon and write the alignment to global_args.output_path.
+* The input is read and checked here and sent as FASTA, with the alignment options of the command line.
+* @param socket_path The socket of the daemon.
+* @return The exit code of the program.
+*/
+int run_client(const std::string& socket_path) {
+    SequenceStore data;
+    std::vector<std::string> name;
+    read_data(global_args.data_path.c_str(), data, name, false);
+
+    std::string request = DAEMON_PROTOCOL " " + std::to_string(DAEMON_PROTOCOL_VERSION) + "\n";
+    request += "l " + std::to_string(global_args.min_mem_length) + "\n";
+    request += "f " + global_args.filter_mode + "\n";
+    request += "index " + global_args.index_mode + "\n";
+    request += "small " + std::to_string(global_args.small_fragment) + "\n";
+    request += "trivial_mismatch " + std::to_string(global_args.trivial_mismatch) + "\n";
+    request += "dedup " + std::to_string(global_args.dedup) + "\n";
+    request += "sw_window " + std::to_string(global_args.sw_window) + "\n";
+    request += "rec_depth " + std::to_string(global_args.recursive_depth) + "\n";
+    request += "rec_len " + std::to_string(global_args.recursive_length) + "\n";
+    request += "sample " + std::to_string(global_args.sample_size) + "\n";
+    request += "sample_mode " + global_args.sample_mode + "\n";
+    std::string input;
+    for (uint_t i = 0; i < data.size(); i++) {
+        input += '>';
+        input += name[i];
+        input += '\n';
+        input += data[i];
+        input += '\n';
+    }
+    request += "input " + std::to_string(input.size()) + "\n";
+
+    sockaddr_un address;
+    if (!socket_address(socket_path, address)) {
+        std::cerr << "Error: socket path " << socket_path << " is too long" << std::endl;
+        return 1;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        std::cerr << "Error: cannot connect to the daemon on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    if (!write_all(fd, request) || !write_all(fd, input)) {
+        std::cerr << "Error: the daemon on " << socket_path << " closed the connection" << std::endl;
+        ::close(fd);
+        return 1;
+    }
+    std::string().swap(input);
+
+    SocketReader reader(fd);
+    std::string status;
+    std::string fasta;
+    bool ok = reader.read_line(status) && status.compare(0, 3, "ok ") == 0
+        && reader.read_bytes(std::stoull(status.substr(3)), fasta);
+    ::close(fd);
+    if (!ok) {
+        std::cerr << (status.empty() ? "Error: no answer from the daemon" : "Daemon " + status) << std::endl;
+        return 1;
+    }
+
+    AlignmentWriter output_file(global_args.output_path, global_args.bgzf);
+    if (!output_file.is_open()) {
+        std::cerr << "Error opening output file " << global_args.output_path << std::endl;
+        return 1;
+    }
+    output_file.write(fasta);
+    if (!output_file.close()) {
+        std::cerr << "Error writing output file " << global_args.output_path << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+#endif
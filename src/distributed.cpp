@@ -0,0 +1,452 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/distributed.h"
+#include "../include/msa_scheduler.h"
+#include "../include/scheduler.h"
+#include "../include/sequence_split_align.h"
+#include "../include/utils.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_set>
+#ifdef HAVE_MPI
+#include <mpi.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#define DIST_TAG_JOB 1
+#define DIST_TAG_RESULT 2
+#define DIST_TAG_STOP 3
+#define DIST_MANIFEST "manifest.tsv"
+#define DIST_SCRIPT "jobs.slurm"
+
+static int mpi_rank = 0;
+static int mpi_size = 1;
+static std::string msa_argument;
+static std::string program_path;
+static std::mutex dist_mutex;
+// MPI workers without a job, the coordinator threads wait here for one
+static std::condition_variable worker_free;
+static std::vector<int> free_workers;
+static std::atomic<uint_t> sent_num(0);
+// the fragments written by -dist prepare
+struct ManifestEntry {
+    std::string name;
+    MsaJobRecord record;
+};
+static std::vector<ManifestEntry> manifest;
+static std::unordered_set<std::string> manifest_names;
+
+// File name stem of a fragment: the hash of its FASTA.
+static std::string fragment_name(const std::string& fasta) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), "frag-%016llx", (unsigned long long)fnv1a_hash(fasta));
+    return buffer;
+}
+
+static std::string dist_path(const std::string& file) {
+    return (fs::path(global_args.dist_dir) / file).string();
+}
+
+// Quote an argument for /bin/sh.
+static std::string shell_quote(const std::string& arg) {
+    std::string quoted = "'";
+    for (char c : arg) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        }
+        else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+static std::string absolute_path(const std::string& path) {
+    std::error_code ec;
+    fs::path absolute = fs::absolute(path, ec);
+    return ec ? path : absolute.string();
+}
+
+/**
+* @brief Start the distributed mode chosen by global_args.dist_mode; MPI is initialized here.
+* @param msa_arg The -p argument, passed on to the workers of the job array.
+* @param argv0 The path the program was started by.
+*/
+void dist_start(const std::string& msa_arg, const char* argv0) {
+    msa_argument = msa_arg;
+    program_path = argv0;
+#ifdef __linux__
+    std::error_code ec;
+    fs::path self = fs::read_symlink("/proc/self/exe", ec);
+    if (!ec) {
+        program_path = self.string();
+    }
+#endif
+    program_path = absolute_path(program_path);
+    if (global_args.dist_mode == "mpi") {
+#ifdef HAVE_MPI
+        int provided = 0;
+        MPI_Init_thread(NULL, NULL, MPI_THREAD_MULTIPLE, &provided);
+        if (provided < MPI_THREAD_MULTIPLE) {
+            std::cerr << "Error: the MPI library does not support MPI_THREAD_MULTIPLE" << std::endl;
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &mpi_size);
+        if (mpi_rank == 0) {
+            for (int rank = 1; rank < mpi_size; rank++) {
+                free_workers.push_back(rank);
+            }
+            // a thread waits for every job in flight, the other threads keep the SW expansion and the in-process fragments going
+            Scheduler::instance().set_threads(global_args.thread + mpi_size - 1);
+        }
+#else
+        throw "distributed mode -dist mpi needs a build with MPI=1";
+#endif
+    }
+    else if (global_args.dist_mode != "none") {
+        std::error_code ec;
+        fs::create_directories(global_args.dist_dir, ec);
+        if (ec) {
+            std::cerr << "Fail to create file folder " << global_args.dist_dir << ": " << ec.message() << std::endl;
+            exit(1);
+        }
+    }
+}
+
+// True if this process only aligns fragments for a coordinator: an MPI rank above 0 or -dist work.
+bool dist_is_worker() {
+    return mpi_rank > 0 || global_args.dist_mode == "work";
+}
+
+// True if this process runs the MSA backend itself, and its command template must be checked.
+bool dist_runs_backend() {
+    if (global_args.dist_mode == "mpi") {
+        return mpi_rank > 0 || mpi_size == 1;
+    }
+    return global_args.dist_mode == "none" || global_args.dist_mode == "work";
+}
+
+// This process as an MPI worker: align the fragments of rank 0 until it sends the stop message.
+static int serve_coordinator() {
+#ifdef HAVE_MPI
+    uint_t job = 0;
+    while (true) {
+        MPI_Status status;
+        MPI_Probe(0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+        int size = 0;
+        MPI_Get_count(&status, MPI_CHAR, &size);
+        std::string fasta(size, '\0');
+        MPI_Recv(&fasta[0], size, MPI_CHAR, 0, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if (status.MPI_TAG == DIST_TAG_STOP) {
+            break;
+        }
+        std::vector<std::string> aligned_seq;
+        align_fragment(fasta, job++, aligned_seq, global_args.thread);
+        // one row per line, the coordinator knows how many to expect
+        std::string rows;
+        for (const std::string& row : aligned_seq) {
+            rows += row;
+            rows += '\n';
+        }
+        MPI_Send(rows.data(), (int)rows.size(), MPI_CHAR, 0, DIST_TAG_RESULT, MPI_COMM_WORLD);
+    }
+    MPI_Finalize();
+#endif
+    return 0;
+}
+
+// Part i of n of the manifest: -dist_part i/n, or the task of a SLURM job array.
+static void manifest_part(uint_t& part, uint_t& parts) {
+    part = 0;
+    parts = 1;
+    std::string spec = global_args.dist_part;
+    if (spec == "auto") {
+        const char* id = getenv("SLURM_ARRAY_TASK_ID");
+        const char* count = getenv("SLURM_ARRAY_TASK_COUNT");
+        const char* min_id = getenv("SLURM_ARRAY_TASK_MIN");
+        if (id && count) {
+            part = std::stoul(id) - (min_id ? std::stoul(min_id) : 0);
+            parts = std::stoul(count);
+        }
+        return;
+    }
+    size_t slash = spec.find('/');
+    if (slash == std::string::npos) {
+        std::cerr << "Error: -dist_part should be auto or i/n" << std::endl;
+        exit(1);
+    }
+    part = std::stoul(spec.substr(0, slash));
+    parts = std::stoul(spec.substr(slash + 1));
+    if (parts == 0 || part >= parts) {
+        std::cerr << "Error: -dist_part " << spec << " is out of range" << std::endl;
+        exit(1);
+    }
+}
+
+// This process as a job array task: align its part of the manifest that is not aligned yet.
+static int work_manifest() {
+    std::string content;
+    if (!read_file(dist_path(DIST_MANIFEST), content)) {
+        std::cerr << dist_path(DIST_MANIFEST) << " fail to open! Run -dist prepare first." << std::endl;
+        return 1;
+    }
+    uint_t part, parts;
+    manifest_part(part, parts);
+    std::vector<ManifestEntry> entry;
+    std::istringstream lines(content);
+    std::string line;
+    std::getline(lines, line);  // header
+    for (uint_t j = 0; std::getline(lines, line); j++) {
+        if (j % parts != part) {
+            continue;
+        }
+        ManifestEntry e;
+        std::istringstream fields(line);
+        fields >> e.name >> e.record.seq_num >> e.record.total_length >> e.record.max_length >> e.record.predicted;
+        e.record.task_index = j;
+        entry.push_back(e);
+    }
+
+    random_file_end = generateRandomString(10);
+    std::atomic<uint_t> aligned_num(0), skipped_num(0);
+    {
+        // the largest fragments are first in the manifest and are started first here too
+        TaskGroup group;
+        MsaJobQueue queue(group, global_args.thread, 0, true);
+        for (const ManifestEntry& e : entry) {
+            std::string aligned_path = dist_path(e.name + ".aligned.fasta");
+            if (fs::exists(aligned_path)) {
+                skipped_num++;
+                continue;
+            }
+            queue.push(e.record, [&, e, aligned_path](int thread_num) {
+                std::string fasta;
+                if (!read_file(dist_path(e.name + ".fasta"), fasta)) {
+                    std::cerr << dist_path(e.name + ".fasta") << " fail to open!" << std::endl;
+                    exit(1);
+                }
+                std::vector<std::string> aligned_seq, seq_name, rows;
+                align_fragment(fasta, e.record.task_index, aligned_seq, thread_num);
+                parse_alignment(fasta, rows, seq_name);
+                std::string aligned;
+                for (uint_t i = 0; i < aligned_seq.size(); i++) {
+                    aligned += ">" + (i < seq_name.size() ? seq_name[i] : std::to_string(i)) + "\n" + aligned_seq[i] + "\n";
+                }
+                if (!write_file_atomic(aligned_path, aligned)) {
+                    std::cerr << "Error writing " << aligned_path << std::endl;
+                    exit(1);
+                }
+                aligned_num++;
+            });
+        }
+        group.wait();
+    }
+    if (global_args.verbose) {
+        std::cout << "Part " << part << "/" << parts << ": " << aligned_num << " fragments aligned, "
+            << skipped_num << " already aligned" << std::endl;
+    }
+    return 0;
+}
+
+/**
+* @brief Align fragments for the coordinator until it is done: serve an MPI coordinator or work through a part of the manifest.
+* @return The exit code of the program.
+*/
+int dist_run_worker() {
+    if (mpi_rank > 0) {
+        random_file_end = generateRandomString(10);
+        return serve_coordinator();
+    }
+    return work_manifest();
+}
+
+/**
+* @brief The number of MSA jobs that may run at once at the top level: the workers in MPI mode, otherwise -t.
+* @param max_job_threads Receives the most threads one job is given, 0 for no limit.
+* @return The thread budget of the MSA job queue.
+*/
+int dist_job_slots(int& max_job_threads) {
+    max_job_threads = 0;
+    if (global_args.dist_mode == "mpi" && mpi_size > 1) {
+        // a worker takes one job at a time and gives it all of its threads
+        max_job_threads = 1;
+        return mpi_size - 1;
+    }
+    return global_args.thread;
+}
+
+/**
+* @brief Align a fragment the distributed way: on an MPI worker, into the manifest, or from the aligned fragment files.
+* @param fasta The fragment in FASTA format.
+* @param aligned_seq Receives the aligned sequences in input order.
+* @return False if the fragment is to be aligned by the local backend.
+*/
+bool dist_align_fragment(const std::string& fasta, std::vector<std::string>& aligned_seq) {
+    const std::string& mode = global_args.dist_mode;
+    if (mode == "none" || mode == "work" || mpi_rank > 0 || (mode == "mpi" && mpi_size == 1)) {
+        return false;
+    }
+    std::vector<std::string> rows, seq_name;
+    aligned_seq.clear();
+#ifdef HAVE_MPI
+    if (mode == "mpi") {
+        if (fasta.size() > INT_MAX) {
+            std::cerr << "Error: a fragment of " << fasta.size() << " bytes is too large for an MPI message" << std::endl;
+            exit(1);
+        }
+        int rank;
+        {
+            std::unique_lock<std::mutex> lock(dist_mutex);
+            worker_free.wait(lock, []() { return !free_workers.empty(); });
+            rank = free_workers.back();
+            free_workers.pop_back();
+        }
+        // the worker has no other job, so its next result message is the answer to this one
+        MPI_Send(fasta.data(), (int)fasta.size(), MPI_CHAR, rank, DIST_TAG_JOB, MPI_COMM_WORLD);
+        MPI_Status status;
+        MPI_Probe(rank, DIST_TAG_RESULT, MPI_COMM_WORLD, &status);
+        int size = 0;
+        MPI_Get_count(&status, MPI_CHAR, &size);
+        std::string result(size, '\0');
+        MPI_Recv(&result[0], size, MPI_CHAR, rank, DIST_TAG_RESULT, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        {
+            std::lock_guard<std::mutex> lock(dist_mutex);
+            free_workers.push_back(rank);
+        }
+        worker_free.notify_one();
+        sent_num++;
+        size_t begin = 0, end;
+        while ((end = result.find('\n', begin)) != std::string::npos) {
+            aligned_seq.emplace_back(result, begin, end - begin);
+            begin = end + 1;
+        }
+        return true;
+    }
+#endif
+    const std::string name = fragment_name(fasta);
+    if (mode == "merge") {
+        std::string aligned_path = dist_path(name + ".aligned.fasta");
+        if (!read_alignment(aligned_path.c_str(), aligned_seq, seq_name)) {
+            std::cerr << "Error: fragment " << aligned_path << " is not aligned, run the -dist work jobs first" << std::endl;
+            exit(1);
+        }
+        return true;
+    }
+
+    // prepare: write the fragment once and return its rows padded with gaps, the alignment is made by the workers
+    parse_alignment(fasta, rows, seq_name);
+    bool is_new;
+    {
+        std::lock_guard<std::mutex> lock(dist_mutex);
+        is_new = manifest_names.insert(name).second;
+    }
+    if (is_new) {
+        std::vector<std::pair<int_t, int_t>> range;
+        for (const std::string& row : rows) {
+            range.emplace_back(0, (int_t)row.size());
+        }
+        ManifestEntry e;
+        e.name = name;
+        estimate_msa_cost(range, e.record);
+        std::string path = dist_path(name + ".fasta");
+        if (!write_file_atomic(path, fasta)) {
+            std::cerr << "Error writing " << path << std::endl;
+            exit(1);
+        }
+        std::lock_guard<std::mutex> lock(dist_mutex);
+        manifest.push_back(e);
+    }
+    size_t length = 0;
+    for (const std::string& row : rows) {
+        length = std::max(length, row.size());
+    }
+    for (std::string& row : rows) {
+        row.resize(length, '-');
+    }
+    aligned_seq.swap(rows);
+    return true;
+}
+
+// True if the alignment is written by this run, false for -dist prepare, which only writes the fragments.
+bool dist_writes_alignment() {
+    return global_args.dist_mode != "prepare";
+}
+
+/**
+* @brief Finish the coordinator: stop the MPI workers, or write the manifest and the job script of -dist prepare.
+*/
+void dist_finish() {
+#ifdef HAVE_MPI
+    if (global_args.dist_mode == "mpi") {
+        if (global_args.verbose && mpi_size > 1) {
+            print_table_line("Fragments sent to " + std::to_string(mpi_size - 1) + " MPI workers: " + std::to_string(sent_num));
+        }
+        for (int rank = 1; rank < mpi_size; rank++) {
+            MPI_Send(NULL, 0, MPI_CHAR, rank, DIST_TAG_STOP, MPI_COMM_WORLD);
+        }
+        MPI_Finalize();
+        return;
+    }
+#endif
+    if (global_args.dist_mode != "prepare") {
+        return;
+    }
+    // largest first, so that the round robin parts of the workers are balanced
+    std::sort(manifest.begin(), manifest.end(), [](const ManifestEntry& a, const ManifestEntry& b) {
+        return a.record.predicted != b.record.predicted ? a.record.predicted > b.record.predicted : a.name < b.name;
+    });
+    std::ostringstream table;
+    table << "fragment\tsequences\ttotal_length\tmax_length\tpredicted\n";
+    for (const ManifestEntry& e : manifest) {
+        table << e.name << '\t' << e.record.seq_num << '\t' << e.record.total_length << '\t' << e.record.max_length << '\t'
+            << std::fixed << std::setprecision(0) << e.record.predicted << '\n';
+    }
+    uint_t tasks = std::max<uint_t>(1, std::min<uint_t>(global_args.dist_tasks, manifest.size()));
+    std::string dir = absolute_path(global_args.dist_dir);
+    std::ostringstream script;
+    script << "#!/bin/sh\n"
+        << "#SBATCH --job-name=fmalign2\n"
+        << "#SBATCH --array=0-" << tasks - 1 << "\n"
+        << "# Aligns the fragments of " DIST_MANIFEST ", each array task its own part; a task that is run again\n"
+        << "# skips the fragments already aligned. Afterwards run fmalign2 again with -dist merge.\n"
+        << "exec " << shell_quote(program_path)
+        << " -i " << shell_quote(absolute_path(global_args.data_path))
+        << " -o " << shell_quote(absolute_path(global_args.output_path))
+        << " -p " << shell_quote(fs::exists(msa_argument) ? absolute_path(msa_argument) : msa_argument)
+        << " -t \"${SLURM_CPUS_PER_TASK:-1}\" -dist work -dist_dir " << shell_quote(dir) << "\n";
+    if (!write_file_atomic(dist_path(DIST_MANIFEST), table.str()) || !write_file_atomic(dist_path(DIST_SCRIPT), script.str())) {
+        std::cerr << "Error writing the manifest to " << global_args.dist_dir << std::endl;
+        exit(1);
+    }
+    if (global_args.verbose) {
+        print_table_line("Fragments for the workers: " + std::to_string(manifest.size()));
+        print_table_line("Job script: " + std::string(DIST_SCRIPT) + ", " + std::to_string(tasks) + " array tasks");
+    }
+}
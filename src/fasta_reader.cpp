@@ -0,0 +1,536 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/fasta_reader.h"
+#include "../include/scheduler.h"
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// A, C, G, T and U in either case map to upper case, every other byte to N.
+static const std::array<unsigned char, 256> base_table = [] {
+    std::array<unsigned char, 256> table;
+    table.fill('N');
+    for (const char* c = "ACGTU"; *c; c++) {
+        table[(unsigned char)*c] = *c;
+        table[(unsigned char)tolower(*c)] = *c;
+    }
+    return table;
+}();
+
+// The table of aligned input, which keeps the gaps.
+static const std::array<unsigned char, 256> gap_table = [] {
+    std::array<unsigned char, 256> table = base_table;
+    table['-'] = '-';
+    return table;
+}();
+
+[[noreturn]] static void reader_error(const char* path, const std::string& message) {
+    std::cerr << "Error:" << path << " " << message << std::endl;
+    if (!thread_args()) {
+        std::cerr << "Program Exit!" << std::endl;
+    }
+    alignment_failed(std::string(path) + " " + message);
+}
+
+namespace {
+
+// The whole input file as one block of memory: mapped where mmap exists, read into memory elsewhere.
+class InputFile {
+public:
+    explicit InputFile(const char* path) : data_(NULL), size_(0), mapped_(false) {
+#ifndef _WIN32
+        int fd = open(path, O_RDONLY);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            size_ = (size_t)st.st_size;
+            if (size_ == 0) {
+                close(fd);
+                return;
+            }
+            void* base = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (base != MAP_FAILED) {
+                madvise(base, size_, MADV_SEQUENTIAL);
+                close(fd);
+                data_ = (const char*)base;
+                mapped_ = true;
+                return;
+            }
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+        // pipes and systems without mmap read the file into memory
+        FILE* fp = fopen(path, "rb");
+        if (fp == NULL) {
+            reader_error(path, "could not be opened");
+        }
+        size_ = 0;
+        size_t got;
+        do {
+            buffer_.resize(size_ + (1 << 24));
+            got = fread(buffer_.data() + size_, 1, 1 << 24, fp);
+            size_ += got;
+        } while (got > 0);
+        fclose(fp);
+        buffer_.resize(size_);
+        data_ = buffer_.data();
+    }
+
+    ~InputFile() {
+#ifndef _WIN32
+        if (mapped_) {
+            munmap((void*)data_, size_);
+        }
+#endif
+    }
+
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_;
+    size_t size_;
+    bool mapped_;
+    std::vector<char> buffer_;
+};
+
+// Incremental FASTA/FASTQ parser, the text may be fed in pieces cut anywhere.
+class FastaParser {
+public:
+    FastaParser(SequenceStore& data, std::vector<std::string>& name, const std::array<unsigned char, 256>& table)
+        : data_(data), name_(name), table_(table) {}
+
+    void feed(const char* p, const char* end);
+
+    // Close the record that is still open at the end of the input.
+    void finish();
+
+    uint64_t bases() const { return bases_; }
+
+private:
+    enum State { BEFORE_HEADER, HEADER, LINE_START, SEQUENCE, PLUS_LINE, QUALITY };
+
+    void begin_record();
+    void end_record();
+    void copy_sequence(const char* p, const char* end);
+
+    SequenceStore& data_;
+    std::vector<std::string>& name_;
+    const std::array<unsigned char, 256>& table_;
+    State state_ = BEFORE_HEADER;
+    std::string header_;         // header line without the leading > or @
+    bool in_record_ = false;     // a sequence is open in data_
+    bool pending_cr_ = false;    // the piece before ended with \r, which is dropped if \n follows
+    uint64_t seq_length_ = 0;    // length of the last sequence, for its FASTQ quality string
+    uint64_t qual_length_ = 0;
+    uint64_t line_length_ = 0;   // length of the quality line read so far
+    char last_char_ = 0;         // last byte of the quality line read so far
+    uint64_t bases_ = 0;
+};
+
+void FastaParser::begin_record() {
+    // the name is the header with the first white space removed, and a trailing \r stripped
+    if (!header_.empty() && header_.back() == '\r') {
+        header_.pop_back();
+    }
+    size_t space = 0;
+    while (space < header_.size() && !isspace((unsigned char)header_[space])) {
+        space++;
+    }
+    if (space < header_.size()) {
+        header_.erase(space, 1);
+    }
+    name_.push_back(header_);
+    data_.begin_sequence();
+    in_record_ = true;
+    pending_cr_ = false;
+}
+
+void FastaParser::end_record() {
+    if (!in_record_) {
+        return;
+    }
+    data_.end_sequence();
+    seq_length_ = data_.length(data_.size() - 1);
+    bases_ += seq_length_;
+    in_record_ = false;
+    pending_cr_ = false;
+}
+
+// Copy a piece of a sequence line through the table, holding back a \r at its end.
+void FastaParser::copy_sequence(const char* p, const char* end) {
+    if (p == end) {
+        return;
+    }
+    if (pending_cr_) {
+        *data_.extend(1) = table_['\r'];
+        pending_cr_ = false;
+    }
+    if (end[-1] == '\r') {
+        pending_cr_ = true;
+        end--;
+    }
+    size_t n = end - p;
+    unsigned char* out = data_.extend(n);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = table_[(unsigned char)p[i]];
+    }
+}
+
+void FastaParser::feed(const char* p, const char* end) {
+    while (p < end) {
+        switch (state_) {
+        case BEFORE_HEADER: {
+            // as in kseq, the next record starts at the next > or @, wherever it is
+            while (p < end && *p != '>' && *p != '@') {
+                p++;
+            }
+            if (p == end) {
+                return;
+            }
+            p++;
+            header_.clear();
+            state_ = HEADER;
+            break;
+        }
+        case HEADER: {
+            const char* newline = (const char*)memchr(p, '\n', end - p);
+            if (newline == NULL) {
+                header_.append(p, end);
+                return;
+            }
+            header_.append(p, newline);
+            p = newline + 1;
+            begin_record();
+            state_ = LINE_START;
+            break;
+        }
+        case LINE_START: {
+            char c = *p;
+            if (c == '\n') {
+                p++;
+            }
+            else if (c == '>' || c == '@') {
+                end_record();
+                header_.clear();
+                state_ = HEADER;
+                p++;
+            }
+            else if (c == '+') {
+                end_record();
+                state_ = PLUS_LINE;
+                p++;
+            }
+            else {
+                state_ = SEQUENCE;
+            }
+            break;
+        }
+        case SEQUENCE: {
+            const char* newline = (const char*)memchr(p, '\n', end - p);
+            if (newline == NULL) {
+                copy_sequence(p, end);
+                return;
+            }
+            copy_sequence(p, newline);
+            pending_cr_ = false;
+            p = newline + 1;
+            state_ = LINE_START;
+            break;
+        }
+        case PLUS_LINE: {
+            const char* newline = (const char*)memchr(p, '\n', end - p);
+            if (newline == NULL) {
+                return;
+            }
+            p = newline + 1;
+            qual_length_ = 0;
+            line_length_ = 0;
+            last_char_ = 0;
+            state_ = QUALITY;
+            break;
+        }
+        case QUALITY: {
+            // quality lines are read whatever they start with, until they are as long as the sequence
+            const char* newline = (const char*)memchr(p, '\n', end - p);
+            const char* line_end = newline ? newline : end;
+            if (line_end > p) {
+                line_length_ += line_end - p;
+                last_char_ = line_end[-1];
+            }
+            if (newline == NULL) {
+                return;
+            }
+            qual_length_ += line_length_ - (last_char_ == '\r' ? 1 : 0);
+            line_length_ = 0;
+            last_char_ = 0;
+            p = newline + 1;
+            if (qual_length_ >= seq_length_) {
+                state_ = BEFORE_HEADER;
+            }
+            break;
+        }
+        }
+    }
+}
+
+void FastaParser::finish() {
+    if (state_ == HEADER) {
+        begin_record();
+    }
+    end_record();
+    state_ = BEFORE_HEADER;
+}
+
+#ifdef HAVE_ZLIB
+static inline uint32_t get_le(const unsigned char* p, int bytes) {
+    uint32_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+// Size of the BGZF block at p, 0 if p does not start a complete BGZF block.
+static size_t bgzf_block_size(const unsigned char* p, size_t available) {
+    if (available < 18 || p[0] != 0x1f || p[1] != 0x8b || p[2] != 8 || !(p[3] & 4)) {
+        return 0;
+    }
+    size_t extra_length = get_le(p + 10, 2);
+    if (available < 12 + extra_length) {
+        return 0;
+    }
+    // the extra field holds subfields of 2 id bytes, 2 length bytes and the data
+    const unsigned char* extra = p + 12;
+    for (size_t i = 0; i + 4 <= extra_length;) {
+        size_t length = get_le(extra + i + 2, 2);
+        if (extra[i] == 'B' && extra[i + 1] == 'C' && length == 2 && i + 6 <= extra_length) {
+            size_t block_size = get_le(extra + i + 4, 2) + 1;
+            if (block_size < 12 + extra_length + 8 || block_size > available) {
+                return 0;
+            }
+            return block_size;
+        }
+        i += 4 + length;
+    }
+    return 0;
+}
+
+// Inflate one BGZF block into out, which holds exactly the uncompressed size of the block.
+static bool bgzf_inflate_block(const unsigned char* block, size_t block_size, char* out, size_t out_size) {
+    size_t header_size = 12 + get_le(block + 10, 2);
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, -15) != Z_OK) {
+        return false;
+    }
+    zs.next_in = (Bytef*)(block + header_size);
+    zs.avail_in = block_size - header_size - 8;
+    zs.next_out = (Bytef*)out;
+    zs.avail_out = out_size;
+    int status = inflate(&zs, Z_FINISH);
+    bool ok = status == Z_STREAM_END && zs.total_out == out_size;
+    inflateEnd(&zs);
+    return ok && crc32(crc32(0, NULL, 0), (const Bytef*)out, out_size) == get_le(block + block_size - 8, 4);
+}
+
+// Inflate the BGZF blocks from offset on in parallel, a batch at a time; returns where the blocks end.
+static size_t read_bgzf(const char* path, const unsigned char* data, size_t size, size_t offset, FastaParser& parser) {
+    std::vector<size_t> block_begin, block_size, out_begin;
+    std::vector<char> batch;
+    std::vector<char> ok;
+    while (offset < size) {
+        block_begin.clear();
+        block_size.clear();
+        out_begin.assign(1, 0);
+        while (offset < size && out_begin.back() < READER_BATCH_SIZE) {
+            size_t length = bgzf_block_size(data + offset, size - offset);
+            if (length == 0) {
+                break;
+            }
+            block_begin.push_back(offset);
+            block_size.push_back(length);
+            out_begin.push_back(out_begin.back() + get_le(data + offset + length - 4, 4));
+            offset += length;
+        }
+        if (block_begin.empty()) {
+            break;
+        }
+        uint_t block_num = block_begin.size();
+        batch.resize(out_begin.back());
+        ok.assign(block_num, 0);
+        parallel_for(0, block_num, 4, [&](uint_t b) {
+            ok[b] = bgzf_inflate_block(data + block_begin[b], block_size[b], batch.data() + out_begin[b], out_begin[b + 1] - out_begin[b]);
+        });
+        for (uint_t b = 0; b < block_num; b++) {
+            if (!ok[b]) {
+                reader_error(path, "is not a valid BGZF file, block at byte " + std::to_string(block_begin[b]) + " could not be decompressed");
+            }
+        }
+        parser.feed(batch.data(), batch.data() + batch.size());
+    }
+    return offset;
+}
+
+// Inflate gzip members one after the other from offset on.
+static void read_gzip(const char* path, const unsigned char* data, size_t size, size_t offset, FastaParser& parser) {
+    std::vector<char> batch(READER_BATCH_SIZE);
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+        reader_error(path, "could not be decompressed");
+    }
+    // avail_in is 32 bits wide, so larger files are handed to zlib in pieces
+    const size_t max_input = (size_t)1 << 30;
+    auto refill = [&]() {
+        size_t take = std::min(max_input, size - offset);
+        zs.next_in = (Bytef*)(data + offset);
+        zs.avail_in = take;
+        offset += take;
+    };
+    refill();
+    while (true) {
+        if (zs.avail_in == 0 && offset < size) {
+            refill();
+        }
+        zs.next_out = (Bytef*)batch.data();
+        zs.avail_out = batch.size();
+        int status = inflate(&zs, Z_NO_FLUSH);
+        parser.feed(batch.data(), batch.data() + (batch.size() - zs.avail_out));
+        if (status == Z_STREAM_END) {
+            if (zs.avail_in == 0 && offset < size) {
+                refill();
+            }
+            // another member may follow, anything else after the stream is ignored as gzip does
+            if (zs.avail_in < 2 || zs.next_in[0] != 0x1f || zs.next_in[1] != 0x8b) {
+                break;
+            }
+            inflateReset(&zs);
+        }
+        else if (status == Z_BUF_ERROR && zs.avail_in == 0 && offset == size) {
+            inflateEnd(&zs);
+            reader_error(path, "is truncated, the gzip stream ends early");
+        }
+        else if (status != Z_OK && status != Z_BUF_ERROR) {
+            inflateEnd(&zs);
+            reader_error(path, "could not be decompressed, it is not a valid gzip file");
+        }
+    }
+    inflateEnd(&zs);
+}
+#endif
+
+} // namespace
+
+// Read every record of path through table, see read_sequences().
+static uint64_t read_records(const char* path, SequenceStore& data, std::vector<std::string>& name, const std::array<unsigned char, 256>& table) {
+    InputFile file(path);
+    const unsigned char* bytes = (const unsigned char*)file.data();
+    const size_t size = file.size();
+    FastaParser parser(data, name, table);
+    bool gzip = size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b;
+
+    if (!gzip) {
+        // the file size bounds the sequence bytes, so the store never grows while it is filled
+        data.reserve(size, 0);
+        parser.feed(file.data(), file.data() + size);
+        parser.finish();
+        return parser.bases();
+    }
+#ifdef HAVE_ZLIB
+    size_t offset = 0;
+    if (bgzf_block_size(bytes, size) > 0) {
+        size_t total = 0;
+        for (size_t o = 0, length; o < size && (length = bgzf_block_size(bytes + o, size - o)) > 0; o += length) {
+            total += get_le(bytes + o + length - 4, 4);
+        }
+        data.reserve(total, 0);
+        offset = read_bgzf(path, bytes, size, 0, parser);
+    }
+    else if (size >= 18) {
+        // the last member records its size modulo 2^32, a good hint for the usual single member file
+        size_t hint = get_le(bytes + size - 4, 4);
+        if (hint >= size) {
+            data.reserve(hint, 0);
+        }
+    }
+    if (offset < size) {
+        read_gzip(path, bytes, size, offset, parser);
+    }
+    parser.finish();
+    return parser.bases();
+#else
+    reader_error(path, "is gzip compressed, rebuild with zlib (make ZLIB=1) to read it");
+#endif
+}
+
+/**
+* @brief Read every record of a FASTA or FASTQ file, plain, gzip or BGZF compressed.
+* @param path The input file.
+* @param data Receives the normalized sequences.
+* @param name Receives the sequence names.
+* @return The number of bases read.
+*/
+uint64_t read_sequences(const char* path, SequenceStore& data, std::vector<std::string>& name) {
+    return read_records(path, data, name, base_table);
+}
+
+/**
+* @brief Read the rows of an aligned FASTA file like read_sequences(), but keep the gaps '-'.
+* @param path The alignment file.
+* @param rows Receives the normalized rows.
+* @param name Receives the sequence names.
+* @return The number of characters read, gaps included.
+*/
+uint64_t read_alignment(const char* path, SequenceStore& rows, std::vector<std::string>& name) {
+    return read_records(path, rows, name, gap_table);
+}
+
+/**
+* @brief Parse FASTA or FASTQ text that is already in memory, like read_sequences() parses a plain file.
+* @param text The records.
+* @param data Receives the normalized sequences.
+* @param name Receives the sequence names.
+* @return The number of bases read.
+*/
+uint64_t parse_sequences(std::string_view text, SequenceStore& data, std::vector<std::string>& name) {
+    FastaParser parser(data, name, base_table);
+    data.reserve(text.size(), 0);
+    parser.feed(text.data(), text.data() + text.size());
+    parser.finish();
+    return parser.bases();
+}
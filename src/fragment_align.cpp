@@ -0,0 +1,403 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/fragment_align.h"
+#include "../include/ssw_cpp.h"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+
+static inline int residue_class(char c) {
+    switch (c) {
+    case 'A': case 'a': return 0;
+    case 'C': case 'c': return 1;
+    case 'G': case 'g': return 2;
+    case 'T': case 't': case 'U': case 'u': return 3;
+    default: return 4;
+    }
+}
+
+/**
+* @brief The scores of the default StripedSmithWaterman::Aligner, which expand_chain() aligns with.
+* @return The scores.
+*/
+const FragmentScores& fragment_scores() {
+    static const FragmentScores scores = [] {
+        StripedSmithWaterman::Aligner aligner;
+        return FragmentScores{ aligner.GetMatchScore(), aligner.GetMismatchPenalty(),
+            aligner.GetGapOpeningPenalty(), aligner.GetGapExtendingPenalty() };
+    }();
+    return scores;
+}
+
+/**
+* @brief Decide how a fragment is aligned.
+* @param rows The distinct rows of the fragment.
+* @param small_limit The largest total length aligned in-process, 0 to send every non-trivial fragment to the backend.
+* @param max_mismatch The part of the bases in which rows of equal length may differ from the first row and still be
+*        written as they are, 0 to take only rows without substitutions.
+* @return The kind of the fragment.
+*/
+FragmentKind classify_fragment(const std::vector<std::string_view>& rows, uint64_t small_limit, double max_mismatch) {
+    uint_t non_empty = 0;
+    uint64_t total_length = 0;
+    for (std::string_view row : rows) {
+        non_empty += row.empty() ? 0 : 1;
+        total_length += row.size();
+    }
+    if (non_empty <= 1) {
+        return FRAGMENT_TRIVIAL;
+    }
+    // rows of equal length with no more substitutions than allowed are written without gaps
+    bool ungapped = true;
+    const size_t length = rows[0].size();
+    const size_t max_mismatch_bases = (size_t)(length * max_mismatch);
+    for (size_t i = 1; i < rows.size() && ungapped; i++) {
+        if (rows[i].size() != length) {
+            ungapped = false;
+            break;
+        }
+        size_t mismatch = 0;
+        for (size_t j = 0; j < length && mismatch <= max_mismatch_bases; j++) {
+            mismatch += rows[i][j] != rows[0][j];
+        }
+        ungapped = mismatch <= max_mismatch_bases;
+    }
+    if (ungapped) {
+        return FRAGMENT_TRIVIAL;
+    }
+    if (total_length <= small_limit) {
+        return FRAGMENT_SMALL;
+    }
+    return FRAGMENT_HARD;
+}
+
+/**
+* @brief Align a trivial fragment: rows of equal length stay as they are, empty rows are filled with gaps.
+* @param rows The distinct rows of a fragment classified as FRAGMENT_TRIVIAL.
+* @param aligned Receives the aligned rows in the order of rows.
+*/
+void align_trivial_fragment(const std::vector<std::string_view>& rows, std::vector<std::string>& aligned) {
+    size_t length = 0;
+    for (std::string_view row : rows) {
+        length = std::max(length, row.size());
+    }
+    aligned.clear();
+    for (std::string_view row : rows) {
+        aligned.emplace_back(row);
+        aligned.back().append(length - row.size(), '-');
+    }
+}
+
+/**
+* @brief Add an aligned row to the column frequencies of a profile.
+* @param profile The profile, as long as the row.
+* @param row The aligned row.
+*/
+void add_to_profile(std::vector<ProfileColumn>& profile, std::string_view row) {
+    for (size_t j = 0; j < row.size(); j++) {
+        if (row[j] != '-') {
+            profile[j].count[residue_class(row[j])]++;
+            profile[j].residues++;
+        }
+    }
+}
+
+// Half width of the band of a DP of n rows and m columns whose trace fits into max_cells, m for the whole matrix.
+// A band narrower than PROFILE_MIN_BAND is not worth aligning in, so the trace may then exceed max_cells; it stays
+// linear in n + m like the row and the profile themselves.
+static size_t profile_band(size_t n, size_t m, uint64_t max_cells) {
+    if (n == 0 || (uint64_t)(n + 1) * (m + 1) <= max_cells) {
+        return m;
+    }
+    const uint64_t step = (m + n - 1) / n;
+    const uint64_t per_row = max_cells / (n + 1);
+    const uint64_t half = per_row > step + 1 ? (per_row - step - 1) / 2 : 0;
+    return (size_t)std::min<uint64_t>(m, std::max<uint64_t>(half, PROFILE_MIN_BAND));
+}
+
+// The columns [lo, hi] of DP row i in a band of the given half width around the diagonal from (0, 0) to (n, m).
+// The band of a row reaches the start of the band of the next one, so every cell of it can be reached.
+static inline void profile_band_row(size_t i, size_t n, size_t m, size_t half, size_t& lo, size_t& hi) {
+    if (half >= m) {
+        lo = 0;
+        hi = m;
+        return;
+    }
+    const size_t center = (size_t)((uint64_t)i * m / n);
+    const size_t step = (m + n - 1) / n;
+    lo = center > half ? center - half : 0;
+    hi = std::min(m, center + step + half);
+}
+
+/**
+* @brief The number of trace cells, one byte each, that align_to_profile() keeps for a row of n bases and m profile columns.
+* @param n The length of the row.
+* @param m The number of profile columns.
+* @param max_cells The trace cells above which the DP is banded.
+* @return The number of cells.
+*/
+uint64_t profile_trace_cells(size_t n, size_t m, uint64_t max_cells) {
+    const size_t half = profile_band(n, m, max_cells);
+    if (half >= m) {
+        return (uint64_t)(n + 1) * (m + 1);
+    }
+    uint64_t cells = 0;
+    for (size_t i = 0; i <= n; i++) {
+        size_t lo, hi;
+        profile_band_row(i, n, m, half, lo, hi);
+        cells += hi - lo + 1;
+    }
+    return cells;
+}
+
+// The DP of align_to_profile() with every score multiplied by scale, the largest number of rows of a column, so all
+// of them are integers. The scores of a column of fewer rows are scaled up to the same weight. Each DP row is only
+// computed in its band, see profile_band_row(), and the cells next to the band count as unreachable. The moves into
+// the match and the row gap state of a DP row only read the row above: they are computed for the band in branch-free
+// loops the compiler vectorizes, and only the column gap state is a scan along the row.
+template <typename Score>
+static std::vector<unsigned char> align_to_profile_scaled(std::string_view row, const std::vector<ProfileColumn>& profile,
+    const uint_t* column_rows, uint_t scale, uint64_t max_cells) {
+    const size_t n = row.size();
+    const size_t m = profile.size();
+    // far enough below every reachable score that it stays below after all steps of a path
+    const Score neg_inf = std::numeric_limits<Score>::min() / 4;
+    const FragmentScores& scores = fragment_scores();
+    const Score open = (Score)scores.gap_open * scale, extend = (Score)scores.gap_extend * scale;
+    // score of every residue class against every column, N scores 0
+    std::vector<Score> class_score(PROFILE_CLASSES * m, 0);
+    for (size_t j = 0; j < m; j++) {
+        const ProfileColumn& column = profile[j];
+        const uint_t rows = column_rows == NULL ? scale : std::max<uint_t>(column_rows[j], 1);
+        for (int c = 0; c < PROFILE_CLASSES - 1; c++) {
+            Score same = column.count[c];
+            Score other = column.residues - column.count[c] - column.count[PROFILE_CLASSES - 1];
+            Score score = scores.match * same - scores.mismatch * other;
+            class_score[c * m + j] = rows == scale ? score : (Score)((int64_t)score * scale / rows);
+        }
+    }
+    // the trace of a DP row starts at row_begin[i] and covers its band
+    const size_t half = profile_band(n, m, max_cells);
+    std::vector<uint64_t> row_begin(n + 2, 0);
+    for (size_t i = 0; i <= n; i++) {
+        size_t lo, hi;
+        profile_band_row(i, n, m, half, lo, hi);
+        row_begin[i + 1] = row_begin[i] + (hi - lo + 1);
+    }
+    // one row of each matrix, the trace keeps the predecessor state of every state in 2 bits each
+    std::vector<Score> M(m + 1), X(m + 1), Y(m + 1), prev_M(m + 1), prev_X(m + 1), prev_Y(m + 1);
+    std::vector<unsigned char> from_m(m + 1), from_y(m + 1);
+    std::vector<unsigned char> trace(row_begin[n + 1], 0);
+    // the first of the best, as the double version picked it
+    auto best_of = [](Score a, Score b, Score c, unsigned char& from) {
+        Score best = a;
+        from = TRACE_MATCH;
+        from = b > best ? TRACE_COLUMN : from;
+        best = b > best ? b : best;
+        from = c > best ? TRACE_ROW : from;
+        best = c > best ? c : best;
+        return best;
+    };
+
+    size_t prev_hi = 0;
+    for (size_t i = 0; i <= n; i++) {
+        size_t lo, hi;
+        profile_band_row(i, n, m, half, lo, hi);
+        unsigned char* row_trace = trace.data() + row_begin[i];
+        const size_t first = std::max<size_t>(lo, 1);
+        if (lo > 0) {
+            // the cell left of the band, read by the scan below and by the next row
+            M[lo - 1] = neg_inf;
+            X[lo - 1] = neg_inf;
+            Y[lo - 1] = neg_inf;
+        }
+        if (i == 0) {
+            M[0] = 0;
+            Y[0] = neg_inf;
+            for (size_t j = 1; j <= hi; j++) {
+                M[j] = neg_inf;
+                Y[j] = neg_inf;
+            }
+            std::fill(from_m.begin(), from_m.end(), TRACE_MATCH);
+            std::fill(from_y.begin(), from_y.end(), TRACE_MATCH);
+        }
+        else {
+            // the cells of the row above right of its band
+            for (size_t j = prev_hi + 1; j <= hi; j++) {
+                prev_M[j] = neg_inf;
+                prev_X[j] = neg_inf;
+                prev_Y[j] = neg_inf;
+            }
+            const Score* score = class_score.data() + residue_class(row[i - 1]) * m;
+            if (lo == 0) {
+                M[0] = neg_inf;
+                from_m[0] = TRACE_MATCH;
+            }
+            for (size_t j = first; j <= hi; j++) {
+                M[j] = best_of(prev_M[j - 1], prev_X[j - 1], prev_Y[j - 1], from_m[j]) + score[j - 1];
+            }
+            for (size_t j = lo; j <= hi; j++) {
+                Y[j] = best_of(prev_M[j] - open, prev_X[j] - open, prev_Y[j] - extend, from_y[j]);
+            }
+        }
+        if (lo == 0) {
+            X[0] = neg_inf;
+            row_trace[0] = from_m[0] | (from_y[0] << 4);
+        }
+        for (size_t j = first; j <= hi; j++) {
+            unsigned char from_x;
+            X[j] = best_of(M[j - 1] - open, X[j - 1] - extend, Y[j - 1] - open, from_x);
+            row_trace[j - lo] = from_m[j] | (from_x << 2) | (from_y[j] << 4);
+        }
+        std::swap(M, prev_M);
+        std::swap(X, prev_X);
+        std::swap(Y, prev_Y);
+        prev_hi = hi;
+    }
+
+    unsigned char state;
+    best_of(prev_M[m], prev_X[m], prev_Y[m], state);
+    std::vector<unsigned char> ops;
+    ops.reserve(n + m);
+    size_t i = n, j = m;
+    while (i > 0 || j > 0) {
+        size_t lo, hi;
+        profile_band_row(i, n, m, half, lo, hi);
+        unsigned char from = (trace[row_begin[i] + (j - lo)] >> (2 * state)) & 3;
+        ops.push_back(state);
+        if (state == TRACE_MATCH) { i--; j--; }
+        else if (state == TRACE_COLUMN) { j--; }
+        else { i--; }
+        state = from;
+    }
+    std::reverse(ops.begin(), ops.end());
+    return ops;
+}
+
+// Run the DP with 32 bit scores while the longest path cannot leave the range, 64 bit beyond.
+static std::vector<unsigned char> align_to_profile_dispatch(std::string_view row, const std::vector<ProfileColumn>& profile,
+    const uint_t* column_rows, uint_t scale, uint64_t max_cells) {
+    scale = std::max<uint_t>(scale, 1);
+    const FragmentScores& scores = fragment_scores();
+    const uint64_t bound = (uint64_t)(row.size() + profile.size() + 2) * scale * (scores.gap_open + scores.match + scores.mismatch);
+    if (bound < ((uint64_t)1 << 28)) {
+        return align_to_profile_scaled<int32_t>(row, profile, column_rows, scale, max_cells);
+    }
+    return align_to_profile_scaled<int64_t>(row, profile, column_rows, scale, max_cells);
+}
+
+/**
+* @brief Global alignment with affine gaps of a row against the column frequencies of a profile.
+* The scores are averaged over row_num rows: a base scores the match and mismatch scores of the profile rows it
+* meets in a column, gap columns and N score 0.
+* @param row The row to align, without gaps.
+* @param profile The profile.
+* @param row_num The number of rows the profile was built from, at least 1.
+* @return The operations from left to right, TRACE_MATCH, TRACE_COLUMN or TRACE_ROW.
+*/
+std::vector<unsigned char> align_to_profile(std::string_view row, const std::vector<ProfileColumn>& profile, uint_t row_num) {
+    return align_to_profile_dispatch(row, profile, NULL, row_num, std::numeric_limits<uint64_t>::max());
+}
+
+/**
+* @brief Global alignment with affine gaps of a row against a profile whose columns come from different numbers of rows.
+* The scores of every column are averaged over its own rows. If the whole DP matrix has more than max_cells cells,
+* only a band around its diagonal is computed, so the trace needs about max_cells bytes, see profile_trace_cells().
+* @param row The row to align, without gaps.
+* @param profile The profile.
+* @param column_rows The number of rows every column was built from.
+* @param max_cells The trace cells above which the DP is banded.
+* @return The operations from left to right, TRACE_MATCH, TRACE_COLUMN or TRACE_ROW.
+*/
+std::vector<unsigned char> align_to_profile(std::string_view row, const std::vector<ProfileColumn>& profile,
+    const std::vector<uint_t>& column_rows, uint64_t max_cells) {
+    uint_t scale = 1;
+    for (uint_t rows : column_rows) {
+        scale = std::max(scale, rows);
+    }
+    return align_to_profile_dispatch(row, profile, column_rows.data(), scale, max_cells);
+}
+
+/**
+* @brief Align the rows progressively, the longest row first and every other row against the profile of the rows before it.
+* Each step is a global alignment with affine gaps of the row against the column frequencies of the profile.
+* @param rows The rows to align.
+* @param aligned Receives the aligned rows in the order of rows.
+*/
+void progressive_align(const std::vector<std::string_view>& rows, std::vector<std::string>& aligned) {
+    aligned.assign(rows.size(), "");
+    if (rows.empty()) {
+        return;
+    }
+    std::vector<uint_t> order(rows.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&rows](uint_t a, uint_t b) {
+        return rows[a].size() > rows[b].size();
+    });
+
+    std::vector<ProfileColumn> profile;
+    aligned[order[0]] = std::string(rows[order[0]]);
+    profile.assign(aligned[order[0]].size(), ProfileColumn{ {}, 0 });
+    add_to_profile(profile, aligned[order[0]]);
+
+    for (uint_t k = 1; k < order.size(); k++) {
+        std::string_view row = rows[order[k]];
+        std::vector<unsigned char> ops = align_to_profile(row, profile, k);
+        // new gap columns are inserted into the rows that are already aligned
+        std::string new_row;
+        std::vector<ProfileColumn> new_profile;
+        std::vector<int_t> column_of;   // old column of each new column, -1 for an inserted one
+        size_t i = 0, j = 0;
+        for (unsigned char op : ops) {
+            if (op == TRACE_MATCH) {
+                new_row.push_back(row[i++]);
+                new_profile.push_back(profile[j]);
+                column_of.push_back(j++);
+            }
+            else if (op == TRACE_COLUMN) {
+                new_row.push_back('-');
+                new_profile.push_back(profile[j]);
+                column_of.push_back(j++);
+            }
+            else {
+                new_row.push_back(row[i++]);
+                new_profile.push_back(ProfileColumn{ {}, 0 });
+                column_of.push_back(-1);
+            }
+        }
+        if (new_profile.size() != profile.size()) {
+            for (uint_t p = 0; p < k; p++) {
+                std::string& old_row = aligned[order[p]];
+                std::string expanded(column_of.size(), '-');
+                for (size_t c = 0; c < column_of.size(); c++) {
+                    if (column_of[c] >= 0) {
+                        expanded[c] = old_row[column_of[c]];
+                    }
+                }
+                old_row.swap(expanded);
+            }
+        }
+        profile.swap(new_profile);
+        aligned[order[k]] = new_row;
+        add_to_profile(profile, aligned[order[k]]);
+    }
+}
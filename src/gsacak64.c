@@ -0,0 +1,67 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+// The 64 bit build of gsacak.c. Every external name gets the suffix _64, so that it links next to
+// the 32 bit build; find_mem() calls the one of the index width (see suffix_index.h).
+#undef M64
+#define M64 1
+#define EMPTY_k EMPTY_k_64
+#define SACA_K SACA_K_64
+#define compare_k compare_k_64
+#define compute_lcp_phi_sparse compute_lcp_phi_sparse_64
+#define gSACA_K gSACA_K_64
+#define gSACA_K_DA gSACA_K_DA_64
+#define gSACA_K_LCP gSACA_K_LCP_64
+#define gSACA_K_LCP_DA gSACA_K_LCP_DA_64
+#define getBuckets_k getBuckets_k_64
+#define getLengthOfLMS getLengthOfLMS_64
+#define getSAlms getSAlms_64
+#define getSAlms_DA getSAlms_DA_64
+#define gsacak gsacak_64
+#define gsacak_int gsacak_int_64
+#define induceSAl0 induceSAl0_64
+#define induceSAl0_generalized induceSAl0_generalized_64
+#define induceSAl0_generalized_DA induceSAl0_generalized_DA_64
+#define induceSAl0_generalized_LCP induceSAl0_generalized_LCP_64
+#define induceSAl0_generalized_LCP_DA induceSAl0_generalized_LCP_DA_64
+#define induceSAl1 induceSAl1_64
+#define induceSAs0 induceSAs0_64
+#define induceSAs0_generalized induceSAs0_generalized_64
+#define induceSAs0_generalized_DA induceSAs0_generalized_DA_64
+#define induceSAs0_generalized_LCP induceSAs0_generalized_LCP_64
+#define induceSAs0_generalized_LCP_DA induceSAs0_generalized_LCP_DA_64
+#define induceSAs1 induceSAs1_64
+#define nameSubstr nameSubstr_64
+#define nameSubstr_generalized nameSubstr_generalized_64
+#define nameSubstr_generalized_LCP nameSubstr_generalized_LCP_64
+#define putSubstr0 putSubstr0_64
+#define putSubstr0_generalized putSubstr0_generalized_64
+#define putSubstr1 putSubstr1_64
+#define putSuffix0 putSuffix0_64
+#define putSuffix0_generalized putSuffix0_generalized_64
+#define putSuffix0_generalized_DA putSuffix0_generalized_DA_64
+#define putSuffix0_generalized_LCP putSuffix0_generalized_LCP_64
+#define putSuffix0_generalized_LCP_DA putSuffix0_generalized_LCP_DA_64
+#define putSuffix1 putSuffix1_64
+#define sacak sacak_64
+#define sacak_int sacak_int_64
+#define stack_push_k stack_push_k_64
+
+#include "gsacak.c"
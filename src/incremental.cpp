@@ -0,0 +1,351 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/incremental.h"
+#include "../include/anchor_sample.h"
+#include "../include/fasta_reader.h"
+#include "../include/metrics.h"
+#include "../include/scheduler.h"
+#include "../include/sequence_split_align.h"
+#include "../include/utils.h"
+#include <atomic>
+#include <fstream>
+
+[[noreturn]] static void incremental_error(const std::string& message) {
+    print_table_bound();
+    std::cerr << "Error: " << message << std::endl;
+    std::cerr << "Program Exit!" << std::endl;
+    exit(1);
+}
+
+/**
+* @brief Write the anchor file of an alignment.
+* @param path The anchor file, the alignment path with ANCHOR_FILE_SUFFIX.
+* @param concat_string The aligned fragments, gap regions and chains in turn as align_chains() returns them.
+* @param row_num The number of rows written to the alignment.
+* @return False if the file could not be written.
+*/
+bool write_anchor_file(const std::string& path, const std::vector<std::vector<std::string>>& concat_string, uint_t row_num) {
+    std::vector<uint_t> fragment_len = get_first_nonzero_lengths(concat_string);
+    std::vector<std::pair<uint_t, uint_t>> anchor_column;
+    uint_t width = 0;
+    for (uint_t k = 0; k < fragment_len.size(); k++) {
+        // the odd fragments are the chains
+        if (k % 2 == 1) {
+            anchor_column.emplace_back(width, width + fragment_len[k]);
+        }
+        width += fragment_len[k];
+    }
+    std::ofstream out(path);
+    out << ANCHOR_FILE_MAGIC << ' ' << ANCHOR_FILE_VERSION << '\n';
+    out << row_num << ' ' << width << ' ' << anchor_column.size() << '\n';
+    for (const std::pair<uint_t, uint_t>& column : anchor_column) {
+        out << column.first << ' ' << column.second << '\n';
+    }
+    out.close();
+    return out.good();
+}
+
+/**
+* @brief Read the anchor file of an alignment.
+* @param path The anchor file.
+* @param row_num The number of rows of the alignment, checked against the file.
+* @param width The number of columns of the alignment, checked against the file.
+* @param anchor_column Receives the column range [begin, end) of every chain.
+* @return False if the file is missing or does not belong to the alignment.
+*/
+bool read_anchor_file(const std::string& path, uint_t row_num, uint_t width, std::vector<std::pair<uint_t, uint_t>>& anchor_column) {
+    std::ifstream in(path);
+    std::string magic;
+    int version = 0;
+    uint_t file_rows = 0, file_width = 0, chain_num = 0;
+    if (!(in >> magic >> version >> file_rows >> file_width >> chain_num) || magic != ANCHOR_FILE_MAGIC
+        || version != ANCHOR_FILE_VERSION || file_rows != row_num || file_width != width) {
+        return false;
+    }
+    anchor_column.assign(chain_num, std::make_pair(0, 0));
+    uint_t last_end = 0;
+    for (std::pair<uint_t, uint_t>& column : anchor_column) {
+        // the chains are in column order and do not overlap
+        if (!(in >> column.first >> column.second) || column.first < last_end || column.second < column.first || column.second > width) {
+            return false;
+        }
+        last_end = column.second;
+    }
+    return true;
+}
+
+/**
+* @brief Add the sequences of add_path to the alignment of alignment_path and write the result to current_args().output_path.
+* @param alignment_path The alignment of an earlier run with its anchor file.
+* @param add_path The new sequences.
+*/
+void add_sequences(const std::string& alignment_path, const std::string& add_path) {
+    std::string output;
+    Timer timer;
+    MetricsPhase read_phase("read_input");
+    SequenceStore rows;
+    std::vector<std::string> name;
+    read_alignment(alignment_path.c_str(), rows, name);
+    const uint_t old_num = rows.size();
+    if (old_num == 0) {
+        incremental_error(alignment_path + " holds no alignment");
+    }
+    const uint_t width = rows.length(0);
+    for (uint_t i = 1; i < old_num; i++) {
+        if (rows.length(i) != width) {
+            incremental_error(alignment_path + " is not an alignment, its rows differ in length");
+        }
+    }
+    std::vector<std::pair<uint_t, uint_t>> anchor_column;
+    const std::string anchor_path = alignment_path + ANCHOR_FILE_SUFFIX;
+    if (!read_anchor_file(anchor_path, old_num, width, anchor_column)) {
+        incremental_error(anchor_path + " is missing or does not belong to " + alignment_path + ", align with -anchors 1 first");
+    }
+    SequenceStore added;
+    read_data(add_path.c_str(), added, name, true);
+    const uint_t add_num = added.size();
+    read_phase.end();
+    if (current_args().verbose) {
+        output = "Alignment rows: " + std::to_string(old_num) + ", columns: " + std::to_string(width);
+        print_table_line(output);
+    }
+
+    // Every anchor is taken from the row with the most residues in its columns, the first row without gaps ends the search
+    MetricsPhase anchor_phase("anchors");
+    timer.reset();
+    const uint_t chain_num = anchor_column.size();
+    std::vector<uint_t> anchor_row(chain_num, 0);
+    std::vector<std::string> anchor(chain_num);
+    parallel_for(0, chain_num, 1, [&](uint_t k) {
+        const uint_t begin = anchor_column[k].first;
+        const uint_t length = anchor_column[k].second - begin;
+        uint_t best = 0;
+        for (uint_t i = 0; i < old_num && best < length; i++) {
+            std::string_view block = rows[i].substr(begin, length);
+            uint_t residues = length - std::count(block.begin(), block.end(), '-');
+            if (residues > best) {
+                best = residues;
+                anchor_row[k] = i;
+            }
+        }
+        std::string_view block = rows[anchor_row[k]].substr(begin, length);
+        anchor[k].reserve(best);
+        for (char c : block) {
+            if (c != '-') {
+                anchor[k].push_back(c);
+            }
+        }
+    });
+
+    // Row 0 of the store the rescue runs on is the anchors one after the other, the new sequences follow
+    std::vector<std::vector<std::pair<int_t, int_t>>> chain(add_num + 1, std::vector<std::pair<int_t, int_t>>(chain_num, std::make_pair(-1, -1)));
+    std::string anchor_text;
+    for (uint_t k = 0; k < chain_num; k++) {
+        chain[0][k] = std::make_pair((int_t)anchor_text.size(), (int_t)anchor[k].size());
+        anchor_text += anchor[k];
+    }
+    SequenceStore rescue;
+    rescue.reserve(anchor_text.size() + added.concat_length(), add_num + 1);
+    rescue.append(anchor_text);
+    for (uint_t j = 0; j < add_num; j++) {
+        rescue.append(added[j]);
+    }
+
+    // An anchor is searched after the anchor before it, within twice the columns between the two plus the slack
+    std::atomic<uint64_t> exact_placed(0);
+    parallel_for(0, add_num, 16, [&](uint_t j) {
+        std::string_view seq = added[j];
+        std::vector<std::pair<int_t, int_t>>& row = chain[j + 1];
+        size_t begin = 0;
+        uint_t last_column = 0;
+        uint64_t found = 0;
+        for (uint_t k = 0; k < chain_num; k++) {
+            if (anchor[k].empty()) {
+                continue;
+            }
+            size_t end = std::min(seq.size(), begin + 2 * (size_t)(anchor_column[k].first - last_column) + ANCHOR_SEARCH_SLACK + anchor[k].size());
+            size_t hit = begin < end ? seq.substr(begin, end - begin).find(anchor[k]) : std::string_view::npos;
+            if (hit != std::string_view::npos) {
+                row[k] = std::make_pair((int_t)(begin + hit), (int_t)anchor[k].size());
+                begin += hit + anchor[k].size();
+                last_column = anchor_column[k].second;
+                found++;
+            }
+        }
+        exact_placed += found;
+    });
+    // The exact hits are copied with the gaps of their anchor row, the chains placed by SW are aligned to their columns
+    std::vector<std::vector<char>> exact(add_num, std::vector<char>(chain_num, 0));
+    for (uint_t j = 0; j < add_num; j++) {
+        for (uint_t k = 0; k < chain_num; k++) {
+            exact[j][k] = chain[j + 1][k].first != -1;
+        }
+    }
+
+    // The anchors missing in a sequence are placed by SW between the anchors around them, chain by chain from the left
+    uint64_t sw_placed = 0;
+    std::vector<std::vector<std::string>> rescue_string(1);
+    for (uint_t k = 0; k < chain_num; k++) {
+        bool missing = false;
+        for (uint_t j = 0; j < add_num && !missing; j++) {
+            missing = chain[j + 1][k].first == -1;
+        }
+        if (!missing || anchor[k].empty()) {
+            continue;
+        }
+        ExpandChainParams params;
+        params.data = &rescue;
+        params.chain = &chain;
+        params.chain_index = k;
+        params.result_store = rescue_string.begin();
+        params.depth = 0;
+        expand_chain(&params);
+        for (uint_t j = 0; j < add_num; j++) {
+            if (chain[j + 1][k].first == -1 && params.expanded_column[j + 1].first != -1) {
+                chain[j + 1][k] = params.expanded_column[j + 1];
+                sw_placed++;
+            }
+        }
+    }
+    rescue.clear();
+    anchor_phase.end();
+    if (current_args().verbose) {
+        uint64_t total = (uint64_t)add_num * chain_num;
+        std::stringstream s;
+        output = "Anchors: " + std::to_string(chain_num) + ", added sequences: " + std::to_string(add_num);
+        print_table_line(output);
+        s << std::fixed << std::setprecision(2) << (total ? 100.0 * exact_placed / total : 100.0);
+        output = "Anchors placed by exact search: " + s.str() + "%";
+        print_table_line(output);
+        s.str("");
+        s << std::fixed << std::setprecision(2) << (total ? 100.0 * sw_placed / total : 0.0);
+        output = "Anchors placed by SW: " + s.str() + "%";
+        print_table_line(output);
+        s.str("");
+        s << std::fixed << std::setprecision(2) << timer.elapsed_time();
+        output = "Anchor placing time: " + s.str() + " seconds.";
+        print_table_line(output);
+        print_table_divider();
+    }
+
+    // The old rows are cut into the gap regions and the chains of the anchor file
+    MetricsPhase align_phase("align");
+    timer.reset();
+    const uint_t fragment_num = 2 * chain_num + 1;
+    const uint_t row_num = old_num + add_num;
+    std::vector<uint_t> fragment_begin(fragment_num + 1, 0);
+    for (uint_t k = 0; k < chain_num; k++) {
+        fragment_begin[2 * k + 1] = anchor_column[k].first;
+        fragment_begin[2 * k + 2] = anchor_column[k].second;
+    }
+    fragment_begin[fragment_num] = width;
+    std::vector<std::vector<std::string>> concat_string(fragment_num, std::vector<std::string>(row_num));
+    parallel_for(0, fragment_num, 1, [&](uint_t k) {
+        for (uint_t i = 0; i < old_num; i++) {
+            concat_string[k][i] = std::string(rows[i].substr(fragment_begin[k], fragment_begin[k + 1] - fragment_begin[k]));
+        }
+        if (k % 2 == 1) {
+            for (uint_t j = 0; j < add_num; j++) {
+                if (exact[j][k / 2]) {
+                    concat_string[k][old_num + j] = concat_string[k][anchor_row[k / 2]];
+                }
+            }
+        }
+    });
+    rows.clear();
+
+    // Between the placed anchors of a new sequence its fragments are one task, every chain placed by SW is one of its own
+    std::vector<Seq2ProfileTask> tasks;
+    for (uint_t j = 0; j < add_num; j++) {
+        const std::vector<std::pair<int_t, int_t>>& row = chain[j + 1];
+        int_t last_end = 0;
+        uint_t first = 0;
+        for (uint_t k = 0; k <= chain_num; k++) {
+            const bool placed = k < chain_num && row[k].first != -1;
+            if (!placed && k < chain_num) {
+                continue;
+            }
+            Seq2ProfileTask task;
+            task.seq_index = old_num + j;
+            task.first = first;
+            task.last = 2 * k;
+            task.begin = last_end;
+            task.end = k < chain_num ? row[k].first : (int_t)added.length(j);
+            tasks.push_back(std::move(task));
+            if (placed && !exact[j][k]) {
+                Seq2ProfileTask sw_task;
+                sw_task.seq_index = old_num + j;
+                sw_task.first = sw_task.last = 2 * k + 1;
+                sw_task.begin = row[k].first;
+                sw_task.end = row[k].first + row[k].second;
+                tasks.push_back(std::move(sw_task));
+            }
+            if (placed) {
+                last_end = row[k].first + row[k].second;
+                first = 2 * k + 2;
+            }
+        }
+    }
+    // Too few anchors were placed in a new sequence if a part between them is too large to align in a useful band
+    std::vector<char> too_sparse(add_num, 0);
+    for (const Seq2ProfileTask& task : tasks) {
+        const uint64_t columns = fragment_begin[task.last + 1] - fragment_begin[task.first];
+        const uint64_t bases = std::max<int_t>(task.end - task.begin, 0);
+        if ((bases + 1) * (columns + 1) > ADD_MAX_TASK_CELLS) {
+            too_sparse[task.seq_index - old_num] = 1;
+        }
+    }
+    const uint_t sparse_num = std::count(too_sparse.begin(), too_sparse.end(), 1);
+    if (sparse_num > 0) {
+        std::string listed;
+        for (uint_t j = 0, shown = 0; j < add_num && shown < 3; j++) {
+            if (too_sparse[j]) {
+                listed += (shown++ ? ", " : "") + name[old_num + j];
+            }
+        }
+        incremental_error(std::to_string(sparse_num) + " added sequence(s) (" + listed + (sparse_num > 3 ? ", ..." : "")
+            + ") hold too few anchors of the alignment, a part between two of them would need more than "
+            + std::to_string(ADD_MAX_TASK_CELLS) + " DP cells. Align them together with the alignment instead");
+    }
+
+    // The tasks take their parts of the new sequences from rows old_num and on
+    SequenceStore parts;
+    parts.reserve(added.concat_length(), row_num);
+    for (uint_t i = 0; i < old_num; i++) {
+        parts.append(std::string_view());
+    }
+    for (uint_t j = 0; j < add_num; j++) {
+        parts.append(added[j]);
+    }
+    added.clear();
+    seq2profile_tasks(concat_string, parts, tasks);
+    align_phase.end();
+    if (current_args().verbose) {
+        std::stringstream s;
+        s << std::fixed << std::setprecision(2) << timer.elapsed_time();
+        output = "Seq-profile rows: " + std::to_string(tasks.size());
+        print_table_line(output);
+        output = "Seq-profile time: " + s.str() + " seconds.";
+        print_table_line(output);
+        print_table_divider();
+    }
+    concat_alignment(concat_string, name, std::vector<uint_t>());
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/index_cache.h"
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static const char INDEX_CACHE_MAGIC[8] = { 'F', 'M', 'I', 'D', 'X', 0, 0, 0 };
+
+struct IndexCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t index_size;
+    uint64_t n;
+    uint64_t sequence_num;
+    uint64_t hash;
+    uint64_t flags;
+};
+
+/**
+* @brief Get the path of the index cache that belongs to an input file.
+* @param data_path The path of the input FASTA file.
+* @return data_path followed by ".fmidx".
+*/
+std::string index_cache_path(const std::string& data_path) {
+    return data_path + ".fmidx";
+}
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+/**
+* @brief Hash the concatenated text, used to detect that the cached index is stale.
+* @param data The concatenated sequences.
+* @param n The length of data.
+* @return 64 bit hash value.
+*/
+uint64_t index_cache_hash(const unsigned char* data, uint64_t n) {
+    // 8 bytes per step with the MurmurHash3 mixing constants
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ (uint64_t)n;
+    uint64_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t k;
+        memcpy(&k, data + i, 8);
+        k *= c1; k = rotl64(k, 31); k *= c2;
+        h ^= k;
+        h = rotl64(h, 27) * 5 + 0x52dce729;
+    }
+    uint64_t tail = 0;
+    for (uint64_t j = 0; i + j < n; j++) {
+        tail |= (uint64_t)data[i + j] << (8 * j);
+    }
+    tail *= c1; tail = rotl64(tail, 31); tail *= c2;
+    h ^= tail;
+    h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Size in bytes of the file described by the header.
+static size_t index_cache_size(const IndexCacheHeader& header) {
+    size_t size = sizeof(IndexCacheHeader) + header.sequence_num * sizeof(uint64_t) + 2 * header.n * header.index_size;
+    if (!(header.flags & INDEX_CACHE_HAS_LCP)) {
+        size -= header.n * header.index_size;
+    }
+    if (header.flags & INDEX_CACHE_HAS_DA) {
+        size += header.n * sizeof(int32_t);
+    }
+    return size;
+}
+
+/**
+* @brief Release the memory of a loaded index cache.
+* @param cache The cache returned by load_index_cache().
+*/
+template <typename Index>
+void release_index_cache(IndexCache<Index>& cache) {
+    if (cache.base) {
+#ifndef _WIN32
+        if (cache.mapped) {
+            munmap(cache.base, cache.size);
+        }
+        else
+#endif
+        {
+            free(cache.base);
+        }
+    }
+    cache = IndexCache<Index>();
+}
+
+/**
+* @brief Load the index cache if it matches the text.
+* The header must have the current version and index width, and the length, sequence number,
+* hash and sequence bounds must all match, otherwise the file is ignored.
+* @param path The cache file.
+* @param concat_data The concatenated sequences the index must belong to.
+* @param n The length of concat_data.
+* @param bounds The begin position of every sequence in concat_data.
+* @param need_lcp_da True if LCP and DA are required; a file without them is then treated as a miss.
+* @param cache Receives the arrays on success.
+* @return True on a cache hit, otherwise false.
+*/
+template <typename Index>
+bool load_index_cache(const std::string& path, const unsigned char* concat_data, Index n, const std::vector<uint_t>& bounds, bool need_lcp_da, IndexCache<Index>& cache) {
+    release_index_cache(cache);
+    IndexCacheHeader header;
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+    bool ok = fread(&header, sizeof(header), 1, fp) == 1;
+    fseek(fp, 0, SEEK_END);
+    long file_size = ftell(fp);
+    if (!ok || memcmp(header.magic, INDEX_CACHE_MAGIC, 8) != 0 || header.version != INDEX_CACHE_VERSION ||
+        header.index_size != sizeof(Index) || header.n != (uint64_t)n || header.sequence_num != bounds.size() ||
+        file_size < 0 || (size_t)file_size != index_cache_size(header)) {
+        fclose(fp);
+        return false;
+    }
+    const uint64_t needed = INDEX_CACHE_HAS_LCP | INDEX_CACHE_HAS_DA;
+    if (need_lcp_da && (header.flags & needed) != needed) {
+        fclose(fp);
+        return false;
+    }
+    // the hash is only computed once the cheap checks have passed
+    if (header.hash != index_cache_hash(concat_data, n)) {
+        fclose(fp);
+        return false;
+    }
+
+#ifndef _WIN32
+    fclose(fp);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    void* base = mmap(NULL, (size_t)file_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    cache.mapped = true;
+#else
+    void* base = malloc((size_t)file_size);
+    if (!base) {
+        fclose(fp);
+        return false;
+    }
+    fseek(fp, 0, SEEK_SET);
+    ok = fread(base, 1, (size_t)file_size, fp) == (size_t)file_size;
+    fclose(fp);
+    if (!ok) {
+        free(base);
+        return false;
+    }
+    cache.mapped = false;
+#endif
+    cache.base = base;
+    cache.size = (size_t)file_size;
+
+    const char* p = (const char*)base + sizeof(IndexCacheHeader);
+    const uint64_t* stored_bounds = (const uint64_t*)p;
+    for (size_t i = 0; i < bounds.size(); i++) {
+        if (stored_bounds[i] != (uint64_t)bounds[i]) {
+            release_index_cache(cache);
+            return false;
+        }
+    }
+    p += bounds.size() * sizeof(uint64_t);
+    cache.SA = (const Index*)p;
+    p += (size_t)n * sizeof(Index);
+    if (header.flags & INDEX_CACHE_HAS_LCP) {
+        cache.LCP = (const IndexInt<Index>*)p;
+        p += (size_t)n * sizeof(Index);
+    }
+    if (header.flags & INDEX_CACHE_HAS_DA) {
+        cache.DA = (const int32_t*)p;
+    }
+    return true;
+}
+
+/**
+* @brief Write the index to the cache file.
+* The file is written to a temporary file next to path first and then renamed, so that a concurrent or interrupted run never sees half a file.
+* @param path The cache file.
+* @param concat_data The concatenated sequences.
+* @param n The length of concat_data.
+* @param bounds The begin position of every sequence in concat_data.
+* @param SA The suffix array.
+* @param LCP The LCP array, may be NULL.
+* @param DA The document array, may be NULL.
+* @return True if the file was written, otherwise false.
+*/
+template <typename Index>
+bool save_index_cache(const std::string& path, const unsigned char* concat_data, Index n, const std::vector<uint_t>& bounds, const Index* SA, const IndexInt<Index>* LCP, const int32_t* DA) {
+    IndexCacheHeader header;
+    memcpy(header.magic, INDEX_CACHE_MAGIC, 8);
+    header.version = INDEX_CACHE_VERSION;
+    header.index_size = sizeof(Index);
+    header.n = n;
+    header.sequence_num = bounds.size();
+    header.hash = index_cache_hash(concat_data, n);
+    header.flags = (LCP ? INDEX_CACHE_HAS_LCP : 0) | (DA ? INDEX_CACHE_HAS_DA : 0);
+
+    // a unique name, so that two runs writing the same cache do not share the temporary file
+    const std::string tmp_path = path + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    FILE* fp = fopen(tmp_path.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    std::vector<uint64_t> stored_bounds(bounds.begin(), bounds.end());
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    ok = ok && fwrite(stored_bounds.data(), sizeof(uint64_t), stored_bounds.size(), fp) == stored_bounds.size();
+    ok = ok && fwrite(SA, sizeof(Index), n, fp) == n;
+    if (LCP) {
+        ok = ok && fwrite(LCP, sizeof(Index), n, fp) == n;
+    }
+    if (DA) {
+        ok = ok && fwrite(DA, sizeof(int32_t), n, fp) == n;
+    }
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok) {
+        remove(tmp_path.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    remove(path.c_str());
+#endif
+    if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+        remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+template void release_index_cache<uint32_t>(IndexCache<uint32_t>& cache);
+template void release_index_cache<uint64_t>(IndexCache<uint64_t>& cache);
+template bool load_index_cache<uint32_t>(const std::string& path, const unsigned char* concat_data, uint32_t n, const std::vector<uint_t>& bounds, bool need_lcp_da, IndexCache<uint32_t>& cache);
+template bool load_index_cache<uint64_t>(const std::string& path, const unsigned char* concat_data, uint64_t n, const std::vector<uint_t>& bounds, bool need_lcp_da, IndexCache<uint64_t>& cache);
+template bool save_index_cache<uint32_t>(const std::string& path, const unsigned char* concat_data, uint32_t n, const std::vector<uint_t>& bounds, const uint32_t* SA, const int32_t* LCP, const int32_t* DA);
+template bool save_index_cache<uint64_t>(const std::string& path, const unsigned char* concat_data, uint64_t n, const std::vector<uint_t>& bounds, const uint64_t* SA, const int64_t* LCP, const int32_t* DA);
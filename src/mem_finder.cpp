@@ -19,6 +19,36 @@
 // Created: 2023-02-25
 
 #include "../include/mem_finder.h"
+#include "../include/metrics.h"
+#include "../include/memory_budget.h"
+
+// Fenwick tree for prefix maxima of (dp, -index) pairs, i.e. the best dp with the smallest index on ties.
+struct ChainFenwick {
+    std::vector<std::pair<double, int_t>> tree;
+
+    explicit ChainFenwick(size_t size) : tree(size + 1, std::make_pair(0.0, (int_t)0)) {}
+
+    // Record (value, index) at key position pos (0-based).
+    void update(size_t pos, double value, int_t index) {
+        std::pair<double, int_t> item(value, -index);
+        for (pos++; pos < tree.size(); pos += pos & (~pos + 1)) {
+            if (tree[pos] < item) {
+                tree[pos] = item;
+            }
+        }
+    }
+
+    // Best pair among the key positions [0, pos).
+    std::pair<double, int_t> query(size_t pos) const {
+        std::pair<double, int_t> best(0.0, 0);
+        for (; pos > 0; pos -= pos & (~pos + 1)) {
+            if (best < tree[pos]) {
+                best = tree[pos];
+            }
+        }
+        return best;
+    }
+};
 
 void* find_optimal_chain(void* arg) {
     FindOptimalChainParams* ptr = static_cast<FindOptimalChainParams*>(arg);
@@ -28,15 +58,26 @@ void* find_optimal_chain(void* arg) {
     uint_t chain_num = chains.size();
     std::vector<double> dp(chain_num, 0);
     std::vector<int_t> prev(chain_num, -1);
-    // Iterate over all "mem" objects and calculate their size and update dynamic programming tables
+    // dp[j] = len[j] + max{dp[i] : i < j, end[i] < begin[j], dp[i] > 0}, with prev[j] the smallest such i.
+    // Visiting j in order and querying the ends stored so far gives the same table as the pairwise loop in O(m log m).
+    std::vector<int_t> ends(chain_num);
     for (uint_t i = 0; i < chain_num; i++) {
-        double len = chains[i].second;
-        dp[i] += len;
-        for (uint_t j = i + 1; j < chain_num; j++) {
-            if (chains[i].first + len < chains[j].first && dp[i] > dp[j]) {
-                dp[j] = dp[i];
-                prev[j] = i;
-            }
+        ends[i] = chains[i].first + chains[i].second;
+    }
+    std::sort(ends.begin(), ends.end());
+    ends.erase(std::unique(ends.begin(), ends.end()), ends.end());
+    ChainFenwick best_before(ends.size());
+    for (uint_t j = 0; j < chain_num; j++) {
+        size_t pos = std::lower_bound(ends.begin(), ends.end(), chains[j].first) - ends.begin();
+        std::pair<double, int_t> best = best_before.query(pos);
+        if (best.first > 0) {
+            dp[j] = best.first;
+            prev[j] = -best.second;
+        }
+        dp[j] += chains[j].second;
+        if (dp[j] > 0) {
+            size_t end_pos = std::lower_bound(ends.begin(), ends.end(), chains[j].first + chains[j].second) - ends.begin();
+            best_before.update(end_pos, dp[j], j);
         }
     }
     // Find the index of the last "mem" object in the longest non-conflicting sequence
@@ -70,65 +111,68 @@ void* find_optimal_chain(void* arg) {
     return NULL;
 }
 
+// Write the occurrences of MEM row into column col of the split points. If a sequence holds several
+// occurrences, the one closest to the average position of the MEM is kept.
+template <typename Index>
+static void place_mem(const MemTable<Index>& mems, uint_t row, uint_t col, std::vector<std::vector<std::pair<int_t, int_t>>>& split_point_on_sequence) {
+    const float avg_pos = mems.avg_pos[row];
+    // Loop through each substring of the current MEM
+    for (uint_t j = mems.offset[row]; j < mems.offset[row + 1]; j++) {
+        // Create a pair of the substring position and the length of the MEM
+        std::pair<int_t, int_t> p(mems.position[j], mems.mem_length[row]);
+        std::pair<int_t, int_t>& split_point = split_point_on_sequence[mems.sequence_index[j]][col];
+        // If this split point is already set for this sequence and it is farther from the average position,
+        // skip this split point and move to the next one
+        if (split_point.first != -1) {
+            if (abs(p.first - avg_pos) > abs(split_point.first - avg_pos)) {
+                continue;
+            }
+        }
+        // Set this split point for this sequence to the current substring position and MEM length
+        split_point = p;
+    }
+}
+
+// Remove the MEMs that consist of gaps only.
+template <typename Index>
+static void remove_empty_mems(MemTable<Index>& mems) {
+    std::vector<uint_t> rows;
+    rows.reserve(mems.size());
+    for (uint_t i = 0; i < mems.size(); i++) {
+        if (mems.mem_length[i] > 0) {
+            rows.push_back(i);
+        }
+    }
+    if (rows.size() != mems.size()) {
+        select_mem_rows(mems, rows);
+    }
+}
+
 /**
 * @brief DP sequence number times! Filter out overlapping memory regions and generate split points for each sequence.
 * Given a vector of memory regions and the number of sequences, this function removes any
 * overlapping memory regions and generates split points for each sequence based on the non-overlapping regions.
-* @param mems Vector of memory regions.
+* @param mems Table of memory regions.
 * @param sequence_num Number of sequences.
 * @return Vector of split points for each sequence.
 */
-std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_accurate(std::vector<mem>& mems, uint_t sequence_num) {
+template <typename Index>
+std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_accurate(MemTable<Index>& mems, uint_t sequence_num) {
     // delete MEM full of "-"
-    std::vector<mem>::iterator mem_it = mems.begin();
-    while (mem_it != mems.end()) {
-        mem tmp_mem = *mem_it;
-        if (tmp_mem.mem_length <= 0) {
-            mem_it = mems.erase(mem_it);
-        }
-        else {
-            mem_it++;
-        }
-    }
+    remove_empty_mems(mems);
     uint_t mem_num = mems.size();
     // Initialize a vector of vectors of pairs of integers to represent the split points for each sequence
     std::vector<std::vector<std::pair<int_t, int_t>>> split_point_on_sequence(sequence_num, std::vector<std::pair<int_t, int_t>>(mem_num, std::make_pair(-1, -1)));
     // Loop through each non-conflicting MEM in the input
     for (uint_t i = 0; i < mem_num; i++) {
-        // Get the current MEM and its substring positions
-        mem tmp_mem = mems[i];
-        // Loop through each substring of the current MEM
-        for (uint_t j = 0; j < tmp_mem.substrings.size(); j++) {
-            // Create a pair of the substring position and the length of the MEM
-            std::pair<int_t, int_t> p(tmp_mem.substrings[j].position, tmp_mem.mem_length);
-            // If this split point is already set for this sequence and it is farther from the average position,
-            // skip this split point and move to the next one
-            if (split_point_on_sequence[tmp_mem.substrings[j].sequence_index][i].first != -1) {
-                if (abs(p.first - tmp_mem.avg_pos) > abs(split_point_on_sequence[tmp_mem.substrings[j].sequence_index][i].first - tmp_mem.avg_pos)) {
-                    continue;
-                }
-            }
-            // Set this split point for this sequence to the current substring position and MEM length
-            split_point_on_sequence[tmp_mem.substrings[j].sequence_index][i] = p;
-        }
+        place_mem(mems, i, i, split_point_on_sequence);
     }
 
     std::vector<FindOptimalChainParams> find_optimal_chain_params(sequence_num);
-#if (defined(__linux__))
-    threadpool pool;
-    threadpool_init(&pool, global_args.thread);
-    for (uint_t i = 0; i < sequence_num; i++) {
-        find_optimal_chain_params[i].chains = split_point_on_sequence.begin() + i;
-        threadpool_add_task(&pool, find_optimal_chain, &find_optimal_chain_params[i]);
-    }
-    threadpool_destroy(&pool);
-#else // Otherwise, use OpenMP for parallel execution
-#pragma omp parallel for num_threads(global_args.thread)
-    for (uint_t i = 0; i < sequence_num; i++) {
+    parallel_for(0, sequence_num, 1, [&](uint_t i) {
         find_optimal_chain_params[i].chains = split_point_on_sequence.begin() + i;
         find_optimal_chain(&find_optimal_chain_params[i]);
-    }
-#endif
+    });
 
 
     // remove column that too much -1
@@ -140,7 +184,7 @@ std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_accurate(std::vecto
                 count++;
             }
         }
-        if (count <= floor(sequence_num * (1 - global_args.min_seq_coverage))) {
+        if (count <= floor(sequence_num * (1 - current_args().min_seq_coverage))) {
             selected_cols.push_back(j);
         }
     }
@@ -157,36 +201,47 @@ std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_accurate(std::vecto
 * @brief DP only Once!Filter out overlapping memory regions and generate split points for each sequence.
 * Given a vector of memory regions and the number of sequences, this function removes any
 * overlapping memory regions and generates split points for each sequence based on the non-overlapping regions.
-* @param mems Vector of memory regions.
+* @param mems Table of memory regions.
 * @param sequence_num Number of sequences.
 * @return Vector of split points for each sequence.
 */
-std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_fast(std::vector<mem> &mems, uint_t sequence_num) {
+template <typename Index>
+std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_fast(MemTable<Index>& mems, uint_t sequence_num) {
     // delete MEM full of "-"
-    std::vector<mem>::iterator mem_it = mems.begin();
-    while (mem_it != mems.end()) {
-        mem tmp_mem = *mem_it;
-        if (tmp_mem.mem_length <= 0) {
-            mem_it = mems.erase(mem_it);
-        }
-        else {
-            mem_it++;
-        }  
-    }
+    remove_empty_mems(mems);
     // Initialize dynamic programming tables to keep track of size and previous indices
     uint_t mem_num = mems.size();
     std::vector<double> dp(mem_num, 0);
     std::vector<int_t> prev(mem_num, -1);
-    // Iterate over all "mem" objects and calculate their size and update dynamic programming tables
+    // dp[j] = size[j] + max{dp[i] : avg_pos[i] + length[i] < avg_pos[j]}, with prev[j] the smallest such i.
+    // MEMs are sorted by avg_pos, so every such i comes before j and the candidates only grow with j:
+    // a sweep over the MEM ends with a running maximum gives the same table as the pairwise loop.
+    std::vector<float> mem_end(mem_num);
+    std::vector<uint_t> by_end(mem_num);
     for (uint_t i = 0; i < mem_num; i++) {
-        double size = mems[i].mem_length * mems[i].substrings.size();
-        dp[i] += size;
-        for (uint_t j = i + 1; j < mem_num; j++) {
-            if (mems[i].avg_pos + mems[i].mem_length < mems[j].avg_pos && dp[i] > dp[j]) {
-                dp[j] = dp[i];
-                prev[j] = i;
+        mem_end[i] = mems.avg_pos[i] + mems.mem_length[i];
+        by_end[i] = i;
+    }
+    std::sort(by_end.begin(), by_end.end(), [&mem_end](uint_t a, uint_t b) {
+        return mem_end[a] < mem_end[b];
+    });
+    double best_dp = 0;
+    int_t best_index = -1;
+    uint_t next_end = 0;
+    for (uint_t j = 0; j < mem_num; j++) {
+        while (next_end < mem_num && mem_end[by_end[next_end]] < mems.avg_pos[j]) {
+            uint_t i = by_end[next_end++];
+            if (dp[i] > best_dp || (dp[i] == best_dp && best_index >= 0 && (int_t)i < best_index)) {
+                best_dp = dp[i];
+                best_index = i;
             }
         }
+        if (best_index >= 0) {
+            dp[j] = best_dp;
+            prev[j] = best_index;
+        }
+        double size = mems.mem_length[j] * (size_t)mems.occurrence_num(j);
+        dp[j] += size;
     }
     // Find the index of the last "mem" object in the longest non-conflicting sequence
     double max_size = 0;
@@ -209,22 +264,7 @@ std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_fast(std::vector<me
 
     // Loop through each non-conflicting MEM in the input
     for (uint_t i = 0; i < mems_without_conflict.size(); i++) {
-        // Get the current MEM and its substring positions
-        mem tmp_mem = mems[mems_without_conflict[i]];
-        // Loop through each substring of the current MEM
-        for (uint_t j = 0; j < tmp_mem.substrings.size(); j++) {
-            // Create a pair of the substring position and the length of the MEM
-            std::pair<int_t, int_t> p(tmp_mem.substrings[j].position, tmp_mem.mem_length);
-            // If this split point is already set for this sequence and it is farther from the average position,
-            // skip this split point and move to the next one
-            if (split_point_on_sequence[tmp_mem.substrings[j].sequence_index][i].first != -1) {
-                if (abs(p.first - tmp_mem.avg_pos) > abs(split_point_on_sequence[tmp_mem.substrings[j].sequence_index][i].first - tmp_mem.avg_pos)) {
-                    continue;
-                }
-            }
-            // Set this split point for this sequence to the current substring position and MEM length
-            split_point_on_sequence[tmp_mem.substrings[j].sequence_index][i] = p;
-        }
+        place_mem(mems, mems_without_conflict[i], i, split_point_on_sequence);
     }
 
 
@@ -277,7 +317,7 @@ std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_fast(std::vector<me
                 count++;
             }
         }
-        if (count <= floor(sequence_num * (1 - global_args.min_seq_coverage))) {
+        if (count <= floor(sequence_num * (1 - current_args().min_seq_coverage))) {
             selected_cols.push_back(j);
         }
     }
@@ -293,127 +333,173 @@ std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_fast(std::vector<me
 
 /**
  * @brief Find MEMs in a set of sequences.
- * @param data A vector of strings representing the sequences.
+ * @param data The sequence store, its concatenated text is indexed in place.
  * @return Vector of split points for each sequence.
  */
-std::vector<std::vector<std::pair<int_t, int_t>>> find_mem(std::vector<std::string> data){
-    if (global_args.verbose) {
+std::vector<std::vector<std::pair<int_t, int_t>>> find_mem(const SequenceStore& data){
+    if (current_args().verbose) {
         std::cout << "#                    Finding MEM...                         #" << std::endl;
         print_table_divider();
     }
     
     std::string output = "";
-    Timer timer;
-    uint_t n = 0;
+    uint_t n = data.concat_length();
 
-    unsigned char* concat_data = concat_strings(data, n); 
-
-    if (global_args.min_mem_length < 0) {
-        int_t l = ceil(pow(n, 1/(global_args.degree+2)));
+    if (current_args().min_mem_length < 0) {
+        int_t l = ceil(pow(n, 1/(current_args().degree+2)));
         l = l > 30 ? l : 30;
         l = l < 2000 ? l : 2000;
 
-        global_args.min_mem_length = l;
+        current_args().min_mem_length = l;
         
     }
-    if (global_args.verbose) {
-        output = "Minimal MEM length is set to " + std::to_string(global_args.min_mem_length);
+    if (current_args().verbose) {
+        output = "Minimal MEM length is set to " + std::to_string(current_args().min_mem_length);
         print_table_line(output);
     }
 
-    if (global_args.filter_mode == "default") {
+    if (current_args().filter_mode == "default") {
         if (data.size() < 100) {
-            global_args.filter_mode = "accurate";
+            current_args().filter_mode = "accurate";
         }
         else {
-            global_args.filter_mode = "fast";
+            current_args().filter_mode = "fast";
         }
         
     }
 
-    if (global_args.verbose) {
-        output = "Filter mode is set to " + global_args.filter_mode;
+    if (current_args().verbose) {
+        output = "Filter mode is set to " + current_args().filter_mode;
         print_table_line(output);
     }
 
-    global_args.min_seq_coverage = 1;
-    if (global_args.verbose) {
-        output = "Minimal sequence coverage is set to " + std::to_string(global_args.min_seq_coverage);
+    current_args().min_seq_coverage = 1;
+    if (current_args().verbose) {
+        output = "Minimal sequence coverage is set to " + std::to_string(current_args().min_seq_coverage);
         print_table_line(output);
     }
-    
-    uint_t *SA = NULL;
-    SA = (uint_t*) malloc(n*sizeof(uint_t));
+
+    MemFinderOptions options;
+    options.min_mem_length = current_args().min_mem_length;
+    options.filter_mode = current_args().filter_mode;
+    options.index_mode = current_args().index_mode;
+    // With -max_mem the lean index is built if the full one does not fit into what is left of the budget
+    MemoryBudget& budget = MemoryBudget::instance();
+    if (budget.enabled() && options.index_mode == "full") {
+        uint64_t index_memory = estimate_index_memory(data.concat_length(), false, current_args().thread);
+        if (index_memory > budget.available()) {
+            options.index_mode = "lean";
+            if (current_args().verbose) {
+                output = "Full index needs " + format_memory_size(index_memory) + ", using lean";
+                print_table_line(output);
+            }
+        }
+    }
+    options.thread = current_args().thread;
+    options.index_cache = current_args().index_cache != 0;
+    options.verbose = current_args().verbose != 0;
+    return find_mem(data, options);
+}
+
+// find_mem() with SA, LCP and the MEM positions stored as Index.
+template <typename Index>
+static std::vector<std::vector<std::pair<int_t, int_t>>> find_mem_index(const SequenceStore& data, const MemFinderOptions& options) {
+    std::string output = "";
+    Timer timer;
+    Index n = data.concat_length();
+    const unsigned char* concat_data = data.concat();
+
+    // The lean index keeps only SA and a one byte LCP, DA is recomputed from the sequence bounds.
+    bool lean_index = options.index_mode == "lean";
+    if (options.verbose) {
+        output = std::string("Index mode: ") + (lean_index ? "lean (SA + thresholded LCP)" : "full (SA + LCP + DA)");
+        print_table_line(output);
+    }
+    const std::vector<uint_t>& joined_sequence_bound = data.bounds();
+    timer.reset();
+    MetricsPhase suffix_phase("suffix_array");
+    // A cached index written by a lean run has no LCP and DA, it only serves lean runs.
+    IndexCache<Index> index_cache;
+    bool cache_hit = false;
+    std::string cache_path;
+    if (options.index_cache) {
+        cache_path = index_cache_path(current_args().data_path);
+        cache_hit = load_index_cache(cache_path, concat_data, n, joined_sequence_bound, !lean_index, index_cache);
+    }
+    // Arrays built by this run, the cached arrays are released with release_index_cache()
+    Index *SA_buf = NULL;
+    IndexInt<Index> *LCP_buf = NULL;
+    int32_t *DA_buf = NULL;
+    const Index *SA = index_cache.SA;
     // LCP[0] = 0, LCP[i] = lcp(concat_data[SA[i]], concat_data[SA[i-1]])
-    int_t *LCP = NULL;
-    LCP = (int_t*) malloc(n*sizeof(int_t));
-    int32_t *DA = NULL;
-    DA = (int32_t*) malloc(n*sizeof(int32_t));
+    const IndexInt<Index> *LCP = index_cache.LCP;
+    const int32_t *DA = index_cache.DA;
+    if (cache_hit) {
+        if (options.verbose) {
+            output = "Index cache: loaded " + cache_path;
+            print_table_line(output);
+        }
+    }
+    else {
+        SA_buf = (Index*) malloc(n*sizeof(Index));
+        if (!lean_index) {
+            // gsacak reads LCP entries of the reduced problem before it writes them, they must start at 0;
+            // this only showed on small texts that reuse heap memory, large blocks come zeroed from mmap
+            LCP_buf = (IndexInt<Index>*) calloc(n, sizeof(IndexInt<Index>));
+            DA_buf = (int32_t*) malloc(n*sizeof(int32_t));
+        }
 #if DEBUG
-    output = "Suffix is constructing...\n";
-    print_table_line(output);
+        output = "Suffix is constructing...\n";
+        print_table_line(output);
 #endif
-    timer.reset();
-    gsacak((unsigned char *)concat_data, (uint_t*)SA, LCP, DA, n);
+        // The parallel builder needs many threads to beat gsacak, small inputs always use gsacak;
+        // its rank and key arrays would more than double the lean index, so lean always uses gsacak too
+        bool parallel_suffix = !lean_index && options.thread >= PARALLEL_SA_MIN_THREADS && n >= PARALLEL_SA_MIN_LENGTH &&
+            parallel_gsa<Index>(concat_data, SA_buf, LCP_buf, DA_buf, n, options.thread) == 0;
+        if (!parallel_suffix) {
+            // gsacak only reads the text, the store stays immutable
+            build_gsacak(concat_data, SA_buf, LCP_buf, DA_buf, n);
+        }
+        SA = SA_buf;
+        LCP = LCP_buf;
+        DA = DA_buf;
+        if (options.verbose) {
+            output = std::string("Suffix array builder: ") + (parallel_suffix ? "parallel prefix doubling" : "gsacak");
+            print_table_line(output);
+        }
+        if (options.index_cache) {
+            bool saved = save_index_cache(cache_path, concat_data, n, joined_sequence_bound, SA, LCP, DA);
+            if (options.verbose) {
+                output = (saved ? "Index cache: written to " : "Warning: fail to write index cache ") + cache_path;
+                print_table_line(output);
+            }
+        }
+    }
+    suffix_phase.end();
     double suffix_construction_time = timer.elapsed_time();
     std::stringstream s;
     s << std::fixed << std::setprecision(2) << suffix_construction_time;
-    if (global_args.verbose) {
+    if (options.verbose) {
     output = "Suffix construction time: " + s.str() + " seconds";
     print_table_line(output);
     }
     
 
     timer.reset();
-    int_t min_mem_length = global_args.min_mem_length;
-    int_t min_cross_sequence = ceil(global_args.min_seq_coverage * data.size());
-    std::vector<uint_t> joined_sequence_bound;
-    uint_t total_length = 0;
-    for (uint_t i = 0; i < data.size(); i++) {
-        joined_sequence_bound.push_back(total_length);
-        total_length += data[i].length() + 1;
-    }
-    // Find all intervals with an LCP >= min_mem_length and <= min_cross_sequence
-    std::vector<std::pair<uint_t, uint_t>> intervals = get_lcp_intervals(LCP, min_mem_length, min_cross_sequence, n);
-
-    free(LCP);
-
-    uint_t interval_size = intervals.size();
-
-    std::vector<mem> mems;
-    mems.resize(interval_size);
-    // Convert each interval to a MEM in parallel
-    IntervalToMemConversionParams* params = new IntervalToMemConversionParams[interval_size];
-#if (defined(__linux__))
-    threadpool pool;
-    threadpool_init(&pool, global_args.thread);
-    for (uint_t i = 0; i < interval_size; i++) {
-        params[i].SA = SA;
-        params[i].DA = DA;
-        params[i].interval = intervals[i];
-        params[i].concat_data = concat_data;
-        params[i].result_store = mems.begin() + i;
-        params[i].min_mem_length = min_mem_length;
-        params[i].joined_sequence_bound = joined_sequence_bound;
-
-        threadpool_add_task(&pool, interval2mem, params+i);
-    }
-    threadpool_destroy(&pool);
-#else
-#pragma omp parallel for num_threads(global_args.thread)
-    for (uint_t i = 0; i < interval_size; i++) {
-        params[i].SA = SA;
-        params[i].DA = DA;
-        params[i].interval = intervals[i];
-        params[i].concat_data = concat_data;
-        params[i].result_store = mems.begin() + i;
-        params[i].min_mem_length = min_mem_length;
-        params[i].joined_sequence_bound = joined_sequence_bound;
-        interval2mem(params + i);
+    MetricsPhase mem_phase("mem_process");
+    int_t min_mem_length = options.min_mem_length;
+    int_t min_cross_sequence = ceil(current_args().min_seq_coverage * data.size());
+    if (options.verbose) {
+        output = "Minimal cross sequence number: " + std::to_string(min_cross_sequence);
+        print_table_line(output);
     }
-#endif
+    // Find the LCP intervals and convert them to MEMs in one pass over chunks of the LCP array
+    MemTable<Index> mems;
+    lcp_intervals_to_mems<Index>(SA, DA, LCP, concat_data, n, min_mem_length, min_cross_sequence, joined_sequence_bound, mems);
+    free(LCP_buf);
+    LCP_buf = NULL;
 
-    if (mems.size() <= 0 && global_args.verbose) {
+    if (mems.size() <= 0 && options.verbose) {
         output = "Warning: There is no MEMs, please adjust your paramters.";
         print_table_line(output);
        
@@ -422,23 +508,22 @@ std::vector<std::vector<std::pair<int_t, int_t>>> find_mem(std::vector<std::stri
     // Sort the MEMs based on their average positions and assign their indices
     sort_mem(mems, data);
 
-    free(SA);
-    free(DA);
-    free(concat_data);
-    delete[] params;
+    free(SA_buf);
+    free(DA_buf);
+    release_index_cache(index_cache);
 
     uint_t sequence_num = data.size();
     std::vector<std::vector<std::pair<int_t, int_t>>> split_point_on_sequence;
-    if (global_args.filter_mode == "fast") {
+    if (options.filter_mode == "fast") {
         split_point_on_sequence = filter_mem_fast(mems, sequence_num);
     }
     else {
         split_point_on_sequence = filter_mem_accurate(mems, sequence_num);
     }
-    
-    global_args.avg_file_size = (n / (split_point_on_sequence[0].size() + 1)) / pow(2, 20);
+
+    mem_phase.end();
     double mem_process_time = timer.elapsed_time();
-    if (global_args.verbose) {
+    if (options.verbose) {
         output = "Sequence divide parts: " + std::to_string(split_point_on_sequence[0].size() + 1);
         print_table_line(output);
         s.str("");
@@ -453,46 +538,19 @@ std::vector<std::vector<std::pair<int_t, int_t>>> find_mem(std::vector<std::stri
 }
 
 /**
- * @brief Concatenates a vector of strings with separator 1 and a terminating 0.
- * @param strings The vector of strings to concatenate.
- * @param n A reference to the total length of the concatenated string.
- * @return A pointer to the concatenated string.
- * @note The returned string must be deleted by the caller.
-*/
-unsigned char* concat_strings(const std::vector<std::string>& strings, uint_t &n) {
-    // Calculate total length of concatenated string
-    uint_t total_length = 0;
-    for (uint_t i = 0; i < strings.size(); i++) {
-        total_length += strings[i].length() + 1;
-    }
-   
-    total_length++;  // Add 1 for the terminating 0
-
-    // Allocate memory for concatenated string
-    unsigned char* concat_data = new unsigned char[total_length];
-
-    if (!concat_data) {
-        std::string out = "concat_data could not allocate enough space\n";
-        print_table_line(out);
-        exit(1);
-    }
-
-    // Concatenate all strings with 1 as separator
-    uint_t index = 0;
-    for (const auto& s : strings) {
-        std::copy(s.begin(), s.end(), concat_data + index);
-        index += s.length();
-        concat_data[index] = 1;
-        index++;
+ * @brief Find MEMs in a set of sequences with the given settings, global_args is not modified.
+ * @param data The sequence store, its concatenated text is indexed in place.
+ * @param options The MEM length, filter and index settings of this run.
+ * @return Vector of split points for each sequence.
+ */
+std::vector<std::vector<std::pair<int_t, int_t>>> find_mem(const SequenceStore& data, const MemFinderOptions& options) {
+    // gsacak keeps a flag in the top bit of SA, texts up to 2^31 - 1 bases fit into 32 bit arrays
+    bool index32 = use_index32(data.concat_length());
+    if (options.verbose) {
+        std::string output = std::string("Index width: ") + (index32 ? "32 bit" : "64 bit");
+        print_table_line(output);
     }
-
-    // Set the terminating 0
-    concat_data[total_length - 1] = 0;
-
-    n = total_length;
-
-    return concat_data;
-
+    return index32 ? find_mem_index<uint32_t>(data, options) : find_mem_index<uint64_t>(data, options);
 }
 
 /**
@@ -504,13 +562,10 @@ unsigned char* concat_strings(const std::vector<std::string>& strings, uint_t &n
  * @param min_cross_sequence the min number of crossed sequence
  * @return  The output vector of pairs representing the LCP intervals
 */
-std::vector<std::pair<uint_t, uint_t>> get_lcp_intervals(int_t* lcp_array, int_t threshold, int_t min_cross_sequence, uint_t n) {
+template <typename Index>
+std::vector<std::pair<Index, Index>> get_lcp_intervals(const IndexInt<Index>* lcp_array, int_t threshold, int_t min_cross_sequence, Index n) {
 
-    std::vector<std::pair<uint_t, uint_t>> intervals;
-    if (global_args.verbose) {
-        std::string output = "Minimal cross sequence number: " + std::to_string(min_cross_sequence);
-        print_table_line(output);
-    }
+    std::vector<std::pair<Index, Index>> intervals;
     
     int_t left = 0, right = 0;
     bool found = false;
@@ -538,6 +593,88 @@ std::vector<std::pair<uint_t, uint_t>> get_lcp_intervals(int_t* lcp_array, int_t
     return intervals;
 }
 
+/**
+ * @brief Same as get_lcp_intervals() above, but on an LCP array thresholded by threshold_lcp().
+ * @param lcp_flags The thresholded LCP array, every value is LCP_BELOW, LCP_EQUAL or LCP_ABOVE
+ * @param min_cross_sequence the min number of crossed sequence
+ * @param n The length of the array
+ * @return  The output vector of pairs representing the LCP intervals
+*/
+template <typename Index>
+std::vector<std::pair<Index, Index>> get_lcp_intervals(const unsigned char* lcp_flags, int_t min_cross_sequence, Index n) {
+
+    std::vector<std::pair<Index, Index>> intervals;
+
+    int_t left = 0, right = 0;
+    bool found = false;
+
+    while (right < (int_t)n) {
+
+        if (lcp_flags[right] != LCP_BELOW) {
+            if (lcp_flags[right] == LCP_EQUAL) {
+                found = true;
+            }
+            right++;
+        } else {
+            if (found && right-left+1 >= min_cross_sequence) {
+                intervals.emplace_back(left, right);
+            }
+
+            left = right = right + 1;
+            found = false;
+        }
+    }
+
+    if (found && right - left + 1 >= min_cross_sequence) {
+        intervals.emplace_back(left, right);
+    }
+    return intervals;
+}
+
+// LCP_BELOW, LCP_EQUAL or LCP_ABOVE for lcp(SA[i], SA[i-1]) compared to limit, at most limit+1 characters are compared.
+template <typename Index>
+static inline unsigned char threshold_lcp_value(const unsigned char* concat_data, const Index* SA, Index i, uint_t limit) {
+    if (i == 0) {
+        return limit == 0 ? LCP_EQUAL : LCP_BELOW;
+    }
+    // the terminating 0 and the separators never match, so the comparison stays inside the text
+    const unsigned char* a = concat_data + SA[i];
+    const unsigned char* b = concat_data + SA[i - 1];
+    uint_t l = 0;
+    while (l <= limit && a[l] == b[l] && a[l] > 1) {
+        l++;
+    }
+    return l < limit ? LCP_BELOW : (l == limit ? LCP_EQUAL : LCP_ABOVE);
+}
+
+/**
+ * @brief Computes the LCP array of the lean index, where each value only tells whether
+ * lcp(SA[i], SA[i-1]) is below, equal to or above the threshold.
+ * At most threshold+1 characters are compared per suffix, the comparison stops at separators like gsacak does.
+ * @param concat_data The concatenated sequences
+ * @param SA The suffix array
+ * @param n The length of the concatenated sequences
+ * @param threshold The threshold value, i.e. the minimal MEM length
+ * @return The thresholded LCP array of length n, to be released with free()
+*/
+template <typename Index>
+unsigned char* threshold_lcp(const unsigned char* concat_data, const Index* SA, Index n, int_t threshold) {
+    unsigned char* lcp_flags = (unsigned char*)malloc(n);
+    if (!lcp_flags) {
+        std::string out = "lcp_flags could not allocate enough space";
+        print_table_line(out);
+        alignment_failed(out);
+    }
+    const uint_t limit = threshold < 0 ? 0 : (uint_t)threshold;
+    auto fill = [&](uint_t begin, uint_t end) {
+        for (Index i = begin; i < end; i++) {
+            lcp_flags[i] = threshold_lcp_value(concat_data, SA, i, limit);
+        }
+    };
+    Scheduler::instance().parallel_for_range(0, n, 1 << 16, fill);
+    return lcp_flags;
+}
+
 void draw_lcp_curve(int_t *LCP, uint_t n){
     std::ofstream outfile("tmp/lcp.bin", std::ios::out | std::ios::binary);
     
@@ -575,145 +712,271 @@ void draw_lcp_curve(int_t *LCP, uint_t n){
 
 }
 
+// Number of equal bytes directly before text + a and text + b, at most limit; the caller keeps limit <= min(a, b).
+// Eight bytes are compared per step, the first difference is found with count leading zeros.
+static uint_t common_suffix_length(const unsigned char* text, uint_t a, uint_t b, uint_t limit) {
+    uint_t l = 0;
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // the byte next to a - l is the most significant one of the word that ends there
+    while (l + 8 <= limit) {
+        uint64_t wa, wb;
+        memcpy(&wa, text + a - l - 8, 8);
+        memcpy(&wb, text + b - l - 8, 8);
+        uint64_t diff = wa ^ wb;
+        if (diff) {
+            return l + (__builtin_clzll(diff) >> 3);
+        }
+        l += 8;
+    }
+#endif
+    while (l < limit && text[a - l - 1] == text[b - l - 1]) {
+        l++;
+    }
+    return l;
+}
+
 /**
 *@brief This function converts an LCP interval to a MEM (Maximal Exact Match).
 *@param arg A void pointer to the input parameters.
 *@return void* A void pointer to the result, which is stored in the input parameters structure.
 */
+template <typename Index>
 void* interval2mem(void* arg) {
     // Cast the input parameters to the correct struct type
-    IntervalToMemConversionParams* ptr = static_cast<IntervalToMemConversionParams*>(arg);
+    IntervalToMemConversionParams<Index>* ptr = static_cast<IntervalToMemConversionParams<Index>*>(arg);
     // Extract the necessary variables from the struct
-    const uint_t* SA = ptr->SA;
+    const Index* SA = ptr->SA;
     const int32_t* DA = ptr->DA;
     const int_t min_mem_length = ptr->min_mem_length;
     const unsigned char* concat_data = ptr->concat_data;
-    const std::vector<uint_t> joined_sequence_bound = ptr->joined_sequence_bound;
+    const std::vector<uint_t>& joined_sequence_bound = *(ptr->joined_sequence_bound);
+    MemTable<Index>& result = *(ptr->result_store);
+    const uint_t mem_index = ptr->mem_index;
     // Initialize the result variables
-    std::pair<uint_t, uint_t> interval = ptr->interval;
-    mem result;
-    uint_t* mem_index = new uint_t;
-    *mem_index = 0;
-    result.mem_index = mem_index;
-    std::vector<sub_string> res_substrings;
-    result.mem_length = 0;
-    std::vector<uint_t> mem_position;
-    // Create the MEM from the input LCP interval
-    for (uint_t i = interval.first - 1; i < interval.second; i++) {
-        sub_string tmp_substring;
-        tmp_substring.sequence_index = DA[i];
-        tmp_substring.position = SA[i] - joined_sequence_bound[tmp_substring.sequence_index];
-        mem_position.push_back(SA[i]);
-        
-        tmp_substring.mem_index = mem_index;
-        result.substrings.push_back(tmp_substring);
+    std::pair<Index, Index> interval = ptr->interval;
+    const uint_t occurrence_begin = result.offset[mem_index];
+    const uint_t occurrence_num = result.occurrence_num(mem_index);
+    // the text positions of the occurrences
+    const Index* mem_position = SA + interval.first - 1;
+
+    // The MEM extends to the left as long as the characters before all occurrences agree and no occurrence
+    // reaches the start of the text: the shortest common suffix between the first and every other occurrence
+    uint_t offset = mem_position[0];
+    for (uint_t k = 1; k < occurrence_num; k++) {
+        offset = std::min<uint_t>(offset, mem_position[k]);
+    }
+    for (uint_t k = 1; k < occurrence_num && offset > 0; k++) {
+        offset = common_suffix_length(concat_data, mem_position[0], mem_position[k], offset);
     }
-    // Compute the offset of the MEM and adjust the positions of the substrings accordingly
-    // Set an initial offset value of 1 and a flag indicating whether all characters are the same
-    uint_t offset = 1;
-    bool all_char_same = true;
 
-    // While loop to iterate through the offset values until a non-matching character is found or the end of the string is reached
-    while (true) {
-        // Get the current character by looking back from the first MEM position by the current offset
-        char current_char = 0;
-        if (mem_position[0] >= offset) {
-            current_char = concat_data[mem_position[0] - offset];
+    // Create the MEM from the input LCP interval
+    for (uint_t k = 0; k < occurrence_num; k++) {
+        uint_t i = interval.first - 1 + k;
+        int_t sequence_index;
+        if (DA) {
+            sequence_index = DA[i];
         }
         else {
-            break;
+            sequence_index = std::upper_bound(joined_sequence_bound.begin(), joined_sequence_bound.end(), SA[i]) - joined_sequence_bound.begin() - 1;
         }
+        result.sequence_index[occurrence_begin + k] = sequence_index;
+        result.position[occurrence_begin + k] = SA[i] - joined_sequence_bound[sequence_index] - offset;
+    }
+
+    int_t mem_length = min_mem_length + offset;
+    // std::count over bytes is vectorized by the compiler
+    const unsigned char* mem_begin = concat_data + mem_position[0] - offset;
+    uint_t gap_count = std::count(mem_begin, mem_begin + mem_length, (unsigned char)'-');
+    if (gap_count > ceil(0.8 * mem_length)) {
+        mem_length = -1;
+    }
+    // Store the result in the input parameters structure
+    result.mem_length[mem_index] = mem_length;
+  
+    return NULL;
+}
 
-        // Check if all characters at the current offset are the same
-        all_char_same = true;
-        for (uint_t i = 1; i < mem_position.size(); i++) {
-            // If the current MEM position is before the current offset, set the flag to false and break
-            if (mem_position[i] < offset) {
-                all_char_same = false;
+// Collect the LCP intervals whose run starts in [begin, end), a run that crosses end is followed to its end.
+// classify(i) tells whether LCP[i] is below, equal to or above the minimal MEM length.
+template <typename Index, typename Classify>
+static void scan_lcp_chunk(Index begin, Index end, Index n, int_t min_cross_sequence, Classify classify,
+    std::vector<std::pair<Index, Index>>& intervals) {
+    Index i = begin;
+    // the run that covers begin was started, and is collected, by the chunk before
+    if (i > 0 && classify(i - 1) != LCP_BELOW) {
+        while (i < end && classify(i) != LCP_BELOW) {
+            i++;
+        }
+    }
+    while (i < end) {
+        if (classify(i) == LCP_BELOW) {
+            i++;
+            continue;
+        }
+        Index left = i;
+        bool found = false;
+        for (; i < n; i++) {
+            unsigned char flag = classify(i);
+            if (flag == LCP_BELOW) {
                 break;
             }
-            // Otherwise, compare the character at the current MEM position to the current character and set the flag accordingly
-            else {
-                if (current_char != concat_data[mem_position[i] - offset]) {
-                    all_char_same = false;
-                    break;
-                }
-            }
+            found |= flag == LCP_EQUAL;
         }
-
-        // If all characters at the current offset are the same, increment the offset and continue
-        if (all_char_same == false) {
-            break;
+        if (found && (int_t)(i - left + 1) >= min_cross_sequence) {
+            intervals.emplace_back(left, i);
         }
-        offset++;
     }
+}
 
-    // Decrement the offset by 1 to get the last offset where all characters were the same
-    offset -= 1;
-
-
-    result.mem_length = min_mem_length + offset;
-    for (uint_t i = 0; i < result.substrings.size(); i++) {
-        result.substrings[i].position -= offset;
-    }
-    uint_t gap_count = 0;
-    for (int_t i = 0; i < result.mem_length; i++) {
-        uint_t tmp_pos = result.substrings[0].position + i + joined_sequence_bound[result.substrings[0].sequence_index];
-        if (concat_data[tmp_pos] == '-') {
-            gap_count++;
+/**
+ * @brief Find the LCP intervals and convert them to MEMs in one parallel pass.
+ * The LCP array is cut into chunks, each chunk collects the intervals that start in it and, once the rows
+ * of all chunks are placed, converts them into its rows of the table. The MEMs come out in the order of
+ * get_lcp_intervals(), only one interval per MEM is kept on the side.
+ * @param SA The suffix array
+ * @param DA The document array, NULL in lean mode
+ * @param LCP The LCP array, NULL in lean mode, the LCP is then compared to min_mem_length on the fly
+ * @param concat_data The concatenated sequences
+ * @param n The length of the concatenated sequences
+ * @param min_mem_length The minimal MEM length
+ * @param min_cross_sequence the min number of crossed sequence
+ * @param joined_sequence_bound The begin position of every sequence in concat_data
+ * @param mems Receives the MEMs
+*/
+template <typename Index>
+void lcp_intervals_to_mems(const Index* SA, const int32_t* DA, const IndexInt<Index>* LCP, const unsigned char* concat_data, Index n,
+    int_t min_mem_length, int_t min_cross_sequence, const std::vector<uint_t>& joined_sequence_bound, MemTable<Index>& mems) {
+    // a few chunks per thread balance dense and sparse regions of the suffix array
+    const uint_t min_chunk = 1 << 16;
+    uint_t chunk_num = std::max<uint_t>(1, std::min<uint_t>((uint_t)Scheduler::instance().threads() * 4, n / min_chunk));
+    uint_t chunk_size = (n + chunk_num - 1) / chunk_num;
+    std::vector<std::vector<std::pair<Index, Index>>> intervals(chunk_num);
+    const uint_t limit = min_mem_length < 0 ? 0 : (uint_t)min_mem_length;
+    parallel_for(0, chunk_num, 1, [&](uint_t c) {
+        Index begin = std::min<uint_t>((uint_t)c * chunk_size, n);
+        Index end = std::min<uint_t>((uint_t)begin + chunk_size, n);
+        if (LCP) {
+            scan_lcp_chunk<Index>(begin, end, n, min_cross_sequence, [&](Index i) -> unsigned char {
+                return LCP[i] < min_mem_length ? LCP_BELOW : (LCP[i] == min_mem_length ? LCP_EQUAL : LCP_ABOVE);
+            }, intervals[c]);
+        }
+        else {
+            scan_lcp_chunk<Index>(begin, end, n, min_cross_sequence, [&](Index i) {
+                return threshold_lcp_value(concat_data, SA, i, limit);
+            }, intervals[c]);
+        }
+    });
+
+    // The interval [first, second) covers the suffixes SA[first-1..second-1], one occurrence each
+    std::vector<uint_t> row_begin(chunk_num + 1, 0);
+    for (uint_t c = 0; c < chunk_num; c++) {
+        row_begin[c + 1] = row_begin[c] + intervals[c].size();
+    }
+    const uint_t mem_num = row_begin[chunk_num];
+    mems = MemTable<Index>();
+    mems.offset.resize(mem_num + 1);
+    mems.offset[0] = 0;
+    for (uint_t c = 0, row = 0; c < chunk_num; c++) {
+        for (const std::pair<Index, Index>& interval : intervals[c]) {
+            mems.offset[row + 1] = mems.offset[row] + interval.second - interval.first + 1;
+            row++;
         }
     }
-    if (gap_count > ceil(0.8 * result.mem_length)) {
-        result.mem_length = -1;
-    }
-    // Store the result in the input parameters structure
-    *(ptr->result_store) = result;
-  
-    return NULL;
+    mems.sequence_index.resize(mems.offset[mem_num]);
+    mems.position.resize(mems.offset[mem_num]);
+    mems.mem_length.resize(mem_num);
+    mems.avg_pos.assign(mem_num, -1);
+    // every chunk fills its own rows
+    parallel_for(0, chunk_num, 1, [&](uint_t c) {
+        IntervalToMemConversionParams<Index> params;
+        params.SA = SA;
+        params.DA = DA;
+        params.concat_data = concat_data;
+        params.result_store = &mems;
+        params.min_mem_length = min_mem_length;
+        params.joined_sequence_bound = &joined_sequence_bound;
+        for (uint_t k = 0; k < intervals[c].size(); k++) {
+            params.interval = intervals[c][k];
+            params.mem_index = row_begin[c] + k;
+            interval2mem<Index>(&params);
+        }
+    });
 }
 
-// function to compute average position of a mem in sequences
-void compute_mem_avg_pos(mem& m) {
-    float_t sum_pos = 0;
-    for (auto& s : m.substrings) {
-        sum_pos += s.position;
-    }
-    m.avg_pos = sum_pos / m.substrings.size();
+/**
+* @brief Keep the MEMs listed in rows and reorder the table to follow them.
+* @param mems The MEM table.
+* @param rows The rows to keep, in their new order.
+*/
+template <typename Index>
+void select_mem_rows(MemTable<Index>& mems, const std::vector<uint_t>& rows) {
+    MemTable<Index> selected;
+    selected.offset.resize(rows.size() + 1);
+    selected.offset[0] = 0;
+    selected.mem_length.resize(rows.size());
+    selected.avg_pos.resize(rows.size());
+    for (uint_t i = 0; i < rows.size(); i++) {
+        selected.offset[i + 1] = selected.offset[i] + mems.occurrence_num(rows[i]);
+        selected.mem_length[i] = mems.mem_length[rows[i]];
+        selected.avg_pos[i] = mems.avg_pos[rows[i]];
+    }
+    selected.sequence_index.resize(selected.offset[rows.size()]);
+    selected.position.resize(selected.offset[rows.size()]);
+    for (uint_t i = 0; i < rows.size(); i++) {
+        std::copy(mems.sequence_index.begin() + mems.offset[rows[i]], mems.sequence_index.begin() + mems.offset[rows[i] + 1],
+            selected.sequence_index.begin() + selected.offset[i]);
+        std::copy(mems.position.begin() + mems.offset[rows[i]], mems.position.begin() + mems.offset[rows[i] + 1],
+            selected.position.begin() + selected.offset[i]);
+    }
+    mems = std::move(selected);
 }
 
 /**
 *Sorts the input vector of MEMs by the average position of each MEM's substrings along the sequences.
 *Removes any MEMs that span across multiple sequences.
-*Assigns a unique index to each MEM based on its position in the sorted vector.
-*@param mems The vector of MEMs to be sorted.
-*@param data The vector of sequences used to compute the MEMs.
+*The index of a MEM is its row in the sorted table.
+*@param mems The table of MEMs to be sorted.
+*@param data The sequences used to compute the MEMs.
 */
-void sort_mem(std::vector<mem> &mems, std::vector<std::string> data) {
-    
-    auto it = std::remove_if(mems.begin(), mems.end(), [&](const mem& m) {
-        if (m.substrings[0].position + m.mem_length < data[m.substrings[0].sequence_index].length()) {
-            return false;
-        }
-        else {
-            return true;
+template <typename Index>
+void sort_mem(MemTable<Index> &mems, const SequenceStore& data) {
+    std::vector<uint_t> rows;
+    rows.reserve(mems.size());
+    for (uint_t i = 0; i < mems.size(); i++) {
+        const uint_t first = mems.offset[i];
+        if (mems.position[first] + mems.mem_length[i] < data[mems.sequence_index[first]].length()) {
+            rows.push_back(i);
         }
-       
-        });
-    mems.erase(it, mems.end());
+    }
 
     // compute average position of each mem
-    for (auto& m : mems) {
-        compute_mem_avg_pos(m);
+    for (uint_t i : rows) {
+        float_t sum_pos = 0;
+        for (uint_t j = mems.offset[i]; j < mems.offset[i + 1]; j++) {
+            sum_pos += mems.position[j];
+        }
+        mems.avg_pos[i] = sum_pos / mems.occurrence_num(i);
     }
-    // sort mems by average position
-    std::sort(mems.begin(), mems.end(), [](const mem& m1, const mem& m2) {
-        return m1.avg_pos < m2.avg_pos;
+    // sort mems by average position; std::sort on the rows does the same steps as on the MEMs themselves
+    std::sort(rows.begin(), rows.end(), [&mems](uint_t m1, uint_t m2) {
+        return mems.avg_pos[m1] < mems.avg_pos[m2];
         });
-    // assign mem_index based on position in sorted vector
-    for (uint_t i = 0; i < mems.size(); i++) {
-        *mems[i].mem_index = i;
-    }
+    select_mem_rows(mems, rows);
     return;
 }
 
-
+// The index widths find_mem() dispatches to, see suffix_index.h
+#define INSTANTIATE_MEM_FINDER(Index) \
+    template std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_accurate<Index>(MemTable<Index>&, uint_t); \
+    template std::vector<std::vector<std::pair<int_t, int_t>>> filter_mem_fast<Index>(MemTable<Index>&, uint_t); \
+    template std::vector<std::pair<Index, Index>> get_lcp_intervals<Index>(const IndexInt<Index>*, int_t, int_t, Index); \
+    template std::vector<std::pair<Index, Index>> get_lcp_intervals<Index>(const unsigned char*, int_t, Index); \
+    template unsigned char* threshold_lcp<Index>(const unsigned char*, const Index*, Index, int_t); \
+    template void* interval2mem<Index>(void*); \
+    template void lcp_intervals_to_mems<Index>(const Index*, const int32_t*, const IndexInt<Index>*, const unsigned char*, Index, \
+        int_t, int_t, const std::vector<uint_t>&, MemTable<Index>&); \
+    template void select_mem_rows<Index>(MemTable<Index>&, const std::vector<uint_t>&); \
+    template void sort_mem<Index>(MemTable<Index>&, const SequenceStore&);
+
+INSTANTIATE_MEM_FINDER(uint32_t)
+INSTANTIATE_MEM_FINDER(uint64_t)
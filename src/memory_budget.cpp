@@ -0,0 +1,221 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/memory_budget.h"
+#include "../include/parallel_sa.h"
+#include "../include/suffix_index.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+MemoryBudget& MemoryBudget::instance() {
+    static MemoryBudget budget;
+    return budget;
+}
+
+/**
+* @brief Set the budget.
+* @param bytes The most memory the run and its backend jobs may use together, 0 for no limit.
+*/
+void MemoryBudget::set_limit(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    limit_ = bytes;
+}
+
+/**
+* @brief Reserve memory for a job if it fits into the budget.
+* A job always fits when nothing is reserved, so that the run can go on below any budget.
+* @param bytes The predicted memory of the job.
+* @return True if the memory is reserved, it must be given back with release().
+*/
+bool MemoryBudget::try_reserve(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (limit_ > 0 && reserved_ > 0 && process_rss() + reserved_ + bytes > limit_) {
+        return false;
+    }
+    reserved_ += bytes;
+    return true;
+}
+
+/**
+* @brief Reserve memory for work in this process, waiting until it fits into the budget.
+* The memory counts twice once it is allocated, in the resident set and in the reservation, so the work starts
+* early enough and the reservation should be short-lived. It fits when nothing is reserved, as in try_reserve().
+* @param bytes The memory the work allocates.
+*/
+void MemoryBudget::reserve(uint64_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (limit_ > 0 && reserved_ > 0 && process_rss() + reserved_ + bytes > limit_) {
+        // the resident set also shrinks without a release, so it is looked at again now and then
+        released_.wait_for(lock, std::chrono::milliseconds(50));
+    }
+    reserved_ += bytes;
+}
+
+// Give back memory reserved with try_reserve() or reserve().
+void MemoryBudget::release(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    reserved_ -= std::min(bytes, reserved_);
+    released_.notify_all();
+}
+
+// True if the resident set of the process exceeds the budget; the reservations of the backend jobs
+// are not counted, the memory of other processes cannot be freed by spilling.
+bool MemoryBudget::exceeded() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return limit_ > 0 && process_rss() > limit_;
+}
+
+// Memory that is left of the budget, 0 if it is exceeded or there is no budget.
+uint64_t MemoryBudget::available() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t used = process_rss() + reserved_;
+    return limit_ > used ? limit_ - used : 0;
+}
+
+/**
+* @brief Parse a memory size such as 1048576, 512M, 16G or 1.5T; K, M, G and T are powers of 1024.
+* @param text The size, a plain number is in bytes.
+* @param bytes Receives the size in bytes.
+* @return False if the text is not a size.
+*/
+bool parse_memory_size(const std::string& text, uint64_t& bytes) {
+    size_t end = 0;
+    double value;
+    try {
+        value = std::stod(text, &end);
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    if (value < 0) {
+        return false;
+    }
+    std::string unit = text.substr(end);
+    if (unit.size() == 2 && (unit[1] == 'B' || unit[1] == 'b')) {
+        unit.pop_back();
+    }
+    const std::string units = "KMGT";
+    double scale = 1;
+    if (unit.size() == 1) {
+        size_t k = units.find((char)toupper(unit[0]));
+        if (k == std::string::npos) {
+            return false;
+        }
+        scale = (double)(1ULL << (10 * (k + 1)));
+    }
+    else if (!unit.empty()) {
+        return false;
+    }
+    bytes = (uint64_t)(value * scale);
+    return true;
+}
+
+// The size in MiB, GiB or TiB for messages.
+std::string format_memory_size(uint64_t bytes) {
+    const char* unit[] = { "MiB", "GiB", "TiB" };
+    double value = bytes / (double)(1ULL << 20);
+    int k = 0;
+    while (value >= 1024 && k < 2) {
+        value /= 1024;
+        k++;
+    }
+    std::stringstream s;
+    s << std::fixed << std::setprecision(value < 10 ? 2 : 0) << value << " " << unit[k];
+    return s.str();
+}
+
+// The resident memory of the process in bytes, 0 where it is not available.
+uint64_t process_rss() {
+#if defined(__linux__)
+    // the second field of statm is the resident set in pages
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file) {
+        unsigned long long size = 0, resident = 0;
+        int read = fscanf(file, "%llu %llu", &size, &resident);
+        fclose(file);
+        if (read == 2) {
+            return resident * (uint64_t)sysconf(_SC_PAGESIZE);
+        }
+    }
+#endif
+#ifndef _WIN32
+    // elsewhere the peak resident set, which never underestimates the current one
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return usage.ru_maxrss;
+#else
+        return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+    }
+#endif
+    return 0;
+}
+
+/**
+* @brief Predict the memory of a suffix index built by find_mem().
+* @param n The length of the indexed text.
+* @param lean True for the lean index (SA and a one byte LCP), false for SA, LCP and DA.
+* @param threads The threads of the run; the full index of a long text is built by the parallel builder then.
+* @return The predicted peak memory in bytes.
+*/
+uint64_t estimate_index_memory(uint_t n, bool lean, int threads) {
+    // SA and LCP entries are 4 or 8 bytes, see use_index32()
+    const uint64_t entry = use_index32(n) ? sizeof(uint32_t) : sizeof(uint64_t);
+    if (lean) {
+        return (uint64_t)n * (entry + 1);
+    }
+    uint64_t memory = (uint64_t)n * (2 * entry + sizeof(int32_t));
+    // the parallel builder sorts with a rank array of its own, its key array is the LCP array
+    if (threads >= PARALLEL_SA_MIN_THREADS && n >= PARALLEL_SA_MIN_LENGTH) {
+        memory += (uint64_t)n * entry;
+    }
+    return memory;
+}
+
+/**
+* @brief Predict the peak memory of aligning a fragment, the backend process and the copies FMAlign2 keeps of it.
+* Fragments that are aligned in-process (see -small) only count the copies.
+* @param seq_num The number of sequences in the fragment.
+* @param total_length The sum of their lengths.
+* @param max_length The longest sequence.
+* @return The predicted memory in bytes.
+*/
+uint64_t estimate_msa_memory(uint_t seq_num, uint64_t total_length, uint_t max_length) {
+    if (seq_num == 0) {
+        return 0;
+    }
+    // FMAlign2 holds the FASTA, the backend output and the aligned rows, about three copies
+    uint64_t own = 3 * total_length + (uint64_t)seq_num * 64;
+    // single rows and fragments up to -small are aligned in-process
+    if (seq_num == 1 || total_length <= (uint64_t)current_args().small_fragment) {
+        return own;
+    }
+    uint64_t matrix = std::min<uint64_t>(MSA_JOB_MEMORY_PER_CELL * (uint64_t)max_length * max_length, MSA_JOB_MAX_DP_MEMORY);
+    uint64_t backend = MSA_JOB_BASE_MEMORY + MSA_JOB_MEMORY_PER_BASE * total_length + matrix;
+    return own + backend;
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+struct MetricsEvent {
+    const char* category;
+    std::string name;
+    int thread;
+    double start;
+    double end;
+    std::string args;
+};
+
+static const std::chrono::steady_clock::time_point program_start = std::chrono::steady_clock::now();
+static std::atomic<bool> enabled(false);
+static std::string json_file;
+static std::string trace_file;
+static std::mutex event_mutex;
+static std::vector<MetricsEvent> events;
+static std::atomic<int> next_thread(0);
+
+// Small ids in the order the threads record their first event, the main thread is usually 0.
+static int thread_id() {
+    static thread_local int id = next_thread++;
+    return id;
+}
+
+static std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        case '\r': out += "\\r"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char buffer[8];
+                snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                out += buffer;
+            }
+            else {
+                out += c;
+            }
+        }
+    }
+    return out + "\"";
+}
+
+static std::string json_number(double value) {
+    std::ostringstream s;
+    s << std::setprecision(9) << value;
+    return s.str();
+}
+
+// CPU seconds of the process, user and system, 0 where it is not available.
+static double process_cpu_seconds() {
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+    }
+#endif
+    return 0;
+}
+
+// Peak resident memory of the process in bytes, 0 where it is not available.
+static uint64_t peak_rss_bytes() {
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return usage.ru_maxrss;
+#else
+        return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+    }
+#endif
+    return 0;
+}
+
+void MetricsArgs::key(const char* key) {
+    if (!json_.empty()) {
+        json_ += ", ";
+    }
+    json_ += json_string(key) + ": ";
+}
+
+MetricsArgs& MetricsArgs::add(const char* key, double value) {
+    this->key(key);
+    json_ += json_number(value);
+    return *this;
+}
+
+MetricsArgs& MetricsArgs::add(const char* key, int64_t value) {
+    this->key(key);
+    json_ += std::to_string(value);
+    return *this;
+}
+
+MetricsArgs& MetricsArgs::add(const char* key, uint64_t value) {
+    this->key(key);
+    json_ += std::to_string(value);
+    return *this;
+}
+
+MetricsArgs& MetricsArgs::add(const char* key, const std::string& value) {
+    this->key(key);
+    json_ += json_string(value);
+    return *this;
+}
+
+MetricsPhase::MetricsPhase(const char* name)
+    : name_(name), start_(metrics_now()), cpu_start_(enabled ? process_cpu_seconds() : 0), ended_(false) {}
+
+/**
+* @brief Record the phase with its wall time, the CPU seconds of the process and the peak RSS.
+* Only the first call records.
+*/
+void MetricsPhase::end() {
+    if (ended_) {
+        return;
+    }
+    ended_ = true;
+    if (!enabled) {
+        return;
+    }
+    MetricsArgs args;
+    args.add("cpu_seconds", process_cpu_seconds() - cpu_start_).add("peak_rss_bytes", peak_rss_bytes());
+    metrics_event("phase", name_, start_, metrics_now(), args);
+}
+
+/**
+* @brief Enable the metrics.
+* @param json_path File for the JSON document, empty for none.
+* @param trace_path File for the Chrome trace events, empty for none.
+*/
+void metrics_start(const std::string& json_path, const std::string& trace_path) {
+    json_file = json_path;
+    trace_file = trace_path;
+    enabled = !json_file.empty() || !trace_file.empty();
+}
+
+// True if events are recorded.
+bool metrics_enabled() {
+    return enabled;
+}
+
+// Seconds since the program started.
+double metrics_now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - program_start).count();
+}
+
+/**
+* @brief Record an event; does nothing unless the metrics are enabled.
+* @param category The group of the event: "phase", "expand_chain", "parallel_align" or "msa_backend".
+* @param name The name shown in the trace.
+* @param start The start, from metrics_now().
+* @param end The end, from metrics_now().
+* @param args The named values of the event.
+*/
+void metrics_event(const char* category, const std::string& name, double start, double end, const MetricsArgs& args) {
+    if (!enabled) {
+        return;
+    }
+    MetricsEvent event{ category, name, thread_id(), start, end, args.json() };
+    std::lock_guard<std::mutex> lock(event_mutex);
+    events.push_back(std::move(event));
+}
+
+static bool write_json(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        return false;
+    }
+    out << "{\n  \"program\": \"FMAlign2\",\n  \"input\": " << json_string(global_args.data_path)
+        << ",\n  \"threads\": " << global_args.thread
+        << ",\n  \"wall_seconds\": " << json_number(metrics_now())
+        << ",\n  \"cpu_seconds\": " << json_number(process_cpu_seconds())
+        << ",\n  \"peak_rss_bytes\": " << peak_rss_bytes();
+    // one array per category, in the order the categories first appear
+    std::vector<std::string> category;
+    for (const MetricsEvent& e : events) {
+        if (std::find(category.begin(), category.end(), e.category) == category.end()) {
+            category.push_back(e.category);
+        }
+    }
+    for (const std::string& c : category) {
+        out << ",\n  " << json_string(c) << ": [";
+        bool first = true;
+        for (const MetricsEvent& e : events) {
+            if (c != e.category) {
+                continue;
+            }
+            out << (first ? "\n" : ",\n") << "    {\"name\": " << json_string(e.name) << ", \"thread\": " << e.thread
+                << ", \"start\": " << json_number(e.start) << ", \"seconds\": " << json_number(e.end - e.start);
+            if (!e.args.empty()) {
+                out << ", " << e.args;
+            }
+            out << "}";
+            first = false;
+        }
+        out << "\n  ]";
+    }
+    out << "\n}\n";
+    return out.good();
+}
+
+static bool write_trace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        return false;
+    }
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"FMAlign2\"}}";
+    for (const MetricsEvent& e : events) {
+        // complete events in microseconds
+        out << ",\n{\"name\": " << json_string(e.name) << ", \"cat\": " << json_string(e.category)
+            << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << e.thread
+            << ", \"ts\": " << json_number(e.start * 1e6) << ", \"dur\": " << json_number((e.end - e.start) * 1e6)
+            << ", \"args\": {" << e.args << "}}";
+    }
+    out << "\n]}\n";
+    return out.good();
+}
+
+/**
+* @brief Write the recorded events to the files given to metrics_start().
+* @return False if a file could not be written.
+*/
+bool metrics_finish() {
+    if (!enabled) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(event_mutex);
+    std::stable_sort(events.begin(), events.end(), [](const MetricsEvent& a, const MetricsEvent& b) {
+        return a.start < b.start;
+    });
+    bool ok = true;
+    if (!json_file.empty() && !write_json(json_file)) {
+        std::cerr << "Error writing metrics file " << json_file << std::endl;
+        ok = false;
+    }
+    if (!trace_file.empty() && !write_trace(trace_file)) {
+        std::cerr << "Error writing trace file " << trace_file << std::endl;
+        ok = false;
+    }
+    return ok;
+}
@@ -0,0 +1,340 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/msa_backend.h"
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <cerrno>
+#include <cstring>
+#ifndef _WIN32
+#include <spawn.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+extern char** environ;
+#endif
+
+namespace fs = std::filesystem;
+
+/**
+* @brief Check whether a command template should be run in stream mode.
+* A stream template contains neither {input} nor {output}; it reads FASTA from stdin and writes the alignment to stdout.
+* Stream mode is only available on POSIX systems, on Windows this always returns false.
+* @param cmdTemplate The MSA command template.
+* @return True if the template is run through pipes, otherwise false.
+*/
+bool is_stream_template(const std::string& cmdTemplate) {
+#ifdef _WIN32
+    return false;
+#else
+    return cmdTemplate.find("{input}") == std::string::npos && cmdTemplate.find("{output}") == std::string::npos;
+#endif
+}
+
+/**
+* @brief Split a command line into arguments, honouring single quotes, double quotes and backslash escapes.
+* @param cmd The command line to split.
+* @return The list of arguments.
+*/
+std::vector<std::string> split_command(const std::string& cmd) {
+    std::vector<std::string> args;
+    std::string cur;
+    bool in_token = false;
+    char quote = 0;
+    for (size_t i = 0; i < cmd.size(); i++) {
+        char c = cmd[i];
+        if (quote) {
+            if (c == quote) {
+                quote = 0;
+            }
+            else if (c == '\\' && quote == '"' && i + 1 < cmd.size()) {
+                cur += cmd[++i];
+            }
+            else {
+                cur += c;
+            }
+        }
+        else if (c == '\'' || c == '"') {
+            quote = c;
+            in_token = true;
+        }
+        else if (c == '\\' && i + 1 < cmd.size()) {
+            cur += cmd[++i];
+            in_token = true;
+        }
+        else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            if (in_token) {
+                args.push_back(cur);
+                cur.clear();
+                in_token = false;
+            }
+        }
+        else {
+            cur += c;
+            in_token = true;
+        }
+    }
+    if (in_token) {
+        args.push_back(cur);
+    }
+    return args;
+}
+
+#ifndef _WIN32
+// Pipes and the spawn itself are serialised, so that no child inherits a pipe end that belongs to
+// another task. An inherited write end would keep a sibling backend waiting for EOF on its stdin.
+static std::mutex spawn_mutex;
+
+// The pipe ends are closed on exec. On Linux they are created so, other children started by system()
+// or by the jobs of a daemon cannot inherit them in between; elsewhere only spawn_mutex protects them.
+static bool make_pipe(int fds[2]) {
+#if defined(__linux__)
+    return pipe2(fds, O_CLOEXEC) == 0;
+#else
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+}
+#endif
+
+/**
+* @brief Run a stream template: spawn the backend, feed it the FASTA through stdin and collect its stdout.
+* The {thread} placeholder is replaced by thread. If the command contains shell operators it is started
+* through /bin/sh -c, otherwise it is executed directly. The last MSA_STDERR_LIMIT bytes the backend
+* printed to stderr are kept and printed if it fails.
+* @param cmdTemplate The stream command template.
+* @param input The FASTA content sent to the backend.
+* @param output Receives everything the backend printed to stdout.
+* @param thread The number of threads passed to the backend.
+* @param spawn_seconds Receives the seconds until the backend was started, if not NULL.
+* @return The exit code of the backend, or -1 if it could not be started or was killed by a signal.
+*/
+int run_msa_stream(const std::string& cmdTemplate, const std::string& input, std::string& output, int thread,
+    double* spawn_seconds) {
+    output.clear();
+#ifdef _WIN32
+    std::cerr << "Error: stream MSA templates are not supported on Windows" << std::endl;
+    return -1;
+#else
+    std::string cmd = cmdTemplate;
+    size_t pos = 0;
+    const std::string thread_str = std::to_string(thread);
+    while ((pos = cmd.find("{thread}", pos)) != std::string::npos) {
+        cmd.replace(pos, 8, thread_str);
+        pos += thread_str.size();
+    }
+
+    std::vector<std::string> args;
+    if (cmd.find_first_of("|&;<>$`") != std::string::npos) {
+        args = { "/bin/sh", "-c", cmd };
+    }
+    else {
+        args = split_command(cmd);
+    }
+    if (args.empty()) {
+        std::cerr << "Error: -p command template is empty" << std::endl;
+        return -1;
+    }
+    std::vector<char*> argv;
+    for (auto& a : args) {
+        argv.push_back(const_cast<char*>(a.c_str()));
+    }
+    argv.push_back(NULL);
+
+    // A backend that exits before reading all of its input must not kill FMAlign2 with SIGPIPE.
+    static std::once_flag sigpipe_flag;
+    std::call_once(sigpipe_flag, []() { signal(SIGPIPE, SIG_IGN); });
+
+    int in_pipe[2], out_pipe[2], err_pipe[2];
+    pid_t pid;
+    // the wait for the spawn lock is part of the start-up cost
+    auto spawn_start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(spawn_mutex);
+        if (!make_pipe(in_pipe)) {
+            return -1;
+        }
+        if (!make_pipe(out_pipe)) {
+            close(in_pipe[0]); close(in_pipe[1]);
+            return -1;
+        }
+        if (!make_pipe(err_pipe)) {
+            close(in_pipe[0]); close(in_pipe[1]);
+            close(out_pipe[0]); close(out_pipe[1]);
+            return -1;
+        }
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, in_pipe[0], STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, err_pipe[1], STDERR_FILENO);
+        int rc = posix_spawnp(&pid, argv[0], &actions, NULL, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        close(in_pipe[0]);
+        close(out_pipe[1]);
+        close(err_pipe[1]);
+        if (rc != 0) {
+            close(in_pipe[1]);
+            close(out_pipe[0]);
+            close(err_pipe[0]);
+            std::cerr << "Error: fail to start " << argv[0] << ": " << strerror(rc) << std::endl;
+            return -1;
+        }
+    }
+    if (spawn_seconds) {
+        *spawn_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - spawn_start).count();
+    }
+
+    // Write stdin and drain stdout and stderr at the same time, otherwise a backend that
+    // starts printing before it has read all its input would deadlock with us.
+    fcntl(in_pipe[1], F_SETFL, fcntl(in_pipe[1], F_GETFL) | O_NONBLOCK);
+    size_t written = 0;
+    int in_fd = in_pipe[1];
+    int out_fd = out_pipe[0];
+    int err_fd = err_pipe[0];
+    if (input.empty()) {
+        close(in_fd);
+        in_fd = -1;
+    }
+    // the diagnostics of a failing backend come last, so the tail of stderr is kept
+    std::string err_tail;
+    char buffer[1 << 16];
+    while (out_fd >= 0 || err_fd >= 0) {
+        struct pollfd fds[3];
+        nfds_t nfds = 0;
+        int out_slot = -1, err_slot = -1, in_slot = -1;
+        if (out_fd >= 0) {
+            out_slot = nfds;
+            fds[nfds].fd = out_fd; fds[nfds].events = POLLIN; fds[nfds].revents = 0; nfds++;
+        }
+        if (err_fd >= 0) {
+            err_slot = nfds;
+            fds[nfds].fd = err_fd; fds[nfds].events = POLLIN; fds[nfds].revents = 0; nfds++;
+        }
+        if (in_fd >= 0) {
+            in_slot = nfds;
+            fds[nfds].fd = in_fd; fds[nfds].events = POLLOUT; fds[nfds].revents = 0; nfds++;
+        }
+        if (poll(fds, nfds, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (in_slot >= 0 && fds[in_slot].revents) {
+            ssize_t w = write(in_fd, input.data() + written, input.size() - written);
+            if (w > 0) {
+                written += w;
+            }
+            if ((w < 0 && errno != EAGAIN && errno != EINTR) || written == input.size()) {
+                close(in_fd);
+                in_fd = -1;
+            }
+        }
+        if (out_slot >= 0 && fds[out_slot].revents) {
+            ssize_t r = read(out_fd, buffer, sizeof(buffer));
+            if (r > 0) {
+                output.append(buffer, r);
+            }
+            else if (r == 0 || (errno != EAGAIN && errno != EINTR)) {
+                close(out_fd);
+                out_fd = -1;
+            }
+        }
+        if (err_slot >= 0 && fds[err_slot].revents) {
+            ssize_t r = read(err_fd, buffer, sizeof(buffer));
+            if (r > 0) {
+                err_tail.append(buffer, r);
+                if (err_tail.size() > 2 * MSA_STDERR_LIMIT) {
+                    err_tail.erase(0, err_tail.size() - MSA_STDERR_LIMIT);
+                }
+            }
+            else if (r == 0 || (errno != EAGAIN && errno != EINTR)) {
+                close(err_fd);
+                err_fd = -1;
+            }
+        }
+    }
+    if (in_fd >= 0) {
+        close(in_fd);
+    }
+    for (int fd : { out_fd, err_fd }) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    if (err_tail.size() > MSA_STDERR_LIMIT) {
+        err_tail.erase(0, err_tail.size() - MSA_STDERR_LIMIT);
+    }
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    int code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    if (code != 0 && !err_tail.empty()) {
+        std::cerr << "Error: " << argv[0] << " failed, the end of its error output:" << std::endl << err_tail;
+        if (err_tail.back() != '\n') {
+            std::cerr << std::endl;
+        }
+    }
+    return code;
+#endif
+}
+
+/**
+* @brief Resolve the folder used for temporary fragment files.
+* "auto" selects /dev/shm when it is a writable directory and falls back to ./temp/ otherwise.
+* The folder is created if it does not exist yet and the returned path always ends with '/'.
+* @param tmp_folder The folder requested on the command line, or "auto".
+* @return The folder path with a trailing separator.
+*/
+std::string resolve_tmp_folder(const std::string& tmp_folder) {
+    std::string folder = tmp_folder;
+    if (folder == "auto") {
+        folder = "./temp/";
+#if (defined(__linux__))
+        std::error_code ec;
+        if (fs::is_directory("/dev/shm", ec) && access("/dev/shm", W_OK) == 0) {
+            folder = "/dev/shm/";
+        }
+#endif
+    }
+    if (folder.empty()) {
+        folder = "./";
+    }
+    if (folder.back() != '/' && folder.back() != '\\') {
+        folder += '/';
+    }
+    std::error_code ec;
+    fs::create_directories(folder, ec);
+    if (ec) {
+        std::cerr << "Fail to create file folder " << folder << ": " << ec.message() << std::endl;
+        exit(1);
+    }
+    return folder;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/msa_scheduler.h"
+#include "../include/utils.h"
+#include "../include/memory_budget.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+/**
+* @brief Predict the relative cost of aligning a fragment.
+* Progressive aligners spend about n log n length-weighted steps; the quadratic mean of the
+* lengths is used so that a few long sequences weigh more than many short ones.
+* @param range The (begin, length) of every sequence in the fragment, begin -1 if it is left out.
+* @param record Receives the sequence count, the length sum, the longest length, the prediction and the memory.
+* @return The predicted cost, also stored in record.predicted.
+*/
+double estimate_msa_cost(const std::vector<std::pair<int_t, int_t>>& range, MsaJobRecord& record) {
+    record.seq_num = 0;
+    record.total_length = 0;
+    record.max_length = 0;
+    double square_sum = 0;
+    for (const auto& r : range) {
+        if (r.first < 0) {
+            continue;
+        }
+        record.seq_num++;
+        record.total_length += r.second;
+        record.max_length = std::max<uint_t>(record.max_length, r.second);
+        square_sum += (double)r.second * r.second;
+    }
+    record.predicted = MSA_JOB_OVERHEAD;
+    if (record.seq_num > 0) {
+        double n = record.seq_num;
+        double rms_length = std::sqrt(square_sum / n);
+        record.predicted += n * std::log2(n + 1) * rms_length;
+    }
+    record.memory = estimate_msa_memory(record.seq_num, record.total_length, record.max_length);
+    return record.predicted;
+}
+
+bool MsaJobQueue::Job::operator<(const Job& other) const {
+    // ties go to the lower index, which keeps the start order reproducible
+    if (record.predicted != other.record.predicted) {
+        return record.predicted < other.record.predicted;
+    }
+    return record.task_index > other.record.task_index;
+}
+
+/**
+* @brief Create a queue that runs its jobs on group.
+* @param group The task group the jobs are run on.
+* @param threads The number of backend threads all running jobs may use together.
+* @param max_job_threads The most threads one job is given, 0 for no limit.
+* @param memory_budget True to start a job only while its memory fits into the -max_mem budget.
+*/
+MsaJobQueue::MsaJobQueue(TaskGroup& group, int threads, int max_job_threads, bool memory_budget)
+    : group_(group), total_threads_(std::max(1, threads)), free_threads_(std::max(1, threads)),
+    max_job_threads_(max_job_threads), memory_budget_(memory_budget && MemoryBudget::instance().enabled()), outstanding_cost_(0) {}
+
+/**
+* @brief Announce a job that is not ready yet, so that the jobs started before it leave threads for it.
+* @param predicted The expected cost of the job.
+*/
+void MsaJobQueue::expect(double predicted) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    outstanding_cost_ += predicted;
+}
+
+/**
+* @brief Add a ready job. It is started once it is the most expensive ready job and threads are free.
+* @param record The prediction of the job, see estimate_msa_cost().
+* @param run Runs the job with the given number of backend threads.
+* @param expected The cost announced for the job with expect(), 0 if it was not announced.
+*/
+void MsaJobQueue::push(const MsaJobRecord& record, std::function<void(int)> run, double expected) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_.push_back({ record, std::move(run) });
+    std::push_heap(ready_.begin(), ready_.end());
+    outstanding_cost_ += record.predicted - expected;
+    dispatch();
+}
+
+// Reserve the memory of a job in the budget, true if it may start.
+bool MsaJobQueue::admit(const Job& job) {
+    return !memory_budget_ || MemoryBudget::instance().try_reserve(job.record.memory);
+}
+
+// Start ready jobs while threads are free, the mutex must be held.
+void MsaJobQueue::dispatch() {
+    while (free_threads_ > 0 && !ready_.empty()) {
+        Job job;
+        if (admit(ready_.front())) {
+            std::pop_heap(ready_.begin(), ready_.end());
+            job = std::move(ready_.back());
+            ready_.pop_back();
+        }
+        else {
+            // the most expensive job that fits into the budget, the others wait until memory is given back
+            std::vector<size_t> order(ready_.size());
+            for (size_t k = 0; k < order.size(); k++) {
+                order[k] = k;
+            }
+            std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return ready_[b] < ready_[a]; });
+            size_t pick = ready_.size();
+            for (size_t k : order) {
+                if (ready_[k].record.memory < ready_.front().record.memory && admit(ready_[k])) {
+                    pick = k;
+                    break;
+                }
+            }
+            if (pick == ready_.size()) {
+                return;
+            }
+            job = std::move(ready_[pick]);
+            ready_[pick] = std::move(ready_.back());
+            ready_.pop_back();
+            std::make_heap(ready_.begin(), ready_.end());
+        }
+        // the share of the job in the work that is left, at least one thread
+        int share = (int)std::lround(total_threads_ * job.record.predicted / std::max(outstanding_cost_, 1.0));
+        share = std::max(1, std::min(share, free_threads_));
+        share = std::min<int>(share, std::max<uint_t>(1, job.record.seq_num));
+        if (max_job_threads_ > 0) {
+            share = std::min(share, max_job_threads_);
+        }
+        free_threads_ -= share;
+        job.record.threads = share;
+        group_.run([this, job]() {
+            Timer timer;
+            try {
+                job.run(job.record.threads);
+            }
+            catch (...) {
+                // give the threads and memory back before the group reports the failure
+                finish(job.record);
+                throw;
+            }
+            MsaJobRecord record = job.record;
+            record.seconds = timer.elapsed_time();
+            finish(record);
+        });
+    }
+}
+
+void MsaJobQueue::finish(const MsaJobRecord& record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (memory_budget_) {
+        MemoryBudget::instance().release(record.memory);
+    }
+    free_threads_ += record.threads;
+    outstanding_cost_ -= record.predicted;
+    records_.push_back(record);
+    dispatch();
+}
+
+/**
+* @brief Print a summary of the cost model and optionally write every job to a file.
+* Must be called after all jobs are finished.
+* @param log_path Tab separated output with one line per job, nothing is written if empty.
+*/
+void MsaJobQueue::report(const std::string& log_path) const {
+    if (!log_path.empty()) {
+        std::ofstream out(log_path);
+        if (!out.is_open()) {
+            std::cerr << log_path << " fail to open!" << std::endl;
+        }
+        else {
+            out << "task\tsequences\ttotal_length\tmax_length\tthreads\tpredicted\tseconds\n";
+            for (const MsaJobRecord& r : records_) {
+                out << r.task_index << '\t' << r.seq_num << '\t' << r.total_length << '\t' << r.max_length << '\t'
+                    << r.threads << '\t' << std::fixed << std::setprecision(0) << r.predicted << '\t'
+                    << std::setprecision(4) << r.seconds << '\n';
+            }
+        }
+    }
+    if (!current_args().verbose || records_.empty()) {
+        return;
+    }
+    // Pearson correlation of predicted cost and thread seconds, and the seconds per cost unit
+    double n = records_.size(), sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+    for (const MsaJobRecord& r : records_) {
+        double x = r.predicted, y = r.seconds * r.threads;
+        sx += x; sy += y; sxx += x * x; syy += y * y; sxy += x * y;
+    }
+    double var_x = n * sxx - sx * sx, var_y = n * syy - sy * sy;
+    double correlation = (var_x > 0 && var_y > 0) ? (n * sxy - sx * sy) / std::sqrt(var_x * var_y) : 0;
+    std::stringstream s;
+    s << "MSA cost model: " << records_.size() << " jobs, r = " << std::fixed << std::setprecision(2) << correlation;
+    print_table_line(s.str());
+    s.str("");
+    s << "MSA seconds per cost unit: " << std::scientific << std::setprecision(2) << (sx > 0 ? sy / sx : 0);
+    print_table_line(s.str());
+}
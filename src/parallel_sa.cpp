@@ -0,0 +1,328 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/parallel_sa.h"
+#include "../include/scheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <utility>
+
+// Number of bucket counters per thread used by the initial counting sort.
+#define PSA_MAX_BUCKETS (1u << 16)
+
+// Run fn(chunk_id, begin, end) on threads contiguous chunks of [0, n).
+template <typename Index, typename F>
+static void parallel_chunks(int threads, Index n, F fn) {
+    Index chunk = (n + threads - 1) / threads;
+    parallel_for(0, threads, 1, [&](uint_t t) {
+        Index begin = t * chunk;
+        Index end = std::min<Index>(n, begin + chunk);
+        if (begin < end) {
+            fn((int)t, begin, end);
+        }
+    });
+}
+
+// Run fn(chunk_id, item) for every item in [0, count) on threads chunks, handing items out dynamically.
+// The chunk id is unique among the calls running at the same time, so it can select a buffer.
+template <typename F>
+static void parallel_items(int threads, size_t count, F fn) {
+    std::atomic<size_t> next(0);
+    parallel_for(0, threads, 1, [&](uint_t t) {
+        size_t item;
+        while ((item = next.fetch_add(1)) < count) {
+            fn((int)t, item);
+        }
+    });
+}
+
+template <typename Index>
+struct SuffixGroup {
+    Index begin;
+    Index end;
+};
+
+/**
+ * @brief Computes the suffix array SA (LCP, DA) of T^cat in s[0..n-1] with several threads.
+ * Suffixes are first bucketed by their leading characters with a parallel counting sort,
+ * then the buckets are refined by prefix doubling, sorting independent groups in parallel.
+ * The LCP array is computed by a chunked Phi/PLCP pass and DA by a binary search over the separators.
+ * @param s       input concatenated string, using separators s[i]=1 and with s[n-1]=0
+ * @param SA      suffix array
+ * @param LCP     LCP array, may be NULL
+ * @param DA      document array, may be NULL
+ * @param n       string length
+ * @param threads number of threads
+ * @return 0 on success, -1 if the input is not supported (the caller should use gsacak instead).
+ * Instantiated for 32 and 64 bit indexes.
+ */
+template <typename Index>
+int parallel_gsa(const unsigned char* s, Index* SA, IndexInt<Index>* LCP, int32_t* DA, Index n, int threads) {
+    if (n < 2 || s[n - 1] != 0 || threads < 1) {
+        return -1;
+    }
+
+    // Collect the alphabet and the separator positions.
+    std::vector<std::vector<Index>> local_hist(threads, std::vector<Index>(256, 0));
+    std::vector<std::vector<Index>> local_sep(threads);
+    parallel_chunks(threads, n - 1, [&](int t, Index begin, Index end) {
+        for (Index i = begin; i < end; i++) {
+            local_hist[t][s[i]]++;
+            if (s[i] == 1) {
+                local_sep[t].push_back(i);
+            }
+        }
+    });
+    Index hist[256] = { 0 };
+    for (int t = 0; t < threads; t++) {
+        for (int c = 0; c < 256; c++) {
+            hist[c] += local_hist[t][c];
+        }
+    }
+    // the terminator must be unique and every sequence must be non-empty
+    if (hist[0] != 0 || hist[1] == 0) {
+        return -1;
+    }
+    std::vector<Index> separators;
+    for (int t = 0; t < threads; t++) {
+        separators.insert(separators.end(), local_sep[t].begin(), local_sep[t].end());
+    }
+    local_sep.clear();
+    if (separators[0] == 0) {
+        return -1;
+    }
+    for (size_t i = 1; i < separators.size(); i++) {
+        if (separators[i] == separators[i - 1] + 1) {
+            return -1;
+        }
+    }
+
+    // Map the bytes to a compact code that keeps their order: 0 -> 0, 1 -> 1, letters -> 2..
+    uint32_t code[256] = { 0 };
+    uint32_t sigma = 1;
+    for (int c = 1; c < 256; c++) {
+        if (hist[c]) {
+            code[c] = sigma++;
+        }
+    }
+    // Bucket by the first prefix_len characters, as many as fit into PSA_MAX_BUCKETS counters.
+    Index prefix_len = 1;
+    uint64_t bucket_num = sigma;
+    while (bucket_num * sigma <= PSA_MAX_BUCKETS) {
+        bucket_num *= sigma;
+        prefix_len++;
+    }
+    // Characters after a separator are padded with 0, so that the code of every prefix
+    // containing a separator ends there; those suffixes are unique and keep their text order.
+    auto bucket_of = [&](Index i, bool& has_sep) {
+        uint64_t id = 0;
+        has_sep = false;
+        for (Index j = 0; j < prefix_len; j++) {
+            uint32_t c = has_sep ? 0 : code[s[i + j]];
+            if (c <= 1) {
+                has_sep = true;
+            }
+            id = id * sigma + c;
+        }
+        return (uint32_t)id;
+    };
+
+    // Stable parallel counting sort of all suffixes by their bucket.
+    std::vector<std::vector<Index>> count(threads, std::vector<Index>(bucket_num, 0));
+    parallel_chunks(threads, n, [&](int t, Index begin, Index end) {
+        bool has_sep;
+        for (Index i = begin; i < end; i++) {
+            count[t][bucket_of(i, has_sep)]++;
+        }
+    });
+    std::vector<Index> bucket_start(bucket_num + 1, 0);
+    {
+        Index sum = 0;
+        for (uint64_t b = 0; b < bucket_num; b++) {
+            bucket_start[b] = sum;
+            for (int t = 0; t < threads; t++) {
+                Index c = count[t][b];
+                count[t][b] = sum;
+                sum += c;
+            }
+        }
+        bucket_start[bucket_num] = sum;
+    }
+    parallel_chunks(threads, n, [&](int t, Index begin, Index end) {
+        bool has_sep;
+        for (Index i = begin; i < end; i++) {
+            SA[count[t][bucket_of(i, has_sep)]++] = i;
+        }
+    });
+    count.clear();
+
+    Index* rank = (Index*)malloc((size_t)n * sizeof(Index));
+    Index* key = LCP ? (Index*)LCP : (Index*)malloc((size_t)n * sizeof(Index));
+    if (!rank || !key) {
+        free(rank);
+        if (!LCP) free(key);
+        return -1;
+    }
+
+    // The rank of a suffix is the first SA index of its group.
+    std::vector<std::vector<SuffixGroup<Index>>> local_groups(threads);
+    parallel_items(threads, bucket_num, [&](int t, size_t b) {
+        Index begin = bucket_start[b];
+        Index end = bucket_start[b + 1];
+        if (begin == end) {
+            return;
+        }
+        bool has_sep;
+        bucket_of(SA[begin], has_sep);
+        if (has_sep || end - begin == 1) {
+            for (Index k = begin; k < end; k++) {
+                rank[SA[k]] = k;
+            }
+        }
+        else {
+            for (Index k = begin; k < end; k++) {
+                rank[SA[k]] = begin;
+            }
+            local_groups[t].push_back({ begin, end });
+        }
+    });
+    bucket_start.clear();
+
+    // Prefix doubling: sort every unsorted group by the rank h characters further on.
+    std::vector<SuffixGroup<Index>> groups;
+    std::vector<std::vector<std::pair<Index, Index>>> buffers(threads);
+    uint64_t h = prefix_len;
+    while (true) {
+        groups.clear();
+        for (int t = 0; t < threads; t++) {
+            groups.insert(groups.end(), local_groups[t].begin(), local_groups[t].end());
+            local_groups[t].clear();
+        }
+        if (groups.empty()) {
+            break;
+        }
+        // big groups first, so that one of them does not finish last
+        const Index big_group = std::max<Index>(1024, n / ((Index)threads * 64));
+        std::partition(groups.begin(), groups.end(), [big_group](const SuffixGroup<Index>& g) {
+            return g.end - g.begin >= big_group;
+        });
+        // Groups whose suffixes all continue with the same rank stay unchanged; on repetitive
+        // collections this is most of them, so they are neither sorted nor re-ranked.
+        std::vector<char> uniform(groups.size(), 0);
+        parallel_items(threads, groups.size(), [&](int t, size_t g) {
+            const Index begin = groups[g].begin;
+            const Index end = groups[g].end;
+            const Index first_key = rank[SA[begin] + h];
+            Index k = begin + 1;
+            while (k < end && rank[SA[k] + h] == first_key) {
+                k++;
+            }
+            if (k == end) {
+                uniform[g] = 1;
+                return;
+            }
+            std::vector<std::pair<Index, Index>>& buf = buffers[t];
+            buf.clear();
+            for (k = begin; k < end; k++) {
+                buf.emplace_back(rank[SA[k] + h], SA[k]);
+            }
+            std::sort(buf.begin(), buf.end());
+            for (k = begin; k < end; k++) {
+                key[k] = buf[k - begin].first;
+                SA[k] = buf[k - begin].second;
+            }
+        });
+        // New ranks are only written once every group has read the old ones.
+        parallel_items(threads, groups.size(), [&](int t, size_t g) {
+            const Index begin = groups[g].begin;
+            const Index end = groups[g].end;
+            if (uniform[g]) {
+                local_groups[t].push_back(groups[g]);
+                return;
+            }
+            Index sub_begin = begin;
+            for (Index k = begin + 1; k <= end; k++) {
+                if (k == end || key[k] != key[k - 1]) {
+                    for (Index x = sub_begin; x < k; x++) {
+                        rank[SA[x]] = sub_begin;
+                    }
+                    if (k - sub_begin > 1) {
+                        local_groups[t].push_back({ sub_begin, k });
+                    }
+                    sub_begin = k;
+                }
+            }
+        });
+        h *= 2;
+    }
+    buffers.clear();
+    if (!LCP) {
+        free(key);
+    }
+
+    if (LCP) {
+        // PHI[SA[k]] = SA[k-1], then PLCP is computed in place chunk by chunk.
+        Index* phi = rank;
+        phi[SA[0]] = n;
+        parallel_chunks(threads, n - 1, [&](int t, Index begin, Index end) {
+            for (Index k = begin + 1; k <= end; k++) {
+                phi[SA[k]] = SA[k - 1];
+            }
+        });
+        parallel_chunks(threads, n, [&](int t, Index begin, Index end) {
+            Index l = 0;
+            for (Index i = begin; i < end; i++) {
+                Index j = phi[i];
+                if (j == n) {
+                    l = 0;
+                }
+                else {
+                    while (s[i + l] == s[j + l] && s[i + l] > 1) {
+                        l++;
+                    }
+                }
+                phi[i] = l;
+                if (l > 0) {
+                    l--;
+                }
+            }
+        });
+        parallel_chunks(threads, n, [&](int t, Index begin, Index end) {
+            for (Index k = begin; k < end; k++) {
+                LCP[k] = (IndexInt<Index>)phi[SA[k]];
+            }
+        });
+        LCP[0] = 0;
+    }
+    free(rank);
+
+    if (DA) {
+        parallel_chunks(threads, n, [&](int t, Index begin, Index end) {
+            for (Index k = begin; k < end; k++) {
+                DA[k] = (int32_t)(std::lower_bound(separators.begin(), separators.end(), SA[k]) - separators.begin());
+            }
+        });
+    }
+    return 0;
+}
+
+template int parallel_gsa<uint32_t>(const unsigned char* s, uint32_t* SA, int32_t* LCP, int32_t* DA, uint32_t n, int threads);
+template int parallel_gsa<uint64_t>(const unsigned char* s, uint64_t* SA, int64_t* LCP, int32_t* DA, uint64_t n, int threads);
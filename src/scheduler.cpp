@@ -0,0 +1,292 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/scheduler.h"
+#include <chrono>
+
+// Slot of the calling thread: workers have 1..threads-1, every other thread uses 0.
+static thread_local int worker_slot = 0;
+
+Scheduler::Scheduler() : threads_(1), queued_(0), sleeping_(0), quit_(false) {
+    queues_.emplace_back(new WorkerQueue());
+}
+
+/**
+* @brief Get the scheduler of the process.
+* It runs everything on the calling thread until set_threads() is called.
+*/
+Scheduler& Scheduler::instance() {
+    // never destroyed: a task may call exit(), and the workers must not be joined from one of them
+    static Scheduler* scheduler = new Scheduler();
+    return *scheduler;
+}
+
+/**
+* @brief Set the number of threads, the calling thread included.
+* Must not be called while a job is running.
+* @param threads The number of threads, values below 1 are treated as 1.
+*/
+void Scheduler::set_threads(int threads) {
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads == threads_) {
+        return;
+    }
+    stop();
+    start(threads);
+}
+
+void Scheduler::start(int threads) {
+    threads_ = threads;
+    quit_ = false;
+    queues_.clear();
+    for (int i = 0; i < threads; i++) {
+        queues_.emplace_back(new WorkerQueue());
+    }
+    for (int i = 1; i < threads; i++) {
+        workers_.emplace_back(&Scheduler::worker_loop, this, i);
+    }
+}
+
+void Scheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        quit_ = true;
+    }
+    wake_.notify_all();
+    for (auto& w : workers_) {
+        w.join();
+    }
+    workers_.clear();
+}
+
+int Scheduler::current_slot() const {
+    return worker_slot < threads_ ? worker_slot : 0;
+}
+
+void Scheduler::worker_loop(int slot) {
+    worker_slot = slot;
+    SchedulerTask task;
+    while (true) {
+        if (take(slot, task)) {
+            execute(slot, task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleeping_++;
+        wake_.wait(lock, [this]() { return quit_ || queued_.load() > 0; });
+        sleeping_--;
+        if (quit_) {
+            return;
+        }
+    }
+}
+
+void Scheduler::push(int slot, const SchedulerTask& task) {
+    {
+        std::lock_guard<std::mutex> lock(queues_[slot]->mutex);
+        queues_[slot]->tasks.push_back(task);
+    }
+    queued_++;
+    // a worker going to sleep counts itself before it checks queued_, so it cannot be missed
+    if (sleeping_.load() > 0) {
+        { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+        wake_.notify_one();
+    }
+}
+
+// Pop the newest task of the own deque, otherwise steal the oldest task of another one.
+bool Scheduler::take(int slot, SchedulerTask& task) {
+    {
+        WorkerQueue& own = *queues_[slot];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            queued_--;
+            return true;
+        }
+    }
+    for (int k = 1; k < threads_; k++) {
+        WorkerQueue& victim = *queues_[(slot + k) % threads_];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            queued_--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Scheduler::execute(int slot, SchedulerTask task) {
+    // a waiting thread may run the task of another alignment, its own options come back afterwards
+    GlobalArgs* previous = thread_args();
+    set_thread_args(task.job->args);
+    if (task.closure) {
+        try {
+            (*task.closure)();
+        }
+        catch (...) {
+            fail(task.job, std::current_exception());
+        }
+        delete task.closure;
+        set_thread_args(previous);
+        finish(task.job, 1);
+        return;
+    }
+    if (!task.job->failed.load()) {
+        // keep the lower half and leave the upper half to be stolen
+        while (task.end - task.begin > task.job->grain) {
+            uint_t mid = task.begin + (task.end - task.begin) / 2;
+            push(slot, { task.job, mid, task.end, NULL });
+            task.end = mid;
+        }
+        try {
+            task.job->body(task.begin, task.end);
+        }
+        catch (...) {
+            fail(task.job, std::current_exception());
+        }
+    }
+    set_thread_args(previous);
+    finish(task.job, task.end - task.begin);
+}
+
+// Keep the first exception of a job for the thread that waits for it.
+void Scheduler::fail(SchedulerJob* job, std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(job->mutex);
+    if (!job->error) {
+        job->error = error;
+    }
+    job->failed = true;
+}
+
+// Take the exception of a finished job and throw it.
+static void rethrow_failure(SchedulerJob& job) {
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(job.mutex);
+        error = job.error;
+        job.error = NULL;
+        job.failed = false;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void Scheduler::finish(SchedulerJob* job, uint_t items) {
+    if (job->pending.fetch_sub(items) == items) {
+        // the waiter takes the mutex before it returns, so the job outlives this block
+        std::lock_guard<std::mutex> lock(job->mutex);
+        // TaskGroup::run() may have queued a task since, it clears done under this mutex
+        if (job->pending.load() == 0) {
+            job->done = true;
+            job->finished.notify_all();
+        }
+    }
+}
+
+/**
+* @brief Queue a task, used by TaskGroup.
+* @param task The task, its items must already be counted in the pending items of its job.
+*/
+void Scheduler::submit(const SchedulerTask& task) {
+    push(current_slot(), task);
+}
+
+/**
+* @brief Run tasks until the job is finished.
+* @param job The job to wait for.
+*/
+void Scheduler::wait(SchedulerJob& job) {
+    const int slot = current_slot();
+    SchedulerTask task;
+    while (!job.done.load()) {
+        if (take(slot, task)) {
+            execute(slot, task);
+            continue;
+        }
+        // the remaining tasks are running elsewhere, but they may still split off more work
+        std::unique_lock<std::mutex> lock(job.mutex);
+        job.finished.wait_for(lock, std::chrono::microseconds(200), [&job]() { return job.done.load(); });
+    }
+    std::lock_guard<std::mutex> lock(job.mutex);
+}
+
+/**
+* @brief Run body on pieces of [begin, end) in parallel and wait for all of them.
+* @param begin The first item.
+* @param end One past the last item.
+* @param grain The largest piece that is not split further, at least 1.
+* @param body Called with the bounds of each piece.
+*/
+void Scheduler::parallel_for_range(uint_t begin, uint_t end, uint_t grain, const std::function<void(uint_t, uint_t)>& body) {
+    if (begin >= end) {
+        return;
+    }
+    if (grain < 1) {
+        grain = 1;
+    }
+    if (threads_ == 1 || end - begin <= grain) {
+        body(begin, end);
+        return;
+    }
+    SchedulerJob job;
+    job.body = body;
+    job.grain = grain;
+    job.args = thread_args();
+    job.pending = end - begin;
+    push(current_slot(), { &job, begin, end, NULL });
+    wait(job);
+    rethrow_failure(job);
+}
+
+/**
+* @brief Queue fn to be run by the scheduler.
+* @param fn The task.
+*/
+void TaskGroup::run(std::function<void()> fn) {
+    Scheduler& scheduler = Scheduler::instance();
+    if (job_.pending.fetch_add(1) == 0) {
+        std::lock_guard<std::mutex> lock(job_.mutex);
+        job_.done = false;
+        job_.args = thread_args();
+    }
+    scheduler.submit({ &job_, 0, 1, new std::function<void()>(std::move(fn)) });
+}
+
+/**
+* @brief Run tasks until every task of the group is finished.
+* @throws The first exception thrown by a task since the last wait.
+*/
+void TaskGroup::wait() {
+    if (job_.pending.load() == 0) {
+        // nothing was queued since the last wait, or a finishing task still holds the mutex
+        { std::lock_guard<std::mutex> lock(job_.mutex); }
+    }
+    else {
+        Scheduler::instance().wait(job_);
+    }
+    rethrow_failure(job_);
+}
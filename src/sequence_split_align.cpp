@@ -19,6 +19,14 @@
 // Created: 2023-02-25
 
 #include "../include/sequence_split_align.h"
+#include "../include/mem_finder.h"
+#include "../include/distributed.h"
+#include "../include/metrics.h"
+#include "../include/checkpoint.h"
+#include "../include/memory_budget.h"
+#include "../include/incremental.h"
+#include "../include/anchor_sample.h"
+#include <mutex>
 /**
 * @brief Generates a random string of the specified length.
 * This function generates a random string of the specified length. The generated string
@@ -80,11 +88,11 @@ std::string buildCommand(std::string cmdTemplate,
     // 必须包含 {input} 和 {output}
     if (cmdTemplate.find("{input}") == std::string::npos) {
         std::cerr << "Error: -p command template missing {input}\n";
-        std::exit(1);
+        alignment_failed("-p command template missing {input}");
     }
     if (cmdTemplate.find("{output}") == std::string::npos) {
         std::cerr << "Error: -p command template missing {output}\n";
-        std::exit(1);
+        alignment_failed("-p command template missing {output}");
     }
 
     // 占位符替换
@@ -118,27 +126,165 @@ std::string buildCommand(std::string cmdTemplate,
 
 /**
 * @brief Split and parallel align multiple sequences using a vector of chain pairs.
-* This function takes in three parameters: a vector of input sequences (data), a vector of sequence names (name),
-* and a vector of chain pairs (chain) that represent initial pairwise alignments between sequences.
+* This function takes in two parameters: a vector of input sequences (data) and a vector of chain pairs (chain)
+* that represent initial pairwise alignments between sequences.
 * It then splits the chain pairs into smaller regions and performs parallel sequence alignment on these regions.
 * Finally, it concatenates the aligned regions and performs sequence-to-profile alignment to generate a final alignment.
-* @param data A vector of input sequences to be aligned
-* @param name A vector of sequence names corresponding to the input sequences
+* @param data The store of input sequences to be aligned
 * @param chain A vector of chain pairs representing initial pairwise alignments between sequences
-* @return void
+* @return The aligned fragments, concat_string[k][i] is fragment k of sequence i
 */
 std::string random_file_end;
 
-void split_and_parallel_align(std::vector<std::string> data, std::vector<std::string> name, std::vector<std::vector<std::pair<int_t, int_t>>> chain){
+std::vector<std::vector<std::string>> split_and_parallel_align(const SequenceStore& data, std::vector<std::vector<std::pair<int_t, int_t>>>& chain){
     // Print status message
-    if (global_args.verbose) {
+    if (current_args().verbose) {
         std::cout << "#                Parallel Aligning...                       #" << std::endl;
         print_table_divider();
     }
 
-    random_file_end = generateRandomString(10);
+    // one suffix for the process, the task indices keep the files of its alignments apart
+    static std::once_flag file_end_once;
+    std::call_once(file_end_once, []() {
+        if (random_file_end.empty()) {
+            random_file_end = generateRandomString(10);
+        }
+    });
+    std::vector<std::vector<std::string>> concat_string = align_chains(data, chain, 0, current_args().min_mem_length, current_args().thread);
+    if (checkpoint_failures() > 0) {
+        print_table_bound();
+        std::cerr << "Error: " << checkpoint_failures() << " MSA jobs failed, the others are kept in " << current_args().checkpoint_dir
+            << ", rerun with -resume 1" << std::endl;
+        alignment_failed(std::to_string(checkpoint_failures()) + " MSA jobs failed");
+    }
+    return concat_string;
+}
+
+/**
+* @brief Align the sequences: deduplicate them, find the anchors (or read them from -checkpoint) and split and align.
+* @param data The sequences, replaced by the distinct ones with -dedup 1.
+* @param representative Receives for every input sequence its row of the result, empty if every sequence has its own.
+* @return The aligned fragments, concat_string[k][i] is fragment k of row i.
+*/
+std::vector<std::vector<std::string>> align_sequences(SequenceStore& data, std::vector<uint_t>& representative) {
+    GlobalArgs& args = current_args();
+    representative.clear();
+    // Identical sequences are aligned once, representative maps every sequence to its row in data
+    if (args.dedup) {
+        MetricsPhase dedup_phase("dedup");
+        SequenceStore unique;
+        representative = dedup_sequences(data, unique);
+        if (unique.size() < data.size()) {
+            if (args.verbose) {
+                std::string output = "Unique sequences: " + std::to_string(unique.size()) + " of " + std::to_string(data.size());
+                print_table_line(output);
+            }
+            data = std::move(unique);
+        }
+        else {
+            representative.clear();
+        }
+    }
+    if (data.size() == 1) {
+        // a single distinct sequence needs no alignment
+        return std::vector<std::vector<std::string>>(1, std::vector<std::string>(1, std::string(data[0])));
+    }
+    // Find MEMs in the sequences and split the sequences into fragments for parallel alignment.
+    // With -sample the anchors are found on a part of the sequences and placed on the others
+    MetricsPhase anchor_phase("anchors");
+    checkpoint_start(data);
+    std::vector<std::vector<std::pair<int_t, int_t>>> split_points_on_sequence;
+    if (checkpoint_load_chains(split_points_on_sequence)) {
+        if (args.verbose) {
+            print_table_line("Split points read from checkpoint");
+        }
+    }
+    else {
+        split_points_on_sequence = args.sample_size > 0 && (size_t)args.sample_size < data.size()
+            ? find_sampled_mem(data, args.sample_size, args.sample_mode) : find_mem(data);
+        checkpoint_save_chains(split_points_on_sequence);
+    }
+    anchor_phase.end();
+    MetricsPhase align_phase("align");
+    return split_and_parallel_align(data, split_points_on_sequence);
+}
+
+// Write the rows of an aligned gap region to path and free them, true if they were written.
+static bool spill_rows(std::vector<std::string>& rows, const std::string& path) {
+    std::ofstream out(path, std::ios::binary);
+    for (const std::string& row : rows) {
+        uint64_t size = row.size();
+        out.write((const char*)&size, sizeof(size));
+        out.write(row.data(), size);
+    }
+    if (!out.good()) {
+        out.close();
+        remove(path.c_str());
+        return false;
+    }
+    std::vector<std::string>(rows.size()).swap(rows);
+    return true;
+}
+
+// Read the rows written by spill_rows() back and remove the file.
+static void load_spilled_rows(std::vector<std::string>& rows, const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    for (std::string& row : rows) {
+        uint64_t size = 0;
+        in.read((char*)&size, sizeof(size));
+        row.resize(size);
+        in.read(&row[0], size);
+    }
+    if (!in.good()) {
+        std::cerr << "Error: fail to read " << path << " back" << std::endl;
+        alignment_failed("fail to read " + path + " back");
+    }
+    in.close();
+    remove(path.c_str());
+}
+
+// Chains placed by SW in the same sequence were searched between the same input chains and may cross;
+// going from left to right, a placement that begins before the end of the chain on its left is dropped.
+static void drop_crossing_placements(const std::vector<std::vector<std::pair<int_t, int_t>>>& chain,
+    std::vector<ExpandChainParams>& params, std::vector<std::vector<std::string>>& chain_string)
+{
+    const uint_t chain_num = params.size();
+    parallel_for(0, chain.size(), 64, [&](uint_t j) {
+        int_t left_end = 0;
+        for (uint_t i = 0; i < chain_num; i++) {
+            std::pair<int_t, int_t>& p = params[i].expanded_column[j];
+            if (p.first == -1) {
+                continue;
+            }
+            if (chain[j][i].first == -1 && p.first < left_end) {
+                p = std::make_pair(-1, -1);
+                chain_string[i][j].clear();
+                continue;
+            }
+            left_end = p.first + p.second;
+        }
+    });
+}
+
+// Task indices name the temporary fragment files, the gap regions of the recursive levels are numbered after those of the input
+static std::atomic<uint_t> next_task_index(0);
+
+/**
+* @brief Expand the chains and align the gap regions between them.
+* Gap regions longer than -rec_len are split again by the MEMs found in them, up to -rec_depth levels deep.
+* @param data The store of sequences to be aligned
+* @param chain The chains of every sequence, replaced by the expanded chains
+* @param depth The recursion level, 0 for the input sequences
+* @param min_mem_length The minimal MEM length the chains were found with
+* @param thread The number of MSA backend threads the gap regions may use together
+* @return The aligned fragments, chains and gap regions in turn, concat_string[k][i] is fragment k of sequence i
+*/
+std::vector<std::vector<std::string>> align_chains(const SequenceStore& data, std::vector<std::vector<std::pair<int_t, int_t>>>& chain,
+    uint_t depth, int_t min_mem_length, int thread) {
+    const bool verbose = current_args().verbose && depth == 0;
     std::string output = "";
     Timer timer;
+    const double start = metrics_now();
     uint_t chain_num = chain[0].size();
     uint_t seq_num = data.size();
     std::vector<std::vector<std::string>> chain_string(chain_num); // chain_num * seq_num
@@ -149,113 +295,213 @@ void split_and_parallel_align(std::vector<std::string> data, std::vector<std::st
         params[i].chain = &chain;
         params[i].chain_index = i;
         params[i].result_store = chain_string.begin() + i;
+        params[i].depth = depth;
     }
-    // Expand each chain pair and store the resulting aligned sequences
-    if (global_args.min_seq_coverage == 1) {
-#if (defined(__linux__))
-        threadpool pool;
-        threadpool_init(&pool, global_args.thread);
+    // The gap region k lies between chains k-1 and k, so its MSA job is started as soon as both
+    // are expanded; the SW expansion and the MSA backend run at the same time.
+    uint_t parallel_num = chain_num + 1;
+    const uint_t task_base = next_task_index.fetch_add(parallel_num);
+    std::vector<std::vector<std::pair<int_t, int_t>>> parallel_align_range(parallel_num);
+    std::vector<std::vector<std::string>> parallel_string(parallel_num, std::vector<std::string>(seq_num));
+    std::vector<ParallelAlignParams> parallel_params(parallel_num);
+    // number of neighboring chains that are not expanded yet
+    std::unique_ptr<std::atomic<int>[]> waiting_chain(new std::atomic<int>[parallel_num]);
+    for (uint_t k = 0; k < parallel_num; k++) {
+        waiting_chain[k] = (k > 0 ? 1 : 0) + (k < chain_num ? 1 : 0);
+    }
+    std::atomic<uint_t> expanded_num(0);
+    std::atomic<uint_t> placed_num(0);
+    double SW_time = 0;
+    TaskGroup group;
+    // Ready MSA jobs start most expensive first, within a budget of -t backend threads;
+    // at the top level the budget is that of the MPI workers in -dist mpi, see dist_job_slots()
+    int max_job_threads = 0;
+    int job_slots = depth == 0 ? dist_job_slots(max_job_threads) : thread;
+    // at the top level a job also waits for its memory to fit into -max_mem, the recursive levels run inside one
+    MsaJobQueue msa_queue(group, job_slots, max_job_threads, depth == 0 && dist_runs_backend());
+    // With -max_mem the aligned gap regions go to the temporary folder while the budget is exceeded
+    std::vector<char> spilled(parallel_num, 0);
+    auto spill_path = [&](uint_t k) {
+        return current_args().tmp_folder + "spill-" + std::to_string(task_base + k) + "_" + random_file_end + ".bin";
+    };
+    // The regions between the unexpanded chains are close enough to announce the cost of every job up front
+    std::vector<double> expected_cost(parallel_num);
+    {
+        std::vector<std::vector<std::pair<int_t, int_t>>> column(chain_num, std::vector<std::pair<int_t, int_t>>(seq_num));
+        for (uint_t j = 0; j < seq_num; j++) {
+            for (uint_t i = 0; i < chain_num; i++) {
+                column[i][j] = chain[j][i];
+            }
+        }
+        for (uint_t k = 0; k < parallel_num; k++) {
+            MsaJobRecord record;
+            expected_cost[k] = estimate_msa_cost(get_parallel_align_column(data,
+                k > 0 ? &column[k - 1] : NULL, k < chain_num ? &column[k] : NULL), record);
+            msa_queue.expect(expected_cost[k]);
+        }
+    }
+
+    auto launch_parallel_align = [&](uint_t k) {
+        parallel_align_range[k] = get_parallel_align_column(data,
+            k > 0 ? &params[k - 1].expanded_column : NULL,
+            k < chain_num ? &params[k].expanded_column : NULL);
+        parallel_params[k].data = &data;
+        parallel_params[k].parallel_range = parallel_align_range.begin() + k;
+        parallel_params[k].task_index = task_base + k;
+        parallel_params[k].result_store = parallel_string.begin() + k;
+        parallel_params[k].depth = depth;
+        parallel_params[k].min_mem_length = min_mem_length;
+        MsaJobRecord record;
+        record.task_index = task_base + k;
+        estimate_msa_cost(parallel_align_range[k], record);
+        msa_queue.push(record, [&, k](int thread_num) {
+            parallel_params[k].thread_num = thread_num;
+            parallel_align(&parallel_params[k]);
+            if (depth == 0 && MemoryBudget::instance().exceeded()) {
+                spilled[k] = spill_rows(parallel_string[k], spill_path(k));
+            }
+        }, expected_cost[k]);
+    };
+    // At the top level the expanded chains are kept by -checkpoint once all of them are done
+    bool expanded_loaded = false;
+    auto chain_expanded = [&](uint_t i) {
+        if (expanded_num.fetch_add(1) + 1 == chain_num) {
+            SW_time = timer.elapsed_time();
+            if (depth == 0 && !expanded_loaded && checkpoint_enabled()) {
+                std::vector<const std::vector<std::pair<int_t, int_t>>*> column(chain_num);
+                for (uint_t k = 0; k < chain_num; k++) {
+                    column[k] = &params[k].expanded_column;
+                }
+                checkpoint_save_expanded(column, chain_string);
+            }
+        }
+        if (--waiting_chain[i] == 0) {
+            launch_parallel_align(i);
+        }
+        if (--waiting_chain[i + 1] == 0) {
+            launch_parallel_align(i + 1);
+        }
+    };
+
+    // Chains missing in a sequence are placed by SW between the chains around them in the input,
+    // so every chain is expanded at the same time; the gap regions wait until all of them are placed
+    bool chain_complete = true;
+    for (uint_t j = 0; j < seq_num && chain_complete; j++) {
+        for (uint_t i = 0; i < chain_num; i++) {
+            if (chain[j][i].first == -1) {
+                chain_complete = false;
+                break;
+            }
+        }
+    }
+    std::vector<std::vector<std::pair<int_t, int_t>>> loaded_column;
+    std::vector<std::vector<std::string>> loaded_string;
+    if (depth == 0 && chain_num > 0 && checkpoint_load_expanded(loaded_column, loaded_string)
+        && loaded_column.size() == chain_num && loaded_column[0].size() == seq_num) {
+        // -resume: every chain is expanded already, all gap regions can start
+        expanded_loaded = true;
         for (uint_t i = 0; i < chain_num; i++) {
-            threadpool_add_task(&pool, expand_chain, &params[i]);
+            params[i].expanded_column.swap(loaded_column[i]);
+            chain_string[i].swap(loaded_string[i]);
+        }
+        if (verbose) {
+            print_table_line("Expanded chains read from checkpoint");
         }
-        threadpool_destroy(&pool);
-#else // Otherwise, use OpenMP for parallel execution
-#pragma omp parallel for num_threads(global_args.thread)
         for (uint_t i = 0; i < chain_num; i++) {
-            expand_chain(&params[i]);
+            chain_expanded(i);
         }
-#endif
-    } else {
+    }
+    else if (chain_num == 0) {
+        launch_parallel_align(0);
+    }
+    // Expand each chain pair and store the resulting aligned sequences
+    else {
+        // The tasks only read the chain, the expanded columns are written back once all of them are done
         for (uint_t i = 0; i < chain_num; i++) {
-            expand_chain(&params[i]);
+            group.run([&, i]() {
+                expand_chain(&params[i]);
+                if (chain_complete) {
+                    chain_expanded(i);
+                }
+                else if (placed_num.fetch_add(1) + 1 == chain_num) {
+                    drop_crossing_placements(chain, params, chain_string);
+                    for (uint_t k = 0; k < chain_num; k++) {
+                        chain_expanded(k);
+                    }
+                }
+            });
+        }
+    }
+    group.wait();
+    for (uint_t i = 0; i < chain_num; i++) {
+        for (uint_t j = 0; j < seq_num; j++) {
+            chain[j][i] = params[i].expanded_column[j];
         }
     }
-    
-
     params.clear();
- 
-    // Calculate SW expand time and print status message
-    double SW_time = timer.elapsed_time();
+    if (depth == 0) {
+        metrics_event("phase", "sw_expand", start, start + SW_time);
+        metrics_event("phase", "parallel_align", start, metrics_now());
+    }
+
+    // Print the SW expand time, the MSA jobs ran alongside
     std::stringstream s;
     s << std::fixed << std::setprecision(2) << SW_time;
-    if (global_args.verbose) {
+    if (verbose) {
         output = "SW expand time: " + s.str() + " seconds.";
         print_table_line(output);
     }
-    
-    timer.reset();
 
-    // Create temporary file folder (if it doesn't already exist)
-    if (0 != access(TMP_FOLDER.c_str(), 0))
-    {
-#ifdef __linux__
-        if (0 != mkdir(TMP_FOLDER.c_str(), 0755)) {
-            std::cerr << "Fail to create file folder " << TMP_FOLDER << std::endl;
-    }
-#else
-        if (0 != mkdir(TMP_FOLDER.c_str())) {
-            std::cerr << "Fail to create file folder " << TMP_FOLDER << std::endl;
-        }
-#endif
-    }
-    // Calculate parallel alignment ranges and perform parallel alignment for each range
-    std::vector<std::vector<std::pair<int_t, int_t>>> parallel_align_range = get_parallel_align_range(data, chain);
-    uint_t parallel_num = parallel_align_range.size();
-    std::vector<std::vector<std::string>> parallel_string(parallel_num, std::vector<std::string>(seq_num));
-    std::vector<ParallelAlignParams> parallel_params(parallel_num);
-    // If the system is Linux, initialize a thread pool and add tasks to it for parallel execution
-#if (defined(__linux__))
-    threadpool pool;
-    threadpool_init(&pool, global_args.thread);
-    for (uint_t i = 0; i < parallel_num; i++) {
-        parallel_params[i].data = &data;
-        parallel_params[i].parallel_range = parallel_align_range.begin()+i;
-        parallel_params[i].task_index = i;
-        parallel_params[i].result_store = parallel_string.begin() + i;
-        threadpool_add_task(&pool, parallel_align, &parallel_params[i]);
-    }
-    threadpool_destroy(&pool);
-#else // Otherwise, use OpenMP for parallel execution
-#pragma omp parallel for num_threads(global_args.thread)
-    for (uint_t i = 0; i < parallel_num; i++) {
-        parallel_params[i].data = &data;
-        parallel_params[i].parallel_range = parallel_align_range.begin() + i;
-        parallel_params[i].task_index = i;
-        parallel_params[i].result_store = parallel_string.begin() + i;
-        parallel_align(&parallel_params[i]);
-    }
-#endif
-    // Remove temporary files created during parallel execution
-    delete_tmp_folder(parallel_num);
-    // Calculate the time taken for parallel alignment and print the output
+    // Calculate the time taken for parallel alignment, the SW expansion included, and print the output
     double parallel_align_time = timer.elapsed_time();
     s.str("");
     s << std::fixed << std::setprecision(2) << parallel_align_time;
-    if (global_args.verbose) {
+    if (verbose) {
         output = "Parallel align time: " + s.str() + " seconds.";
         print_table_line(output);
     }
+    if (depth == 0) {
+        msa_queue.report(current_args().cost_log);
+    }
     
     timer.reset();
+    uint_t spilled_num = 0;
+    for (uint_t k = 0; k < parallel_num; k++) {
+        if (spilled[k]) {
+            load_spilled_rows(parallel_string[k], spill_path(k));
+            spilled_num++;
+        }
+    }
+    if (verbose && spilled_num > 0) {
+        output = "Spilled gap regions: " + std::to_string(spilled_num) + " of " + std::to_string(parallel_num);
+        print_table_line(output);
+    }
     // Concatenate the chains and parallel ranges
     std::vector<std::vector<std::pair<int_t, int_t>>> concat_range = concat_chain_and_parallel_range(chain, parallel_align_range);
     // Concatenate the chain strings and parallel strings
     std::vector<std::vector<std::string>> concat_string = concat_chain_and_parallel(chain_string, parallel_string);
-    std::vector<uint_t> fragment_len = get_first_nonzero_lengths(concat_string);
-
-    // seq2profile(concat_string, data, concat_range, fragment_len);
+    // The parts of the sequences left out of fragments are aligned against the profile of the other rows
+    const double seq2profile_start = metrics_now();
+    uint_t seq2profile_num = seq2profile(concat_string, data, concat_range);
+    // seq2profile() needs rows of the same width in every fragment, the trimming comes after it
+    for (uint_t k = 0; k + 1 < concat_string.size(); k++) {
+        refinement(concat_string[k], concat_string[k + 1]);
+    }
     double seq2profile_time = timer.elapsed_time();
-
-    concat_alignment(concat_string, name);
+    if (depth == 0) {
+        metrics_event("phase", "seq2profile", seq2profile_start, metrics_now());
+    }
 
     s.str("");
     s << std::fixed << std::setprecision(2) << seq2profile_time;
-    if (global_args.verbose) {
+    if (verbose) {
+        output = "Seq-profile rows: " + std::to_string(seq2profile_num);
+        print_table_line(output);
         output = "Seq-profile time: " + s.str() + " seconds.";
         print_table_line(output);
         print_table_divider();
     }
-    return;
+    return concat_string;
 }
 
 /**
@@ -287,7 +533,7 @@ std::vector<int_t> get_remaining_cols(int_t n, const std::vector<int_t> selected
 * @param split_points_on_sequence A vector of vectors of pairs, where each pair represents the start and mem length
 * @return A vector of indices of the selected columns.
 */
-std::vector<int_t> select_columns(std::vector<std::vector<std::pair<int_t, int_t>>> split_points_on_sequence) {
+std::vector<int_t> select_columns(const std::vector<std::vector<std::pair<int_t, int_t>>>& split_points_on_sequence) {
     // Get the number of columns and rows in the split points sequence.
     uint_t col_num = split_points_on_sequence[0].size();
     uint_t row_num = split_points_on_sequence.size();
@@ -345,7 +591,7 @@ std::vector<int_t> select_columns(std::vector<std::vector<std::pair<int_t, int_t
         uint_t col_index = effect_col_num[i].second;
         if (effect_num <= 0) {
             std::cerr << "some bugs occur in select column." << std::endl;
-            exit(-1);
+            alignment_failed("some bugs occur in select column");
         }
         if (col_need_change[col_index] == false) {
             col_need_change[col_index] = true;
@@ -368,6 +614,78 @@ std::vector<int_t> select_columns(std::vector<std::vector<std::pair<int_t, int_t
     return selected_cols;
 }
 
+/**
+* @brief Estimate where a chain that is missing in a sequence begins in it.
+* Every nearby chain that is present both in the sequence and in the sequence the query is taken from
+* gives one estimate: its begin in the sequence plus its distance to the query. The median of the estimates
+* of up to SW_WINDOW_NEIGHBORS chains on each side is returned. Without such chains the begin of the query
+* is scaled by the lengths of the two sequences.
+* @param data The store of sequences.
+* @param chain The chains, chain[i][k] is the (begin, length) of chain k in sequence i, begin -1 if missing.
+* @param seq_index The sequence the chain is missing in.
+* @param query_index A sequence that contains the chain.
+* @param chain_index The chain.
+* @return The estimated begin of the chain in sequence seq_index.
+*/
+int_t expected_chain_position(const SequenceStore& data, const std::vector<std::vector<std::pair<int_t, int_t>>>& chain,
+    uint_t seq_index, uint_t query_index, uint_t chain_index)
+{
+    const std::vector<std::pair<int_t, int_t>>& row = chain[seq_index];
+    const std::vector<std::pair<int_t, int_t>>& query_row = chain[query_index];
+    const int_t query_begin = query_row[chain_index].first;
+    std::vector<int_t> estimate;
+    uint_t found = 0;
+    for (uint_t k = chain_index; k > 0 && found < SW_WINDOW_NEIGHBORS; k--) {
+        if (row[k - 1].first != -1 && query_row[k - 1].first != -1) {
+            estimate.push_back(row[k - 1].first + (query_begin - query_row[k - 1].first));
+            found++;
+        }
+    }
+    found = 0;
+    for (uint_t k = chain_index + 1; k < row.size() && found < SW_WINDOW_NEIGHBORS; k++) {
+        if (row[k].first != -1 && query_row[k].first != -1) {
+            estimate.push_back(row[k].first - (query_row[k].first - query_begin));
+            found++;
+        }
+    }
+    if (estimate.empty()) {
+        return (int_t)((double)query_begin * data[seq_index].length() / std::max<size_t>(1, data[query_index].length()));
+    }
+    std::sort(estimate.begin(), estimate.end());
+    return estimate[estimate.size() / 2];
+}
+
+// Align the query against windows of ref around expected, doubling the window until the score is
+// good enough or the window is the whole of ref. The positions of alignment are relative to ref.
+// query_size is the length of the query with the gaps store_sw_alignment put in, query_residues without.
+static void window_align(const StripedSmithWaterman::Aligner& aligner, const StripedSmithWaterman::Filter& filter,
+    StripedSmithWaterman::Alignment* alignment, std::string_view ref, int_t expected, size_t query_size, size_t query_residues,
+    int32_t maskLen, uint64_t& sw_cells)
+{
+    const int_t ref_size = ref.size();
+    // the gaps of the query score nothing, only its bases can match
+    const double min_score = SW_WINDOW_MIN_SCORE * aligner.GetMatchScore() * query_residues;
+    expected = std::max<int_t>(0, std::min(expected, ref_size));
+    for (int_t half = current_args().sw_window; ; half *= 2) {
+        int_t begin = std::max<int_t>(0, expected - half);
+        int_t end = std::min<int_t>(ref_size, expected + (int_t)query_size + half);
+        bool whole = begin == 0 && end == ref_size;
+        sw_cells += (uint64_t)(end - begin) * query_size;
+        // the window is a view into the sequence, only the aligner translates it
+        if (!aligner.AlignReference(ref.data() + begin, end - begin, filter, alignment, maskLen)) {
+            return;
+        }
+        if (whole || alignment->sw_score >= min_score) {
+            if (alignment->ref_begin >= 0) {
+                alignment->ref_begin += begin;
+            }
+            alignment->ref_end += begin;
+            alignment->ref_end_next_best += begin;
+            return;
+        }
+    }
+}
+
 /**
 @brief Expands the chain at the given index for all sequences in the input data.
 This function takes a void pointer to input arguments and casts it to the correct struct type.
@@ -386,8 +704,8 @@ void* expand_chain(void* arg) {
     // Cast the input parameters to the correct struct type
     ExpandChainParams* ptr = static_cast<ExpandChainParams*>(arg);
     // Get data, chain, and chain_index from the input parameters
-    const std::vector<std::string> data = *(ptr->data);
-    std::vector<std::vector<std::pair<int_t, int_t>>> chain = *(ptr->chain);
+    const SequenceStore& data = *(ptr->data);
+    const std::vector<std::vector<std::pair<int_t, int_t>>>& chain = *(ptr->chain);
     const uint_t chain_index = ptr->chain_index;
     // std::cout << "in" << chain_index << '\n';
     // Get the number of sequences in the data vector and the number of chains in the current chain
@@ -404,15 +722,28 @@ void* expand_chain(void* arg) {
     uint_t query_length = 0;
     std::string query = "";
     std::vector<std::string> aligned_fragment(seq_num);
+    const double start = metrics_now();
+    uint64_t sw_cells = 0;
+    uint_t sw_rows = 0;
+    std::vector<std::pair<int_t, int_t>>& expanded_column = ptr->expanded_column;
+    expanded_column.resize(seq_num);
     // Find the query sequence and its length in the current chain
+    for (uint_t i = 0; i < seq_num; i++) {
+        expanded_column[i] = chain[i][chain_index];
+    }
+    uint_t query_index = 0;
     for (uint_t i = 0; i < seq_num; i++) {
         if (chain[i][chain_index].first != -1) {
+            query_index = i;
             query_length = chain[i][chain_index].second;
-            query = data[i].substr(chain[i][chain_index].first, query_length);
+            query = std::string(data[i].substr(chain[i][chain_index].first, query_length));
             break;
         }
     }
-    
+    // the query profile is built once for all rows; it is rebuilt only when
+    // store_sw_alignment inserted gaps into the query
+    aligner.SetQuerySequence(query.data(), query.size());
+    size_t profiled_length = query.size();
 
     for (uint_t i = 0; i < seq_num; i++) {
         int_t begin_pos = chain[i][chain_index].first;
@@ -434,16 +765,28 @@ void* expand_chain(void* arg) {
 
             ref_end_pos = tmp_index >= chain_num - 1 ? data[i].length() - 1 : chain[i][tmp_index + 1].first;
 
-            std::string ref = data[i].substr(ref_begin_pos, ref_end_pos - ref_begin_pos);
+            std::string_view ref = data[i].substr(ref_begin_pos, ref_end_pos - ref_begin_pos);
 
             // Get the reference subsequence and align it with the query subsequence
-            aligner.Align(query.c_str(), ref.c_str(), ref.size(), filter, &alignment, maskLen);
+            if (query.size() != profiled_length) {
+                aligner.SetQuerySequence(query.data(), query.size());
+                profiled_length = query.size();
+            }
+            if (current_args().sw_window > 0) {
+                int_t expected = expected_chain_position(data, chain, i, query_index, chain_index) - (int_t)ref_begin_pos;
+                window_align(aligner, filter, &alignment, ref, expected, query.size(), query_length, maskLen, sw_cells);
+            }
+            else {
+                aligner.AlignReference(ref.data(), ref.size(), filter, &alignment, maskLen);
+                sw_cells += (uint64_t)ref.size() * query.size();
+            }
+            sw_rows++;
 
             std::pair<int_t, int_t> p = store_sw_alignment(alignment, ref, query, aligned_fragment, i);
        
             if (p.first != -1) {
                 p.first += ref_begin_pos;
-                (*(ptr->chain))[i][chain_index] = p;
+                expanded_column[i] = p;
             }
            
         }
@@ -452,6 +795,12 @@ void* expand_chain(void* arg) {
         }
     }
     *(ptr->result_store) = aligned_fragment;
+    if (metrics_enabled()) {
+        MetricsArgs args;
+        args.add("chain", chain_index).add("depth", ptr->depth).add("query_length", query_length)
+            .add("sw_rows", sw_rows).add("sw_cells", sw_cells);
+        metrics_event("expand_chain", "expand_chain " + std::to_string(chain_index), start, metrics_now(), args);
+    }
  
     return NULL;
 }
@@ -468,11 +817,11 @@ void* expand_chain(void* arg) {
 * @param seq_index The index of the query sequence in the vector of aligned sequences.
 * @return A pair of integers representing the alignment start and length.
 */
-std::pair<int_t, int_t> store_sw_alignment(StripedSmithWaterman::Alignment alignment, std::string& ref, std::string& query,
+std::pair<int_t, int_t> store_sw_alignment(const StripedSmithWaterman::Alignment& alignment, std::string_view ref, std::string& query,
     std::vector<std::string>& res_store, uint_t seq_index)
 {
     // Extract cigar string from the alignment
-    std::vector<unsigned int> cigar = alignment.cigar;
+    const std::vector<unsigned int>& cigar = alignment.cigar;
     // Extract the start and end positions of the alignment on the reference sequence
     int_t ref_begin = alignment.ref_begin;
     int_t ref_end = alignment.ref_end;
@@ -604,65 +953,99 @@ std::pair<int_t, int_t> store_sw_alignment(StripedSmithWaterman::Alignment align
 }
 
 /**
- * @brief Get the range of each sequence in parallel alignment
- * @param data The vector of sequences to be aligned
- * @param chain The vector of chains representing the alignment
- * @return The vector of ranges for each sequence in the alignment
+ * @brief Get the range of each sequence in the gap region between two expanded chains
+ * @param data The store of sequences to be aligned
+ * @param left The chain column on the left of the region, NULL for the region before the first chain
+ * @param right The chain column on the right of the region, NULL for the region after the last chain
+ * @return The range (begin, length) of every sequence, (-1,-1) if one of the chains is missing on it
  */
-std::vector<std::vector<std::pair<int_t, int_t>>> get_parallel_align_range(std::vector<std::string> data, std::vector<std::vector<std::pair<int_t, int_t>>> chain) {
-    // Get the number of sequences and chains
+std::vector<std::pair<int_t, int_t>> get_parallel_align_column(const SequenceStore& data, const std::vector<std::pair<int_t, int_t>>* left, const std::vector<std::pair<int_t, int_t>>* right) {
     uint_t seq_num = data.size();
-    uint_t chain_num = chain[0].size();
-    // Initialize the vector to store the ranges
-    std::vector<std::vector<std::pair<int_t, int_t>>> parallel_align_range(seq_num);
-
-    // Iterate through each sequence
+    std::vector<std::pair<int_t, int_t>> range(seq_num);
     for (uint_t i = 0; i < seq_num; i++) {
-        // Initialize the last position as 0 and a temporary vector to store the ranges
+        // The region starts at the end of the left chain and ends at the begin of the right chain
         int_t last_pos = 0;
-        std::vector<std::pair<int_t, int_t>> tmp_range;
-        // Iterate through each chain for the current sequence
-        for (uint_t j = 0; j < chain_num; j++) {
-            // Get the begin position for the current chain
-            int_t begin_pos = chain[i][j].first;
-            // If the chain cannot be aligned, add (-1,-1) to the range and set the last position as -1
-            if (begin_pos == -1) {
-                tmp_range.push_back(std::make_pair(-1, -1));
-                last_pos = -1;
-            }
-            else {
-                // If the last chain could not be aligned, add (-1,-1) to the range
-                if (last_pos == -1) {
-                    tmp_range.push_back(std::make_pair(-1, -1));
-                }
-                else {
-                    // Add the range between the last position and the current chain's begin position
-                    tmp_range.push_back(std::make_pair(last_pos, begin_pos - last_pos));
-                }
-                // Update the last position to the end of the current chain
-                last_pos = begin_pos + chain[i][j].second;
-            }
+        if (left) {
+            last_pos = (*left)[i].first == -1 ? -1 : (*left)[i].first + (*left)[i].second;
         }
-        // If the last chain could not be aligned, add (-1,-1) to the range
-        if (last_pos == -1) {
-            tmp_range.push_back(std::make_pair(-1, -1));
+        int_t begin_pos = right ? (*right)[i].first : (int_t)data[i].length();
+        // If one of the chains cannot be aligned, the region is left out
+        if (last_pos == -1 || begin_pos == -1) {
+            range[i] = std::make_pair(-1, -1);
         }
         else {
-            // Add the range between the last position and the end of the sequence
-            tmp_range.push_back(std::make_pair(last_pos, data[i].length() - last_pos));
+            range[i] = std::make_pair(last_pos, begin_pos - last_pos);
         }
-        // Add the ranges for the current sequence to the vector of ranges
-        parallel_align_range[i] = tmp_range;
     }
-    std::vector<std::vector<std::pair<int_t, int_t>>> transpose_res(parallel_align_range[0].size(), std::vector<std::pair<int_t, int_t>>(seq_num));
-    for (uint_t i = 0; i < seq_num; i++) {
-        for (uint_t j = 0; j < parallel_align_range[0].size(); j++) {
-            transpose_res[j][i] = parallel_align_range[i][j];
+    return range;
+}
+
+// Align an oversized gap region with FMAlign itself: the MEMs of its rows, found with half the MEM length
+// of the level above, split it into smaller regions. Returns false if the region stays with the backend:
+// it is short enough, the recursion is as deep as -rec_depth allows, or its rows share no MEM.
+static bool recursive_align(const std::vector<std::string_view>& rows, uint_t depth, int_t min_mem_length, int thread,
+    std::vector<std::string>& aligned)
+{
+    size_t longest = 0;
+    for (std::string_view row : rows) {
+        longest = std::max(longest, row.size());
+    }
+    if ((int_t)depth >= current_args().recursive_depth || (int_t)longest <= current_args().recursive_length) {
+        return false;
+    }
+    // the rows are distinct, so at most one of them is empty; it is filled with gaps below
+    SequenceStore store;
+    std::vector<int_t> store_row(rows.size(), -1);
+    size_t total_length = 0;
+    for (std::string_view row : rows) {
+        total_length += row.size();
+    }
+    store.reserve(total_length, rows.size());
+    for (uint_t i = 0; i < rows.size(); i++) {
+        if (!rows[i].empty()) {
+            store_row[i] = store.size();
+            store.append(rows[i]);
+        }
+    }
+    if (store.size() < 2) {
+        return false;
+    }
+    MemFinderOptions options;
+    options.min_mem_length = std::max<int_t>(RECURSIVE_MIN_MEM_LENGTH, min_mem_length / 2);
+    options.filter_mode = current_args().filter_mode;
+    options.index_mode = current_args().index_mode;
+    options.thread = 1;
+    options.index_cache = false;
+    options.verbose = false;
+    std::vector<std::vector<std::pair<int_t, int_t>>> chain = find_mem(store, options);
+    if (chain[0].empty()) {
+        return false;
+    }
+    std::vector<std::vector<std::string>> concat_string = align_chains(store, chain, depth + 1, options.min_mem_length, thread);
+
+    std::vector<std::string> store_aligned(store.size());
+    for (uint_t i = 0; i < store.size(); i++) {
+        for (const std::vector<std::string>& fragment : concat_string) {
+            store_aligned[i] += fragment[i];
+        }
+    }
+    // every row of a complete alignment has the same length
+    const size_t length = store_aligned[0].size();
+    for (const std::string& row : store_aligned) {
+        if (row.size() != length) {
+            return false;
+        }
+    }
+    aligned.assign(rows.size(), std::string());
+    for (uint_t i = 0; i < rows.size(); i++) {
+        if (store_row[i] >= 0) {
+            aligned[i].swap(store_aligned[store_row[i]]);
+        }
+        else {
+            aligned[i].assign(length, '-');
         }
     }
-    parallel_align_range.clear();
-    // Return the vector of ranges
-    return transpose_res;
+    return true;
 }
 
 /**
@@ -676,409 +1059,444 @@ void* parallel_align(void* arg) {
     // Cast the input parameters to the correct struct type
     ParallelAlignParams* ptr = static_cast<ParallelAlignParams*>(arg);
     // Get data, chain, and chain_index from the input parameters
-    const std::vector<std::string> data = *(ptr->data);
-    std::vector<std::pair<int_t, int_t>> parallel_range = *(ptr->parallel_range);
+    const SequenceStore& data = *(ptr->data);
+    const std::vector<std::pair<int_t, int_t>>& parallel_range = *(ptr->parallel_range);
     const uint_t task_index = ptr->task_index;
     // Get the number of sequences in the data vector and the number of chains in the current chain
     uint_t seq_num = data.size();
-    std::string file_name = TMP_FOLDER + "task-" + std::to_string(task_index)+"_"+ random_file_end + ".fasta";
-    std::ofstream file;
-    file.open(file_name);
-
-    if (!file.is_open()) {
-        std::cerr << file_name << " fail to open!" << std::endl;
-        exit(1);
-    }
 
+    const double start = metrics_now();
+    uint_t row_num = 0;
+    uint64_t unique_bytes = 0;
+    std::string fasta;
     std::vector<uint_t> aligned_seq_index;
+    // Identical rows are aligned once, fragment_row maps every row to its unique row
+    std::unordered_map<std::string_view, uint_t> unique_row;
+    std::vector<std::string_view> unique_fragment;
+    std::vector<int_t> fragment_row(seq_num, -1);
     for (uint_t i = 0; i < seq_num; i++) {  
         if (parallel_range[i].first >= 0) {
             // Get a subset of the sequence to align
-            std::string seq_content = data[i].substr(parallel_range[i].first, parallel_range[i].second);
-            std::stringstream sstreasm;
-            sstreasm << ">SEQENCE" << i << "\n" << seq_content << "\n";
-            file << sstreasm.str();
+            std::string_view fragment = data[i].substr(parallel_range[i].first, parallel_range[i].second);
+            auto it = unique_row.emplace(fragment, (uint_t)aligned_seq_index.size());
+            fragment_row[i] = it.first->second;
+            row_num++;
+            if (!it.second) {
+                continue;
+            }
+            unique_bytes += fragment.size();
+            fasta += ">SEQENCE" + std::to_string(i) + "\n";
+            fasta.append(fragment);
+            fasta += "\n";
             aligned_seq_index.push_back(i);
+            unique_fragment.push_back(fragment);
         }       
     }
-    file.close();
-    // Call the align_fasta function to align the sequences in the file
-    std::string res_file_name = align_fasta(file_name);
-
-
     std::vector<std::string> aligned_seq;
-    std::vector<std::string> aligned_name;
-    read_data(res_file_name.c_str(), aligned_seq, aligned_name, false);
+    const char* method = "empty";
+    // Trivial and small fragments are aligned in-process, only the others go to the MSA backend
+    if (!unique_fragment.empty()) {
+        FragmentKind kind = classify_fragment(unique_fragment, current_args().small_fragment, current_args().trivial_mismatch);
+        if (kind == FRAGMENT_TRIVIAL) {
+            method = "trivial";
+            align_trivial_fragment(unique_fragment, aligned_seq);
+        }
+        else if (kind == FRAGMENT_SMALL) {
+            method = "small";
+            progressive_align(unique_fragment, aligned_seq);
+        }
+        else if (recursive_align(unique_fragment, ptr->depth, ptr->min_mem_length, ptr->thread_num, aligned_seq)) {
+            method = "recursive";
+        }
+        else {
+            method = "backend";
+            align_fragment(fasta, task_index, aligned_seq, ptr->thread_num);
+        }
+    }
+    if (aligned_seq.size() != aligned_seq_index.size()) {
+        std::cerr << "Error: the MSA backend returned " << aligned_seq.size() << " sequences for fragment " << task_index
+            << ", expected " << aligned_seq_index.size() << std::endl;
+        alignment_failed("the MSA backend returned " + std::to_string(aligned_seq.size()) + " sequences for fragment "
+            + std::to_string(task_index) + ", expected " + std::to_string(aligned_seq_index.size()));
+    }
+
     std::vector<std::string> final_aligned_seq(seq_num, "");
     // Map the aligned sequences back to their original indices in the input data vector
-    for (uint_t i = 0; i < aligned_seq_index.size(); i++) {
-        final_aligned_seq[aligned_seq_index[i]] = aligned_seq[i];
-    }
-    for (uint_t i = 0; i < aligned_seq_index.size(); i++) {
-        final_aligned_seq[aligned_seq_index[i]] = aligned_seq[i];
+    for (uint_t i = 0; i < seq_num; i++) {
+        if (fragment_row[i] >= 0) {
+            final_aligned_seq[i] = aligned_seq[fragment_row[i]];
+        }
     }
     // Store the aligned sequences in the result storage
     *(ptr->result_store) = final_aligned_seq;
+    if (metrics_enabled()) {
+        MetricsArgs args;
+        args.add("task", task_index).add("depth", ptr->depth).add("method", std::string(method)).add("rows", row_num)
+            .add("unique_rows", (uint64_t)unique_fragment.size()).add("bytes", unique_bytes).add("threads", ptr->thread_num);
+        metrics_event("parallel_align", "fragment " + std::to_string(task_index), start, metrics_now(), args);
+    }
 
     return NULL;
 }
+
 /**
-* @brief Align sequences in a FASTA file using either halign or mafft package.
-* @param file_name The name of the FASTA file to align.
-* @return The name of the resulting aligned FASTA file.
+* @brief Align the fragment FASTA with the configured MSA backend.
+* Stream templates receive the FASTA on stdin and return the alignment on stdout.
+* Other templates fall back to a temporary file pair in current_args().tmp_folder, which is removed afterwards.
+* With -dist the fragment goes to an MPI worker or the fragment files instead, see dist_align_fragment().
+* @param fasta The fragment in FASTA format.
+* @param task_index The index of the fragment, used to name the temporary files.
+* @param aligned_seq Receives the aligned sequences in input order.
+* @param thread The number of threads passed to the backend.
+* @return void
 */
-std::string align_fasta(std::string file_name) {
+// A fragment whose backend call failed under -checkpoint: its rows padded with gaps stand in until -resume aligns it
+static void fragment_failed(const std::string& fasta, std::vector<std::string>& aligned_seq) {
+    checkpoint_fragment_failed();
+    std::vector<std::string> seq_name;
+    aligned_seq.clear();
+    parse_alignment(fasta, aligned_seq, seq_name);
+    size_t length = 0;
+    for (const std::string& row : aligned_seq) {
+        length = std::max(length, row.size());
+    }
+    for (std::string& row : aligned_seq) {
+        row.resize(length, '-');
+    }
+}
+
+void align_fragment(const std::string& fasta, uint_t task_index, std::vector<std::string>& aligned_seq, int thread) {
+    // with -resume a fragment aligned by an earlier run is read back
+    if (checkpoint_load_fragment(fasta, aligned_seq)) {
+        return;
+    }
+    const double start = metrics_now();
+    // The backend call of a fragment as a metrics event, spawn_seconds is -1 where it is not measured
+    auto record = [&](const char* mode, int exit_code, double spawn_seconds) {
+        if (metrics_enabled()) {
+            MetricsArgs args;
+            args.add("task", task_index).add("mode", std::string(mode)).add("rows", (uint64_t)std::count(fasta.begin(), fasta.end(), '>'))
+                .add("bytes", (uint64_t)fasta.size()).add("threads", thread).add("spawn_seconds", spawn_seconds).add("exit_code", exit_code);
+            metrics_event("msa_backend", "msa " + std::to_string(task_index), start, metrics_now(), args);
+        }
+    };
+    // in distributed mode the fragment is aligned elsewhere
+    if (dist_align_fragment(fasta, aligned_seq)) {
+        record(current_args().dist_mode.c_str(), 0, -1);
+        // -dist prepare only returns placeholder rows
+        if (dist_writes_alignment()) {
+            checkpoint_save_fragment(fasta, aligned_seq);
+        }
+        return;
+    }
+    std::vector<std::string> aligned_name;
+    if (is_stream_template(current_args().package)) {
+        std::string aligned;
+        double spawn_seconds = -1;
+        int res = run_msa_stream(current_args().package, fasta, aligned, thread, &spawn_seconds);
+        record("stream", res, spawn_seconds);
+        if (res != 0) {
+            std::cerr << "Error: command execution failed with exit code " << res << std::endl;
+            if (checkpoint_enabled()) {
+                fragment_failed(fasta, aligned_seq);
+                return;
+            }
+            alignment_failed("MSA command execution failed with exit code " + std::to_string(res));
+        }
+        parse_alignment(aligned, aligned_seq, aligned_name);
+        checkpoint_save_fragment(fasta, aligned_seq);
+        return;
+    }
 
-    std::ifstream file(file_name, std::ios::binary | std::ios::ate);
-    int_t size = file.tellg() / (1024 * 1024);
+    std::string file_name = current_args().tmp_folder + "task-" + std::to_string(task_index) + "_" + random_file_end + ".fasta";
+    std::ofstream file(file_name, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << file_name << " fail to open!" << std::endl;
+        alignment_failed(file_name + " fail to open");
+    }
+    file << fasta;
     file.close();
-    int_t t_int = 1;
-    if (ceil(size / global_args.avg_file_size) + 1 < global_args.thread) {
-        t_int = (int_t)(ceil(size / global_args.avg_file_size) + 1);
+    // Call the align_fasta function to align the sequences in the file
+    std::string res_file_name = align_fasta(file_name, thread);
+    record("file", res_file_name.empty() ? 1 : 0, -1);
+    if (res_file_name.empty() || !read_alignment(res_file_name.c_str(), aligned_seq, aligned_name)) {
+        if (!res_file_name.empty()) {
+            std::cerr << res_file_name << " fail to open!" << std::endl;
+        }
+        if (checkpoint_enabled()) {
+            remove(file_name.c_str());
+            fragment_failed(fasta, aligned_seq);
+            return;
+        }
+        remove(file_name.c_str());
+        alignment_failed("the MSA command produced no alignment of fragment " + std::to_string(task_index));
     }
-    else {
-        t_int = global_args.thread;
+    checkpoint_save_fragment(fasta, aligned_seq);
+    if (remove(file_name.c_str()) != 0) {
+        std::cerr << "Error deleting file " << file_name << std::endl;
     }
-    std::string t = std::to_string(t_int);
-    // std::cout << size << " "<< global_args.avg_file_size <<" " << t <<std::endl;
-    // Construct command string based on selected alignment package and operating system
-    std::string cmd_temp = global_args.package;
+    if (remove(res_file_name.c_str()) != 0) {
+        std::cerr << "Error deleting file " << res_file_name << std::endl;
+    }
+}
 
+/**
+* @brief Align sequences in a FASTA file using either halign or mafft package.
+* @param file_name The name of the FASTA file to align.
+* @param thread The number of threads passed to the backend.
+* @return The name of the resulting aligned FASTA file, empty if the command failed under -checkpoint.
+*/
+std::string align_fasta(std::string file_name, int thread) {
+    // Construct command string based on selected alignment package and operating system
+    std::string cmd_temp = current_args().package;
 
-    
     std::string res_file_name = file_name.substr(0, file_name.find(".fasta")) + ".aligned.fasta";
-    std::string cmnd = buildCommand(cmd_temp, file_name, res_file_name, t_int);
+    std::string cmnd = buildCommand(cmd_temp, file_name, res_file_name, thread);
 
     try {
         // Execute the command and check for errors
         int res = system(cmnd.c_str());
         if (res != 0) {
 			std::cerr << "Error: command execution failed with exit code " << res << std::endl;
-            exit(1);
+            // with -checkpoint the caller counts the failure and the run goes on
+            if (checkpoint_enabled()) {
+                return "";
+            }
+            alignment_failed("MSA command execution failed with exit code " + std::to_string(res));
             
             
         }
     }
     catch (const char* e) { // Catch any bad allocations and print an error message.
         std::cerr << "Error: " << e << std::endl;
-        exit(1);
+        alignment_failed(e);
     }
     
     return res_file_name;
 }
 
-/**
-* @brief Deletes temporary files generated during sequence alignment tasks.
-* @param task_count The number of tasks for which temporary files were created.
-*/
-void delete_tmp_folder(uint_t task_count) {
-    for (uint_t i = 0; i < task_count; i++) {
-        std::string file_name = TMP_FOLDER +"task-" + std::to_string(i) + "_" + random_file_end + ".fasta";
-        std::string res_file_name = TMP_FOLDER + "task-" + std::to_string(i) + "_" + random_file_end + ".aligned.fasta";
-        if (remove(file_name.c_str()) != 0) {
-            std::cerr << "Error deleting file " << file_name << std::endl;
-        }
-        if (remove(res_file_name.c_str()) != 0) {
-            std::cerr << "Error deleting file " << res_file_name << std::endl;
-        }
-    }
-}
-
 /**
 * @brief Concatenate multiple sequence alignments into a single alignment and write the result to an output file.
 * @param concat_string A 2D vector of strings containing the aligned sequences to concatenate.
 * @param name A vector of strings containing the names of the sequences.
+* @param representative For every name the row of concat_string it is written with, empty for the identity.
 */
-void concat_alignment(std::vector<std::vector<std::string>> &concat_string, std::vector<std::string> &name) {
-    std::string output_path = global_args.output_path;
-    std::vector<std::string> concated_data(name.size(), "");
-    // Concatenate the sequences
+void concat_alignment(std::vector<std::vector<std::string>> &concat_string, const std::vector<std::string> &name, const std::vector<uint_t>& representative) {
+    MetricsPhase phase("write_output");
+    std::string output_path = current_args().output_path;
+    // the rows are written fragment by fragment, an aligned row never exists as one string
+    AlignmentWriter output_file(output_path, current_args().bgzf);
+    if (!output_file.is_open()) {
+        std::cerr << "Error opening output file " << output_path << std::endl;
+        exit(1);
+    }
+
+    // Duplicated sequences are written with the row of their representative
     for (uint_t i = 0; i < name.size(); i++) {
+        uint_t row = representative.empty() ? i : representative[i];
+        output_file.put('>');
+        output_file.write(name[i]);
+        output_file.put('\n');
         for (uint_t j = 0; j < concat_string.size(); j++) {
-            concated_data[i] += concat_string[j][i];          
+            output_file.write(concat_string[j][row]);
         }
+        output_file.put('\n');
     }
-    // Write the concatenated sequences to the output file
-    std::ofstream output_file;
-    output_file.open(output_path);
-    if (!output_file.is_open()) {
-        std::cerr << "Error opening output file " << output_path << std::endl;
+    if (!output_file.close()) {
+        std::cerr << "Error writing output file " << output_path << std::endl;
         exit(1);
     }
-
-    for (uint_t i = 0; i < concated_data.size(); i++) {
-        std::stringstream ss;
-        ss << ">" << name[i] << "\n" << concated_data[i] << "\n";
-        output_file << ss.str();
+    if (current_args().anchors && !write_anchor_file(output_path + ANCHOR_FILE_SUFFIX, concat_string, name.size())) {
+        std::cerr << "Error writing anchor file " << output_path + ANCHOR_FILE_SUFFIX << std::endl;
+        exit(1);
     }
-    output_file.close();
-}
-
-bool cmp(const std::pair<uint_t, uint_t>& a, const std::pair<uint_t, uint_t>& b) {
-    return a.second < b.second;
 }
 
 /**
-* @brief Convert sequence fragments into profile by aligning missing fragments with existing ones.
-* @param concat_string A reference to a vector of vectors of strings representing concatenated sequence fragments.
-* @param data A reference to a vector of strings representing the sequence names.
-* @param concat_range A reference to a vector of vectors of pairs of integers representing the start and end positions of the sequence fragments.
-* @param fragment_len A reference to a vector of unsigned integers representing the lengths of the sequence fragments.
-* @return None.
+* @brief Align the parts of the sequences that were left out of fragments (range -1) against the profile of those fragments.
+* Every run of consecutive fragments missing in a sequence is one task. The tasks are independent: each one aligns the
+* part of its sequence between the fragments around the run against the column frequencies of the rows present in the
+* run, see align_to_profile(). All tasks run in parallel, then every fragment takes the new gap columns the tasks need.
+* @param concat_string The aligned fragments, concat_string[k][i] is fragment k of sequence i, empty where it is missing.
+* @param data The store of input sequences.
+* @param concat_range The range (begin, length) of every fragment in every sequence, (-1,-1) where it is missing.
+* @return The number of tasks.
 */
-void seq2profile(std::vector<std::vector<std::string>>& concat_string, std::vector<std::string> &data, 
-    std::vector<std::vector<std::pair<int_t, int_t>>> &concat_range, std::vector<uint_t> &fragment_len) {
-    // Count the number of missing fragments for each sequence and store them in a vector of pairs.
-    uint_t seq_num = data.size();
-    uint_t fragment_num = fragment_len.size();
-
-    std::vector<std::pair<uint_t, uint_t>> missing_fragment_count(seq_num);
+uint_t seq2profile(std::vector<std::vector<std::string>>& concat_string, const SequenceStore& data,
+    const std::vector<std::vector<std::pair<int_t, int_t>>>& concat_range) {
+    const uint_t seq_num = data.size();
+    const uint_t fragment_num = concat_string.size();
+    std::vector<Seq2ProfileTask> tasks;
     for (uint_t i = 0; i < seq_num; i++) {
-        uint_t count = 0;
-        for (uint_t j = 0; j < fragment_num; j++) {
-            if (concat_range[j][i].first == -1) {
-                count+=fragment_len[j];
+        for (uint_t k = 0; k < fragment_num; k++) {
+            if (concat_range[k][i].first != -1) {
+                continue;
             }
-        }
-        missing_fragment_count[i] = std::make_pair(i, count);
-    }
-
-
-    // Sort the vector of pairs by the number of missing fragments in ascending order.
-    std::sort(missing_fragment_count.begin(), missing_fragment_count.end(), cmp);
-#if DEBUG
-    for (int_t i = 0; i < missing_fragment_count.size(); i++) {
-        std::cout << missing_fragment_count[i].first << " "  << missing_fragment_count[i].second << std::endl;
-    }
-#endif // 
-
-    // For each sequence with missing fragments, align the missing fragments with existing fragments.
-    for (uint_t i = 0; i < seq_num; i++) {
-        uint_t seq_index = missing_fragment_count[i].first;
-        uint_t missing_count = missing_fragment_count[i].second;
-        if (missing_count <= 0) {
-            continue;
-        }
-        // std::cout << seq_index << std::endl;
-        bool if_start = false;
-        std::vector<std::vector<std::string>>::iterator left_it = concat_string.begin();
-        std::vector<std::vector<std::string>>::iterator right_it = concat_string.begin();
-        std::vector<std::vector<std::string>>::iterator cur_it = concat_string.begin();
-        for (; cur_it != concat_string.end(); cur_it++) {
-            std::vector<std::string>cur_vec = *cur_it;
-            // std::cout << cur_vec[seq_index].length() << " " << fragment_len[cur_it - concat_string.begin()] << " " << concat_range[cur_it - concat_string.begin()][seq_index].first << std::endl;
-            // if (cur_vec[seq_index].length() != fragment_len[cur_it - concat_string.begin()]) {
-            if (concat_range[cur_it - concat_string.begin()][seq_index].first == -1) {
-                if (!if_start) {
-                    left_it = cur_it;
-                    if_start = true;
-                }
-            } else if (if_start) {
-                right_it = cur_it - 1;
-                cur_it = seq2profile_align(seq_index,left_it-concat_string.begin(), right_it - concat_string.begin(), concat_string, data, concat_range, fragment_len);
-                if_start = false;
+            Seq2ProfileTask task;
+            task.seq_index = i;
+            task.first = k;
+            while (k + 1 < fragment_num && concat_range[k + 1][i].first == -1) {
+                k++;
             }
-            if (if_start && cur_it + 1 == concat_string.end()) {
-                right_it = cur_it;
-                seq2profile_align(seq_index, left_it - concat_string.begin(), right_it - concat_string.begin(), concat_string, data, concat_range, fragment_len);
-                break;
-            }          
+            task.last = k;
+            // the sequence between the fragments around the run
+            task.begin = 0;
+            if (task.first > 0) {
+                task.begin = concat_range[task.first - 1][i].first + concat_range[task.first - 1][i].second;
+            }
+            task.end = data[i].length();
+            if (task.last + 1 < fragment_num) {
+                task.end = concat_range[task.last + 1][i].first;
+            }
+            tasks.push_back(std::move(task));
         }
-            
     }
+    seq2profile_tasks(concat_string, data, tasks);
+    return tasks.size();
 }
 
 /**
-* @brief: Aligns a sequence and a profile using a third-party tool called profile_two_align and returns the iterator pointing to the next position in the 2D vector of strings.
-* The function first checks for gaps between the fragments and adds them as necessary. 
-* Then it writes the sequence to align and a profile file, passes them to profile_two_align, and reads the results. 
-* Finally, it updates the concatenated string, range and fragment length information accordingly.
-* @param seq_index: Index of the sequence to align.
-* @param left_index: Index of the left-most fragment.
-* @param right_index: Index of the right-most fragment.
-* @param concat_string: 2D vector of strings containing the concatenated fragments.
-* @param data: Vector of strings containing the sequences.
-* @param concat_range: 2D vector of pairs of integers representing the range of each fragment in each sequence.
-* @param fragment_len: Vector of unsigned integers representing the length of each fragment.
-* @return std::vector<std::vectorstd::string>::iterator: Iterator pointing to the next position in the 2D vector of strings.
+* @brief Align parts of sequences against the profile of the other rows of the fragments they belong to.
+* The profile of a fragment is built from the rows of its width that are not aligned by a task in it. All tasks run
+* in parallel, then every fragment takes the new gap columns the tasks need and the rows of the tasks are replaced.
+* @param concat_string The aligned fragments, concat_string[k][i] is fragment k of sequence i.
+* @param data The store of sequences the parts of the tasks are taken from.
+* @param tasks The parts to align, a fragment of a sequence is in at most one task.
 */
-std::vector<std::vector<std::string>>::iterator seq2profile_align(uint_t seq_index, uint_t left_index, uint_t right_index, std::vector<std::vector<std::string>>& concat_string, std::vector<std::string>& data, std::vector<std::vector<std::pair<int_t, int_t>>>& concat_range, std::vector<uint_t>& fragment_len) {
-    int_t seq_begin = 0;
-    // determine the start position of the sequence, if there is a sequence on the left side, take the end of the last one.
-    if (left_index >= 1) {
-        seq_begin = concat_range[left_index-1][seq_index].first + concat_range[left_index - 1][seq_index].second;
-    }
-    int_t seq_end = data[seq_index].length();
-    // determine the end position of the sequence, if there is a sequence on the right side, take the start position of the next one.
-    if (right_index + 1 < concat_range.size()) {
-        seq_end = concat_range[right_index+1][seq_index].first;
-    }
-    // create a file to store the sequence content.
-
-    std::string seq_content = data[seq_index].substr(seq_begin, seq_end - seq_begin);
-#if DEBUG
-    std::cout << seq_content << std::endl;
-    std::cout << concat_range.size() << " " << concat_range[0].size() << std::endl;
-    std::cout << left_index << " " << right_index << " " << seq_index << std::endl;
-    std::cout << seq_end << " " << seq_begin << " " << data[seq_index].length() << std::endl;
-#endif // DEBUG
-
-    if (seq_content.length() == 0) {
-        for (uint_t i = left_index; i <= right_index; i++) {
-            std::string tmp_gaps = "";
-            for (uint_t j = 0; j < fragment_len[i]; j++) {
-                tmp_gaps += "-";
-            }
-            concat_string[i][seq_index] = tmp_gaps;
-        }
-        
-        return concat_string.begin() + right_index + 1;
-    }
-    std::string seq_file_name = TMP_FOLDER + "seq-" + std::to_string(seq_index) + "_" + random_file_end + ".fasta";
-    std::ofstream file;
-    file.open(seq_file_name);
-    if (!file.is_open()) {
-        std::cerr << seq_file_name << " fail to open!" << std::endl;
-        exit(1);
+void seq2profile_tasks(std::vector<std::vector<std::string>>& concat_string, const SequenceStore& data,
+    std::vector<Seq2ProfileTask>& tasks) {
+    const uint_t seq_num = concat_string.empty() ? 0 : concat_string[0].size();
+    const uint_t fragment_num = concat_string.size();
+    std::vector<uint_t> fragment_len = get_first_nonzero_lengths(concat_string);
+    if (tasks.empty()) {
+        return;
     }
-    // write the sequence content to the file in fasta format.
-    std::stringstream sstream;
-    sstream << ">SEQUENCE" << std::to_string(seq_index) << "\n";
-    sstream << seq_content << "\n";
-    file << sstream.str();
-    file.close();
-
-    // create a file to store the profile of the sequences.
-    sstream.str("");
-    std::string profile_file_name = TMP_FOLDER + "profile-" + std::to_string(seq_index) + "_" + random_file_end + ".fasta";
-
-    file.open(profile_file_name);
-
-    if (!file.is_open()) {
-        std::cerr << seq_file_name << " fail to open!" << std::endl;
-        exit(1);
+    std::vector<std::vector<uint_t>> fragment_tasks(fragment_num);
+    for (uint_t t = 0; t < tasks.size(); t++) {
+        for (uint_t k = tasks[t].first; k <= tasks[t].last; k++) {
+            fragment_tasks[k].push_back(t);
+        }
     }
 
-    std::vector<uint_t> selected_profile_seq_index;
-    std::vector<uint_t> missing_profile_seq_index;
-    for (uint_t i = 0; i < data.size(); i++) {
-        if (i == seq_index) {
-            continue;
+    // The profile of a fragment is built from the rows present in it
+    std::vector<std::vector<ProfileColumn>> profile(fragment_num);
+    std::vector<uint_t> profile_rows(fragment_num, 0);
+    parallel_for(0, fragment_num, 1, [&](uint_t k) {
+        if (fragment_tasks[k].empty()) {
+            return;
         }
-        bool cur_fragment_is_missing = false;
-        sstream << ">SEQUENCE" << std::to_string(i) << "\n";
-        for (uint_t j = left_index; j <= right_index; j++) {
-            if (concat_string[j][i].length() == fragment_len[j]) {
-                sstream << concat_string[j][i];
-            }
-            else {
-                cur_fragment_is_missing = true;
-                break;
+        std::vector<char> is_task_row(seq_num, 0);
+        for (uint_t t : fragment_tasks[k]) {
+            is_task_row[tasks[t].seq_index] = 1;
+        }
+        profile[k].assign(fragment_len[k], ProfileColumn{ {}, 0 });
+        for (uint_t i = 0; i < seq_num; i++) {
+            if (!is_task_row[i] && concat_string[k][i].size() == fragment_len[k]) {
+                add_to_profile(profile[k], concat_string[k][i]);
+                profile_rows[k]++;
             }
         }
-        if (cur_fragment_is_missing) {
-            sstream.str("");
-            missing_profile_seq_index.push_back(i);
-            continue;
+    });
+
+    parallel_for(0, tasks.size(), 1, [&](uint_t t) {
+        Seq2ProfileTask& task = tasks[t];
+        std::string_view row = data[task.seq_index].substr(task.begin, std::max<int_t>(task.end - task.begin, 0));
+        std::vector<ProfileColumn> span_profile;
+        std::vector<uint_t> column_rows;
+        for (uint_t k = task.first; k <= task.last; k++) {
+            span_profile.insert(span_profile.end(), profile[k].begin(), profile[k].end());
+            column_rows.insert(column_rows.end(), profile[k].size(), profile_rows[k]);
         }
-        file << sstream.str() << "\n";
-        selected_profile_seq_index.push_back(i);
-        sstream.str("");
-    }
-    file.close();
-    // use the alignment tool to align the sequences.
-    std::string cmd = "";
-#if (defined(__linux__))
-    cmd.append("ext/profile-two-align/linux/profile_two_align")
-        .append(" -q ").append(seq_file_name)
-        .append(" -p ").append(profile_file_name)
-        .append(" -F")
-        .append(" -D")
-        .append(" 2> /dev/null");
-#else
-    cmd.append("ext\\profile-two-align\\win\\profile_two_align.exe")
-        .append(" -q ").append(seq_file_name)
-        .append(" -p ").append(profile_file_name)
-        .append(" -F")
-        .append(" -D")
-        .append(" 2>NUL");
-#endif
-    
-    int res = system(cmd.c_str());
-    if (res != 0) {
-#if DEBUG
-        std::string out = "Warning: Seq-Profile alignment may result in errors and may produce invalid results.";
-        print_table_line(out);
-#endif
-    }
-    // Define vectors for storing aligned sequences and their names
-    std::vector<std::string> align_res;
-    std::vector<std::string> align_res_name;
-    // Read data from a file and store it in the above vectors
-    read_data(profile_file_name.c_str(), align_res, align_res_name, false);
-
-    for (uint_t i = 0; i < selected_profile_seq_index.size(); i++) {
-        concat_string[left_index][selected_profile_seq_index[i]] = align_res[i];
-    }
-    concat_string[left_index][seq_index] = align_res[align_res.size()-1];
-#if DEBUG
-    std::cout << align_res[align_res.size() - 1] << std::endl;
-#endif // DEBUG
-
-    // Loop through missing profile sequence indices and update concat_string accordingly
-    for (uint_t i = 0; i < missing_profile_seq_index.size(); i++) {
-        for (uint_t j = left_index + 1; j <= right_index; j++) {
-            concat_string[left_index][missing_profile_seq_index[i]] += concat_string[j][missing_profile_seq_index[i]];
+        // a long span is aligned in a band, so the trace of a task stays near PROFILE_MAX_TRACE_CELLS bytes
+        std::vector<unsigned char> ops;
+        {
+            MemoryReservation trace(profile_trace_cells(row.size(), span_profile.size(), PROFILE_MAX_TRACE_CELLS));
+            ops = align_to_profile(row, span_profile, column_rows, PROFILE_MAX_TRACE_CELLS);
         }
-    }
-    
-    fragment_len[left_index] = concat_string[left_index][seq_index].length();
-    // Update concat_range for all indices
-    for (uint_t i = 0; i < data.size(); i++) {
-        bool flag = false;
-        for (uint_t j = left_index; j <= right_index; j++) {
-            if (concat_range[j][i].first == -1) {
-                flag = true;
+        task.column.reserve(span_profile.size());
+        task.insertion.assign(span_profile.size() + 1, std::string());
+        size_t r = 0;
+        for (unsigned char op : ops) {
+            if (op == TRACE_MATCH) {
+                task.column.push_back(row[r++]);
+            }
+            else if (op == TRACE_COLUMN) {
+                task.column.push_back('-');
+            }
+            else {
+                task.insertion[task.column.size()].push_back(row[r++]);
             }
         }
-        if (flag) {
-            concat_range[left_index][i].first = -1;
-            concat_range[left_index][i].second = -1;
-            continue;
+    });
+
+    // Every fragment widens by the longest insertion before each of its columns, an insertion between two
+    // fragments goes to the start of the right one and one after the last column to the end of the last fragment
+    parallel_for(0, fragment_num, 1, [&](uint_t k) {
+        if (fragment_tasks[k].empty()) {
+            return;
         }
-        if (left_index > 0) {
-            concat_range[left_index][i].first = concat_range[left_index - 1][i].first + concat_range[left_index - 1][i].second;         
+        const uint_t length = fragment_len[k];
+        // the columns of fragment k in the span of a task, and the insertions that belong to it
+        auto span_offset = [&](const Seq2ProfileTask& task) {
+            uint_t offset = 0;
+            for (uint_t j = task.first; j < k; j++) {
+                offset += fragment_len[j];
+            }
+            return offset;
+        };
+        auto insertion_at = [&](const Seq2ProfileTask& task, uint_t offset, uint_t c) -> const std::string& {
+            static const std::string none;
+            // the boundary after the last column of the span belongs to the last fragment only
+            if (c == length && k != task.last) {
+                return none;
+            }
+            return task.insertion[offset + c];
+        };
+        std::vector<uint_t> width(length + 1, 0);
+        for (uint_t t : fragment_tasks[k]) {
+            const Seq2ProfileTask& task = tasks[t];
+            uint_t offset = span_offset(task);
+            for (uint_t c = 0; c <= length; c++) {
+                width[c] = std::max<uint_t>(width[c], insertion_at(task, offset, c).size());
+            }
         }
-        else {
-            concat_range[left_index][i].first = 0;
+        const uint_t inserted = std::accumulate(width.begin(), width.end(), (uint_t)0);
+        std::vector<char> is_task_row(seq_num, 0);
+        for (uint_t t : fragment_tasks[k]) {
+            const Seq2ProfileTask& task = tasks[t];
+            uint_t offset = span_offset(task);
+            std::string aligned;
+            aligned.reserve(length + inserted);
+            for (uint_t c = 0; c <= length; c++) {
+                const std::string& insertion = insertion_at(task, offset, c);
+                aligned += insertion;
+                aligned.append(width[c] - insertion.size(), '-');
+                if (c < length) {
+                    aligned.push_back(task.column[offset + c]);
+                }
+            }
+            concat_string[k][task.seq_index].swap(aligned);
+            is_task_row[task.seq_index] = 1;
         }
-        if (right_index + 1 < concat_range.size()) {
-            concat_range[left_index][i].second = concat_range[right_index + 1][i].first - concat_range[left_index][i].first;
+        if (inserted == 0) {
+            return;
         }
-        else {
-            concat_range[left_index][i].second = data[i].length() - concat_range[left_index][i].first;
+        for (uint_t i = 0; i < seq_num; i++) {
+            if (is_task_row[i]) {
+                continue;
+            }
+            const std::string& row = concat_string[k][i];
+            std::string widened;
+            widened.reserve(length + inserted);
+            for (uint_t c = 0; c <= length; c++) {
+                widened.append(width[c], '-');
+                if (c < length) {
+                    widened.push_back(c < row.size() ? row[c] : '-');
+                }
+            }
+            concat_string[k][i].swap(widened);
         }
-        
-    }
-    // Erase indices from concat_string, concat_range, and fragment_len vectors
-    std::vector<std::vector<std::string>>::iterator str_it = concat_string.begin() + left_index + 1;
-    std::vector<std::vector<std::pair<int_t, int_t>>>::iterator range_it = concat_range.begin() + left_index + 1;
-    std::vector<uint_t>::iterator fragment_it = fragment_len.begin() + left_index + 1;
-    int_t erase_len = right_index - left_index;
-    while (erase_len > 0 && str_it != concat_string.end()) {
-        str_it = concat_string.erase(str_it);
-        range_it = concat_range.erase(range_it);
-        fragment_it = fragment_len.erase(fragment_it);
-        erase_len--;
-    }
-    // Remove files from disk
-    if (remove(seq_file_name.c_str()) != 0) {
-        std::cerr << "Error deleting file " << seq_file_name << std::endl;
-    }
-    if (remove(profile_file_name.c_str()) != 0) {
-        std::cerr << "Error deleting file " << profile_file_name << std::endl;
-    }
-    return concat_string.begin() + left_index;
+    });
 }
 
 /**
@@ -1142,6 +1560,7 @@ void refinement(std::vector<std::string>& data1, std::vector<std::string>& data2
 
 /**
 * @brief Concatenate two sets of sequence data (chain and parallel) into a single set of concatenated data.
+* The fragments keep the width of their alignment, the gaps at their borders are trimmed later by refinement().
 * @param chain_string A vector of vectors containing the chain sequence data.
 * @param parallel_string A vector of vectors containing the parallel sequence data.
 * @return std::vector<std::vectorstd::string> A vector of vectors containing the concatenated sequence data.
@@ -1165,9 +1584,6 @@ std::vector<std::vector<std::string>> concat_chain_and_parallel(std::vector<std:
         }
         count += 2;
     }
-    for (uint_t i = 0; i < chain_num + parallel_num-1; i++) {
-        refinement(concated_data[i], concated_data[i + 1]);
-    }
     return concated_data;
 }
 
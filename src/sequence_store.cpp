@@ -0,0 +1,103 @@
+/*
+ * Copyright [2023] [MALABZ_UESTC Pinglu Zhang]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Author: Pinglu Zhang
+// Contact: zpl010720@gmail.com
+// Created: 2025-10-14
+
+#include "../include/sequence_store.h"
+#include <unordered_map>
+
+SequenceStore::SequenceStore() : bytes_(1, 0) {}
+
+/**
+* @brief Reserve space for the sequences that are going to be appended.
+* @param bytes The total length of the sequences.
+* @param count The number of sequences.
+*/
+void SequenceStore::reserve(size_t bytes, size_t count) {
+    bytes_.reserve(bytes + count + 1);
+    offsets_.reserve(count);
+    lengths_.reserve(count);
+}
+
+/**
+* @brief Append a sequence to the end of the store.
+* @param seq The sequence, it must not contain the bytes 0 and 1.
+*/
+void SequenceStore::append(std::string_view seq) {
+    // the terminating 0 becomes the first byte of the new sequence
+    bytes_.pop_back();
+    offsets_.push_back(bytes_.size());
+    lengths_.push_back(seq.size());
+    bytes_.insert(bytes_.end(), seq.begin(), seq.end());
+    bytes_.push_back(1);
+    bytes_.push_back(0);
+}
+
+/**
+* @brief Start a sequence that is filled piece by piece with extend() and closed with end_sequence().
+*/
+void SequenceStore::begin_sequence() {
+    bytes_.pop_back();
+    offsets_.push_back(bytes_.size());
+}
+
+/**
+* @brief Close the sequence opened by begin_sequence().
+*/
+void SequenceStore::end_sequence() {
+    lengths_.push_back(bytes_.size() - offsets_.back());
+    bytes_.push_back(1);
+    bytes_.push_back(0);
+}
+
+/**
+* @brief Remove all sequences and release the memory.
+*/
+void SequenceStore::clear() {
+    std::vector<unsigned char>(1, 0).swap(bytes_);
+    std::vector<uint_t>().swap(offsets_);
+    std::vector<uint_t>().swap(lengths_);
+}
+
+/**
+* @brief Collapse identical sequences to one representative.
+* @param data The sequences.
+* @param unique Receives the distinct sequences in the order of their first occurrence.
+* @return For every sequence of data the index of its representative in unique.
+*/
+std::vector<uint_t> dedup_sequences(const SequenceStore& data, SequenceStore& unique) {
+    std::vector<uint_t> representative(data.size());
+    std::unordered_map<std::string_view, uint_t> first_row;
+    first_row.reserve(data.size());
+    std::vector<uint_t> unique_rows;
+    size_t unique_bytes = 0;
+    for (size_t i = 0; i < data.size(); i++) {
+        auto it = first_row.emplace(data[i], (uint_t)unique_rows.size());
+        if (it.second) {
+            unique_rows.push_back(i);
+            unique_bytes += data.length(i);
+        }
+        representative[i] = it.first->second;
+    }
+    unique.clear();
+    unique.reserve(unique_bytes, unique_rows.size());
+    for (uint_t row : unique_rows) {
+        unique.append(data[row]);
+    }
+    return representative;
+}
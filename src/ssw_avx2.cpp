@@ -0,0 +1,74 @@
+/* The MIT License
+   Copyright (c) 2012-2015 Boston College.
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+   BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+   ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+/*
+ *  ssw_avx2.cpp
+ *
+ *  The striped kernels of ssw_kernel.h on 256 bit vectors, 32 bytes or 16 words per iteration.
+ *  Compiled with -mavx2; ssw.cpp only calls into this file when the CPU reports AVX2.
+ */
+
+#include <immintrin.h>
+#include "ssw_kernel.h"
+
+namespace {
+struct ssw_avx2 {
+	typedef __m256i vec;
+	enum { lanes8 = 32 };
+	static inline vec zero () { return _mm256_setzero_si256(); }
+	static inline vec set1_epi8 (uint8_t a) { return _mm256_set1_epi8(a); }
+	static inline vec set1_epi16 (uint16_t a) { return _mm256_set1_epi16(a); }
+	static inline vec load (const vec* p) { return _mm256_load_si256(p); }
+	static inline void store (vec* p, vec a) { _mm256_store_si256(p, a); }
+	static inline vec adds_epu8 (vec a, vec b) { return _mm256_adds_epu8(a, b); }
+	static inline vec subs_epu8 (vec a, vec b) { return _mm256_subs_epu8(a, b); }
+	static inline vec max_epu8 (vec a, vec b) { return _mm256_max_epu8(a, b); }
+	static inline vec adds_epi16 (vec a, vec b) { return _mm256_adds_epi16(a, b); }
+	static inline vec subs_epu16 (vec a, vec b) { return _mm256_subs_epu16(a, b); }
+	static inline vec max_epi16 (vec a, vec b) { return _mm256_max_epi16(a, b); }
+	// The byte shifts of AVX2 stay inside the 128 bit halves; the low half is carried into the high one.
+	static inline vec shift_byte (vec a) { return _mm256_alignr_epi8(a, _mm256_permute2x128_si256(a, a, 0x08), 15); }
+	static inline vec shift_word (vec a) { return _mm256_alignr_epi8(a, _mm256_permute2x128_si256(a, a, 0x08), 14); }
+	static inline bool any_gt_epu8 (vec a, vec b) {
+		return _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_subs_epu8(a, b), _mm256_setzero_si256())) != -1;
+	}
+	static inline bool any_gt_epi16 (vec a, vec b) { return _mm256_movemask_epi8(_mm256_cmpgt_epi16(a, b)) != 0; }
+	static inline bool all_eq_epi8 (vec a, vec b) { return _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) == -1; }
+	static inline bool all_eq_epi16 (vec a, vec b) { return _mm256_movemask_epi8(_mm256_cmpeq_epi16(a, b)) == -1; }
+	static inline uint8_t hmax_epu8 (vec v) {
+		__m128i vm = _mm_max_epu8(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+		vm = _mm_max_epu8(vm, _mm_srli_si128(vm, 8));
+		vm = _mm_max_epu8(vm, _mm_srli_si128(vm, 4));
+		vm = _mm_max_epu8(vm, _mm_srli_si128(vm, 2));
+		vm = _mm_max_epu8(vm, _mm_srli_si128(vm, 1));
+		return (uint8_t)_mm_extract_epi16(vm, 0);
+	}
+	static inline uint16_t hmax_epi16 (vec v) {
+		__m128i vm = _mm_max_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+		vm = _mm_max_epi16(vm, _mm_srli_si128(vm, 8));
+		vm = _mm_max_epi16(vm, _mm_srli_si128(vm, 4));
+		vm = _mm_max_epi16(vm, _mm_srli_si128(vm, 2));
+		return (uint16_t)_mm_extract_epi16(vm, 0);
+	}
+};
+} // namespace
+
+const ssw_kernel ssw_kernel_avx2 = SSW_KERNEL_TABLE(ssw_avx2, "avx2");
@@ -0,0 +1,76 @@
+/* The MIT License
+   Copyright (c) 2012-2015 Boston College.
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+   BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+   ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+/*
+ *  ssw_avx512.cpp
+ *
+ *  The striped kernels of ssw_kernel.h on 512 bit vectors, 64 bytes or 32 words per iteration.
+ *  Compiled with -mavx512bw; ssw.cpp only calls into this file when the CPU reports AVX-512BW.
+ */
+
+#include <immintrin.h>
+#include "ssw_kernel.h"
+
+namespace {
+struct ssw_avx512 {
+	typedef __m512i vec;
+	enum { lanes8 = 64 };
+	static inline vec zero () { return _mm512_setzero_si512(); }
+	static inline vec set1_epi8 (uint8_t a) { return _mm512_set1_epi8(a); }
+	static inline vec set1_epi16 (uint16_t a) { return _mm512_set1_epi16(a); }
+	static inline vec load (const vec* p) { return _mm512_load_si512(p); }
+	static inline void store (vec* p, vec a) { _mm512_store_si512(p, a); }
+	static inline vec adds_epu8 (vec a, vec b) { return _mm512_adds_epu8(a, b); }
+	static inline vec subs_epu8 (vec a, vec b) { return _mm512_subs_epu8(a, b); }
+	static inline vec max_epu8 (vec a, vec b) { return _mm512_max_epu8(a, b); }
+	static inline vec adds_epi16 (vec a, vec b) { return _mm512_adds_epi16(a, b); }
+	static inline vec subs_epu16 (vec a, vec b) { return _mm512_subs_epu16(a, b); }
+	static inline vec max_epi16 (vec a, vec b) { return _mm512_max_epi16(a, b); }
+	// The byte shifts stay inside the 128 bit quarters; each quarter gets the one below it, the lowest gets zeros.
+	static inline vec carry (vec a) { return _mm512_maskz_shuffle_i32x4(0xfff0, a, a, _MM_SHUFFLE(2, 1, 0, 0)); }
+	static inline vec shift_byte (vec a) { return _mm512_alignr_epi8(a, carry(a), 15); }
+	static inline vec shift_word (vec a) { return _mm512_alignr_epi8(a, carry(a), 14); }
+	static inline bool any_gt_epu8 (vec a, vec b) { return _mm512_cmpgt_epu8_mask(a, b) != 0; }
+	static inline bool any_gt_epi16 (vec a, vec b) { return _mm512_cmpgt_epi16_mask(a, b) != 0; }
+	static inline bool all_eq_epi8 (vec a, vec b) { return _mm512_cmpeq_epi8_mask(a, b) == (__mmask64)-1; }
+	static inline bool all_eq_epi16 (vec a, vec b) { return _mm512_cmpeq_epi16_mask(a, b) == (__mmask32)-1; }
+	// the masked extracts avoid a false -Wmaybe-uninitialized of GCC 12 on the plain ones
+	static inline uint8_t hmax_epu8 (vec v) {
+		__m256i half = _mm256_max_epu8(_mm512_maskz_extracti64x4_epi64(0xf, v, 0), _mm512_maskz_extracti64x4_epi64(0xf, v, 1));
+		__m128i vm = _mm_max_epu8(_mm256_castsi256_si128(half), _mm256_extracti128_si256(half, 1));
+		vm = _mm_max_epu8(vm, _mm_srli_si128(vm, 8));
+		vm = _mm_max_epu8(vm, _mm_srli_si128(vm, 4));
+		vm = _mm_max_epu8(vm, _mm_srli_si128(vm, 2));
+		vm = _mm_max_epu8(vm, _mm_srli_si128(vm, 1));
+		return (uint8_t)_mm_extract_epi16(vm, 0);
+	}
+	static inline uint16_t hmax_epi16 (vec v) {
+		__m256i half = _mm256_max_epi16(_mm512_maskz_extracti64x4_epi64(0xf, v, 0), _mm512_maskz_extracti64x4_epi64(0xf, v, 1));
+		__m128i vm = _mm_max_epi16(_mm256_castsi256_si128(half), _mm256_extracti128_si256(half, 1));
+		vm = _mm_max_epi16(vm, _mm_srli_si128(vm, 8));
+		vm = _mm_max_epi16(vm, _mm_srli_si128(vm, 4));
+		vm = _mm_max_epi16(vm, _mm_srli_si128(vm, 2));
+		return (uint16_t)_mm_extract_epi16(vm, 0);
+	}
+};
+} // namespace
+
+const ssw_kernel ssw_kernel_avx512 = SSW_KERNEL_TABLE(ssw_avx512, "avx512");
@@ -237,6 +237,9 @@ Aligner::Aligner(void)
     , gap_extending_penalty_(1)
     , translated_reference_(NULL)
     , reference_length_(0)
+    , translated_query_(NULL)
+    , query_length_(0)
+    , query_profile_(NULL)
 {
   BuildDefaultMatrix();
 }
@@ -256,6 +259,9 @@ Aligner::Aligner(
     , gap_extending_penalty_(gap_extending_penalty)
     , translated_reference_(NULL)
     , reference_length_(0)
+    , translated_query_(NULL)
+    , query_length_(0)
+    , query_profile_(NULL)
 {
   BuildDefaultMatrix();
 }
@@ -274,6 +280,9 @@ Aligner::Aligner(const int8_t* score_matrix,
     , gap_extending_penalty_(1)
     , translated_reference_(NULL)
     , reference_length_(0)
+    , translated_query_(NULL)
+    , query_length_(0)
+    , query_profile_(NULL)
 {
   score_matrix_ = new int8_t[score_matrix_size_ * score_matrix_size_];
   memcpy(score_matrix_, score_matrix, sizeof(int8_t) * score_matrix_size_ * score_matrix_size_);
@@ -286,6 +295,27 @@ Aligner::~Aligner(void){
   Clear();
 }
 
+int Aligner::SetQuerySequence(const char* query, const int& length) {
+  CleanQuerySequence();
+  if (!translation_matrix_ || length <= 0) return 0;
+
+  translated_query_ = new int8_t[length];
+  query_length_ = TranslateBase(query, length, translated_query_);
+
+  const int8_t score_size = 2;
+  query_profile_ = ssw_init(translated_query_, query_length_, score_matrix_,
+                            score_matrix_size_, score_size);
+  return query_length_;
+}
+
+void Aligner::CleanQuerySequence(void) {
+  if (query_profile_) init_destroy(query_profile_);
+  query_profile_ = NULL;
+  delete [] translated_query_;
+  translated_query_ = NULL;
+  query_length_ = 0;
+}
+
 int Aligner::SetReferenceSequence(const char* seq, const int& length) {
 
   int len = 0;
@@ -402,6 +432,33 @@ bool Aligner::Align(const char* query, const char* ref, const int& ref_len,
   return true;
 }
 
+bool Aligner::AlignReference(const char* ref, const int& ref_len,
+                    const Filter& filter, Alignment* alignment, const int32_t maskLen) const
+{
+  if (!translation_matrix_) return false;
+  if (query_length_ == 0) return false;
+
+  int8_t* translated_ref = new int8_t[ref_len];
+  TranslateBase(ref, ref_len, translated_ref);
+
+  uint8_t flag = 0;
+  SetFlag(filter, &flag);
+  s_align* s_al = ssw_align(query_profile_, translated_ref, ref_len,
+                                 static_cast<int>(gap_opening_penalty_),
+				 static_cast<int>(gap_extending_penalty_),
+				 flag, filter.score_filter, filter.distance_filter, maskLen);
+
+  alignment->Clear();
+  ConvertAlignment(*s_al, query_length_, alignment);
+  alignment->mismatches = CalculateNumberMismatch(&*alignment, translated_ref, translated_query_, query_length_);
+
+  // Free memory
+  delete [] translated_ref;
+  align_destroy(s_al);
+
+  return true;
+}
+
 void Aligner::Clear(void) {
   ClearMatrices();
   CleanReferenceSequence();
@@ -468,6 +525,9 @@ void Aligner::BuildDefaultMatrix(void) {
 }
 
 void Aligner::ClearMatrices(void) {
+  // the query profile points into the score matrix
+  CleanQuerySequence();
+
   delete [] score_matrix_;
   score_matrix_ = NULL;
 
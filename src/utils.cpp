@@ -20,8 +20,32 @@
 
 
 #include "../include/utils.h"
+#include "../include/msa_backend.h"
+#include "../include/fasta_reader.h"
+#include "../include/memory_budget.h"
+#include <stdexcept>
 
-KSEQ_INIT(int, read)
+// Options of the AlignContext the calling thread works for, NULL for global_args.
+static thread_local GlobalArgs* thread_options = NULL;
+
+GlobalArgs& current_args() {
+    return thread_options ? *thread_options : global_args;
+}
+
+GlobalArgs* thread_args() {
+    return thread_options;
+}
+
+void set_thread_args(GlobalArgs* args) {
+    thread_options = args;
+}
+
+void alignment_failed(const std::string& message) {
+    if (thread_options) {
+        throw std::runtime_error(message);
+    }
+    exit(1);
+}
 
 /**
  * @brief A timer class that measures elapsed time. 
@@ -42,15 +66,10 @@ double Timer::elapsed_time() const {
     return elapsed.count();
 }
 
-/**
- * @brief: read fasta and fastq format data
- * @param data_path   the path to the target data
- * @param data store sequence content
- * @param name store sequence name
- * @return multiple sequence stored in vector 
-*/
-void read_data(const char* data_path, std::vector<std::string>& data, std::vector<std::string>& name, bool verbose = true){
-    if (verbose && global_args.verbose) {
+// Read every record of a fasta/fastq file, plain or gzip compressed, into data.
+// Shared by both read_data() overloads, which only differ in where the sequences are stored.
+static void read_records(const char* data_path, bool verbose, SequenceStore& data, std::vector<std::string>& name) {
+    if (verbose && current_args().verbose) {
         std::cout << "#                   Reading Data...                         #" << std::endl;
         print_table_divider();
     }
@@ -59,7 +78,7 @@ void read_data(const char* data_path, std::vector<std::string>& data, std::vecto
     // check weather the input path could be accessed 
 
     if (access_file(data_path)) {
-        if (verbose && global_args.verbose) {
+        if (verbose && current_args().verbose) {
             output = str_data_path + " could be accessed";
             print_table_line(output);
         }
@@ -71,54 +90,56 @@ void read_data(const char* data_path, std::vector<std::string>& data, std::vecto
         std::cerr << "Program Exit!" << std::endl;
         exit(1);
     }
-    
 
-    FILE* f_pointer = fopen(data_path, "r");
-    kseq_t* file_t = kseq_init(fileno(f_pointer));
-    
-    uint64_t merged_length = 0;
-    int64_t tmp_length = 0; 
-    // stop loop when tmp_length equals -1
-    while ((tmp_length = kseq_read(file_t)) >= 0) // Read one sequence in each iteration of the loop
-    {
-        std::string tmp_data = clean_sequence(file_t -> seq.s);
-        std::string tmp_name = file_t -> name.s;
-        if(file_t->comment.s) tmp_name += file_t->comment.s;
-        data.push_back(tmp_data);
-        name.push_back(tmp_name);
-        merged_length += tmp_length;
-    }
-    kseq_destroy(file_t);
-    fclose(f_pointer);
 
-    if(verbose&& global_args.verbose && merged_length + data.size() > UINT32_MAX && M64 == 0){
-        print_table_bound();
-        std::cerr << "Error: The input data is too large and the 32-bit program may not produce correct results. Please compile a 64-bit program using the M64 parameter." << std::endl;
-        std::cerr << "Program Exit!" << std::endl;
-        exit(1);
-    }
-    #if M64
-    if (verbose && global_args.verbose) {
-        std::stringstream s;
-        s << std::fixed << std::setprecision(2) << merged_length / pow(2, 30);
-        output = "Data Memory Usage: " + s.str() + " GB";
-        print_table_line(output);
-    }
-    
-    #else
-    if (verbose && global_args.verbose) {
+    size_t first = data.size();
+    uint64_t merged_length = read_sequences(data_path, data, name);
+    uint64_t seq_num = data.size() - first;
+
+    if (verbose && current_args().verbose) {
         std::stringstream s;
-        s << std::fixed << std::setprecision(2) << merged_length / pow(2, 20);
-        output = "Data Memory Usage: " + s.str() + " MB";
+        // the index width follows the input length, see find_mem()
+        if (merged_length >= (1ULL << 30)) {
+            s << std::fixed << std::setprecision(2) << merged_length / pow(2, 30);
+            output = "Data Memory Usage: " + s.str() + " GB";
+        }
+        else {
+            s << std::fixed << std::setprecision(2) << merged_length / pow(2, 20);
+            output = "Data Memory Usage: " + s.str() + " MB";
+        }
         print_table_line(output);
     }
-    #endif
-    if (verbose && global_args.verbose) {
-        output = "Sequence Number: " + std::to_string(data.size());
+    if (verbose && current_args().verbose) {
+        output = "Sequence Number: " + std::to_string(seq_num);
         print_table_line(output);
         print_table_divider();
     }
-    return;
+}
+
+/**
+ * @brief: read fasta and fastq format data
+ * @param data_path   the path to the target data
+ * @param data store sequence content
+ * @param name store sequence name
+ * @return multiple sequence stored in vector 
+*/
+void read_data(const char* data_path, std::vector<std::string>& data, std::vector<std::string>& name, bool verbose = true){
+    SequenceStore store;
+    read_records(data_path, verbose, store, name);
+    data.reserve(data.size() + store.size());
+    for (size_t i = 0; i < store.size(); i++) {
+        data.emplace_back(store[i]);
+    }
+}
+
+/**
+ * @brief: read fasta and fastq format data into a sequence store
+ * @param data_path   the path to the target data
+ * @param data store sequence content
+ * @param name store sequence name
+*/
+void read_data(const char* data_path, SequenceStore& data, std::vector<std::string>& name, bool verbose = true){
+    read_records(data_path, verbose, data, name);
 }
 
 /**
@@ -136,6 +157,61 @@ bool access_file(const char* data_path){
     return true;
 }
 
+/**
+ * @brief Read a whole file into memory.
+ * @param path The file path.
+ * @param content Receives the bytes of the file.
+ * @return True if the file could be read, otherwise false.
+*/
+bool read_file(const std::string& path, std::string& content) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    content = buffer.str();
+    return !file.bad();
+}
+
+/**
+ * @brief Write a file through a temporary file that is renamed, so that no reader ever sees a partial file.
+ * @param path The file path.
+ * @param content The bytes to write.
+ * @return True if the file was written, otherwise false.
+*/
+bool write_file_atomic(const std::string& path, const std::string& content) {
+    std::string part = path + ".part";
+    {
+        std::ofstream file(part, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(content.data(), content.size());
+        if (!file.good()) {
+            return false;
+        }
+    }
+    // rename replaces an existing file on POSIX, Windows needs it removed first
+#ifdef _WIN32
+    remove(path.c_str());
+#endif
+    return rename(part.c_str(), path.c_str()) == 0;
+}
+
+/**
+ * @brief The 64 bit FNV-1a hash of data, continued from hash.
+ * @param data The bytes to hash.
+ * @param hash The hash of the bytes before data, or the FNV offset basis to start.
+ * @return The hash.
+*/
+uint64_t fnv1a_hash(std::string_view data, uint64_t hash) {
+    for (unsigned char c : data) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
 /**
  * @brief Cleans the input sequence by removing any non-ATCG characters. 
  * This function removes any characters from the input sequence that are not A, T, C, or G (case-insensitive). 
@@ -172,6 +248,67 @@ std::string clean_sequence(std::string sequence){
     return result;
 }
 
+/**
+ * @brief Parse an aligned FASTA held in memory.
+ * Unlike read_data, gap characters are kept: letters are upper-cased and '-' is preserved,
+ * whitespace is skipped. The records are appended to data and name in file order.
+ * @param buffer The aligned FASTA content.
+ * @param data Receives the aligned sequences.
+ * @param name Receives the sequence names.
+*/
+void parse_alignment(const std::string& buffer, std::vector<std::string>& data, std::vector<std::string>& name) {
+    size_t pos = 0;
+    const size_t len = buffer.size();
+    while (pos < len) {
+        size_t line_end = buffer.find('\n', pos);
+        if (line_end == std::string::npos) {
+            line_end = len;
+        }
+        if (buffer[pos] == '>') {
+            size_t name_end = line_end;
+            if (name_end > pos + 1 && buffer[name_end - 1] == '\r') {
+                name_end--;
+            }
+            name.push_back(buffer.substr(pos + 1, name_end - pos - 1));
+            data.emplace_back();
+        }
+        else if (!data.empty()) {
+            std::string& seq = data.back();
+            for (size_t i = pos; i < line_end; i++) {
+                char c = buffer[i];
+                if (c >= 'a' && c <= 'z') {
+                    seq.push_back(c - 'a' + 'A');
+                }
+                else if ((c >= 'A' && c <= 'Z') || c == '-') {
+                    seq.push_back(c);
+                }
+                else if (c == '.') {
+                    seq.push_back('-');
+                }
+            }
+        }
+        pos = line_end + 1;
+    }
+}
+
+/**
+ * @brief Read an aligned FASTA file, keeping gap characters.
+ * @param data_path The path to the aligned FASTA file.
+ * @param data Receives the aligned sequences.
+ * @param name Receives the sequence names.
+ * @return True if the file could be read, otherwise false.
+*/
+bool read_alignment(const char* data_path, std::vector<std::string>& data, std::vector<std::string>& name) {
+    std::ifstream file(data_path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    parse_alignment(buffer.str(), data, name);
+    return true;
+}
+
 void ArgParser::add_argument(const std::string& name, bool required = false, const std::string& default_value = "") {
     if (args_.count(name) > 0) {
         throw std::invalid_argument("Duplicate argument name: " + name);
@@ -262,7 +399,7 @@ bool ArgParser::has(const std::string& name) const {
 /**
 * @brief Print information about the FMAlign2 algorithm
 * This function prints various information about the FMAlign2 algorithm,
-* including the mode (32-bit or 64-bit), number of threads, minimum MEM length,
+* including the number of threads, minimum MEM length,
 * sequence coverage, and parallel align method.
 * @return void
 */
@@ -270,36 +407,41 @@ void print_algorithm_info() {
     print_table_bound();
     std::cout << "#               FMAlign2 algorithm info                     #" << std::endl;
     print_table_divider();
-#if M64
-    std::string output = "Mode: 64 bit";
-    print_table_line(output);
-#else
-    std::string output = "Mode: 32 bit";
-    print_table_line(output);
-#endif
-    std::string thread_output = "Thread: " + std::to_string(global_args.thread);
+    std::string thread_output = "Thread: " + std::to_string(current_args().thread);
     print_table_line(thread_output);
+    if (current_args().max_mem > 0) {
+        print_table_line("Memory budget: " + format_memory_size(current_args().max_mem));
+    }
 
     std::string l_output;
-    if (global_args.min_mem_length < 0) {
+    if (current_args().min_mem_length < 0) {
         l_output = "Minimum MEM length: square root of mean length";
     }
     else {
-        l_output = "Minimum MEM length: " + std::to_string(global_args.min_mem_length);
+        l_output = "Minimum MEM length: " + std::to_string(current_args().min_mem_length);
     }
     
     print_table_line(l_output);
 
     std::stringstream s;
-    s << std::fixed << std::setprecision(2) << global_args.min_seq_coverage;
+    s << std::fixed << std::setprecision(2) << current_args().min_seq_coverage;
 
     std::string c_output = "Sequence coverage: 1";
 
     print_table_line(c_output);
 
-    std::string p_output = "Parallel align method: " + global_args.package;
+    std::string p_output = "Parallel align method: " + current_args().package;
     print_table_line(p_output);
 
+    std::string io_output = "Backend I/O: ";
+    if (is_stream_template(current_args().package)) {
+        io_output += "stdin/stdout pipes";
+    }
+    else {
+        io_output += "files in " + current_args().tmp_folder;
+    }
+    print_table_line(io_output);
+
     print_table_bound();
 }
 